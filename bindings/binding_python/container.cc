@@ -10,7 +10,9 @@
 #include <vector>
 
 #include "bindings/binding_python/error.h"
+#include "bindings/binding_python/fastcall.h"
 #include "bindings/binding_python/logon.h"
+#include "bindings/binding_python/output.h"
 #include "bindings/binding_python/sid.h"
 #include "bindings/binding_python/target.h"
 
@@ -132,6 +134,166 @@ int SetJobUILimitPolicyObject(PyObject *self,
   return 0;
 }
 
+PyObject *GetMitigationPolicyObject(PyObject *self, void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return NULL;
+  }
+  return PyLong_FromUnsignedLongLong(cobj->policy->mitigation_policy());
+}
+
+int SetMitigationPolicyObject(PyObject *self,
+                              PyObject *value, void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return -1;
+  }
+#if PY_MAJOR_VERSION >= 3
+  if (!PyLong_Check(value)) {
+#else
+  if (!PyInt_Check(value) && !PyLong_Check(value)) {
+#endif
+    PyErr_SetString(PyExc_TypeError, "integer expected");
+    return -1;
+  }
+  unsigned long long ulonglong_val = PyLong_AsUnsignedLongLong(value);
+  if (ulonglong_val == static_cast<unsigned long long>(-1) && PyErr_Occurred())
+    return -1;
+  cobj->policy->set_mitigation_policy(ulonglong_val);
+  return 0;
+}
+
+PyObject *GetJobPoolSizePolicyObject(PyObject *self, void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return NULL;
+  }
+  return PyLong_FromUnsignedLong(cobj->policy->job_pool_size());
+}
+
+int SetJobPoolSizePolicyObject(PyObject *self,
+                               PyObject *value, void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return -1;
+  }
+#if PY_MAJOR_VERSION >= 3
+  if (!PyLong_Check(value)) {
+#else
+  if (!PyInt_Check(value) && !PyLong_Check(value)) {
+#endif
+    PyErr_SetString(PyExc_TypeError, "integer expected");
+    return -1;
+  }
+  unsigned long ulong_val = PyLong_AsUnsignedLong(value);
+  if (ulong_val == static_cast<unsigned long>(-1) && PyErr_Occurred())
+    return -1;
+  cobj->policy->set_job_pool_size(ulong_val);
+  return 0;
+}
+
+PyObject *GetDefaultMemoryLimitPolicyObject(PyObject *self, void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return NULL;
+  }
+  return PyLong_FromSize_t(cobj->policy->default_memory_limit());
+}
+
+int SetDefaultMemoryLimitPolicyObject(PyObject *self,
+                                      PyObject *value, void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return -1;
+  }
+#if PY_MAJOR_VERSION >= 3
+  if (!PyLong_Check(value)) {
+#else
+  if (!PyInt_Check(value) && !PyLong_Check(value)) {
+#endif
+    PyErr_SetString(PyExc_TypeError, "integer expected");
+    return -1;
+  }
+  void *ptr_val = PyLong_AsVoidPtr(value);
+  if (!ptr_val && PyErr_Occurred())
+    return -1;
+  cobj->policy->set_default_memory_limit(reinterpret_cast<uintptr_t>(ptr_val));
+  return 0;
+}
+
+PyObject *GetDefaultActiveProcessLimitPolicyObject(PyObject *self,
+                                                   void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return NULL;
+  }
+  return PyLong_FromUnsignedLong(
+      cobj->policy->default_active_process_limit());
+}
+
+int SetDefaultActiveProcessLimitPolicyObject(PyObject *self,
+                                             PyObject *value,
+                                             void *closure) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return -1;
+  }
+#if PY_MAJOR_VERSION >= 3
+  if (!PyLong_Check(value)) {
+#else
+  if (!PyInt_Check(value) && !PyLong_Check(value)) {
+#endif
+    PyErr_SetString(PyExc_TypeError, "integer expected");
+    return -1;
+  }
+  unsigned long ulong_val = PyLong_AsUnsignedLong(value);
+  if (ulong_val == static_cast<unsigned long>(-1) && PyErr_Occurred())
+    return -1;
+  cobj->policy->set_default_active_process_limit(ulong_val);
+  return 0;
+}
+
+PyObject *SavePolicyObject(PyObject *self, PyObject *args) {
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return NULL;
+  }
+  vector<uint8_t> image;
+  cobj->policy->Save(&image);
+  return PyBytes_FromStringAndSize(reinterpret_cast<char *>(image.data()),
+                                   static_cast<Py_ssize_t>(image.size()));
+}
+
+PyObject *LoadPolicyObject(PyObject *self, PyObject *args) {
+  PyObject *image;
+  if (!PyArg_ParseTuple(args, "O", &image))
+    return NULL;
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  if (!cobj->policy) {
+    PyErr_SetString(PyExc_RuntimeError, "not initialized");
+    return NULL;
+  }
+  // Any object with a buffer, e.g. bytes or a read-only mmap
+  Py_buffer view;
+  if (PyObject_GetBuffer(image, &view, PyBUF_SIMPLE) < 0)
+    return NULL;
+  ResultCode rc = cobj->policy->Load(view.buf,
+                                     static_cast<size_t>(view.len));
+  PyBuffer_Release(&view);
+  if (rc != WINC_OK)
+    return SetErrorFromResultCode(rc);
+  Py_RETURN_NONE;
+}
+
 PyObject *GetLogonPolicyObject(PyObject *self, void *closure) {
   ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
   if (!cobj->policy) {
@@ -197,7 +359,7 @@ PyObject *GetRestrictedSids(PyObject *self, void *closure) {
     PyErr_SetString(PyExc_RuntimeError, "not initialized");
     return NULL;
   }
-  vector<Sid> sids = cobj->policy->restricted_sids();
+  vector<const Sid *> sids = cobj->policy->restricted_sids();
   PyObject *tuple = PyTuple_New(sids.size());
   if (!tuple)
     return NULL;
@@ -207,13 +369,8 @@ PyObject *GetRestrictedSids(PyObject *self, void *closure) {
       Py_DECREF(tuple);
       return NULL;
     }
-    new (&sobj->sid) Sid;
+    new (&sobj->sid) Sid(*sids[index]);
     PyTuple_SetItem(tuple, index, reinterpret_cast<PyObject *>(sobj));
-    ResultCode rc = sobj->sid.Init(sids[index].data());
-    if (rc != WINC_OK) {
-      Py_DECREF(tuple);
-      return SetErrorFromResultCode(rc);
-    }
   }
   return tuple;
 }
@@ -254,6 +411,143 @@ HANDLE GetInheritableHandle(PyObject *handle, unique_handle *out_holder) {
   return object_dup;
 }
 
+// Fills the spawn options from the arguments of spawn and run, the holders
+// keep the duplicated inheritable handles
+int ParseSpawnOptions(wchar_t *command_line,
+                      const wchar_t *current_directory,
+                      PyObject *processor_affinity,
+                      PyObject *memory_limit,
+                      unsigned int active_process_limit,
+                      PyObject *stdin_handle,
+                      PyObject *stdout_handle,
+                      PyObject *stderr_handle,
+                      PyObject *auto_affinity,
+                      SpawnOptions *options,
+                      unique_handle *stdin_holder,
+                      unique_handle *stdout_holder,
+                      unique_handle *stderr_holder) {
+  *options = SpawnOptions();
+  options->command_line = command_line;
+  options->current_directory = current_directory;
+  if (!(options->processor_affinity = reinterpret_cast<uintptr_t>(
+      GetOptionalPointer(processor_affinity))) && PyErr_Occurred())
+    return -1;
+  if (!(options->memory_limit = reinterpret_cast<uintptr_t>(
+      GetOptionalPointer(memory_limit))) && PyErr_Occurred())
+    return -1;
+  if (auto_affinity) {
+    int is_true = PyObject_IsTrue(auto_affinity);
+    if (is_true < 0)
+      return -1;
+    options->auto_affinity = is_true != 0;
+  }
+  options->active_process_limit = active_process_limit;
+  options->stdin_handle = GetInheritableHandle(stdin_handle, stdin_holder);
+  if (!options->stdin_handle && PyErr_Occurred())
+    return -1;
+  options->stdout_handle = GetInheritableHandle(stdout_handle, stdout_holder);
+  if (!options->stdout_handle && PyErr_Occurred())
+    return -1;
+  options->stderr_handle = GetInheritableHandle(stderr_handle, stderr_holder);
+  if (!options->stderr_handle && PyErr_Occurred())
+    return -1;
+  return 0;
+}
+
+PyObject *Spawn(PyObject *self, const wchar_t *exe_path, PyObject *target,
+                wchar_t *command_line, const wchar_t *current_directory,
+                PyObject *processor_affinity, PyObject *memory_limit,
+                unsigned int active_process_limit,
+                PyObject *stdin_handle, PyObject *stdout_handle,
+                PyObject *stderr_handle, PyObject *auto_affinity) {
+  if (target) {
+    Py_INCREF(target);
+  } else {
+    target = PyObject_CallObject(reinterpret_cast<PyObject *>(&g_target_type),
+                                 NULL);
+    if (!target)
+      return NULL;
+  }
+  TargetObject *tobj = reinterpret_cast<TargetObject *>(target);
+  if (tobj->container_object) {
+    Py_DECREF(target);
+    PyErr_SetString(g_error_class, "target already in use");
+    return NULL;
+  }
+  unique_handle stdin_holder, stdout_holder, stderr_holder;
+  SpawnOptions options;
+  if (ParseSpawnOptions(command_line, current_directory,
+                        processor_affinity, memory_limit,
+                        active_process_limit,
+                        stdin_handle, stdout_handle, stderr_handle,
+                        auto_affinity, &options,
+                        &stdin_holder, &stdout_holder, &stderr_holder) < 0) {
+    Py_DECREF(target);
+    return NULL;
+  }
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  ResultCode rc;
+  Py_BEGIN_ALLOW_THREADS
+  rc = cobj->container.Spawn(exe_path, &tobj->target, &options);
+  Py_END_ALLOW_THREADS
+  if (rc != WINC_OK) {
+    Py_DECREF(target);
+    return SetErrorFromResultCode(rc);
+  }
+  // The lifecycle of the container must be longer than the target,
+  // so we keep an implicit reference here
+  Py_INCREF(cobj);
+  tobj->container_object = cobj;
+  return target;
+}
+
+#ifdef WINC_PYTHON_FASTCALL
+
+const char *const spawn_keywords[] = {"exe_path", "target",
+                                      "command_line", "current_directory",
+                                      "processor_affinity",
+                                      "memory_limit", "active_process_limit",
+                                      "stdin_handle", "stdout_handle",
+                                      "stderr_handle",
+                                      "auto_affinity"};
+
+PyObject *spawn_kwnames[ARRAYSIZE(spawn_keywords)];
+
+PyObject *SpawnContainerObject(PyObject *self, PyObject *const *args,
+                               Py_ssize_t nargs, PyObject *kwnames) {
+  enum {
+    EXE_PATH, TARGET, COMMAND_LINE, CURRENT_DIRECTORY, PROCESSOR_AFFINITY,
+    MEMORY_LIMIT, ACTIVE_PROCESS_LIMIT, STDIN_HANDLE, STDOUT_HANDLE,
+    STDERR_HANDLE, AUTO_AFFINITY, ARG_COUNT
+  };
+  PyObject *values[ARG_COUNT];
+  if (ParseFastArgs("spawn", args, nargs, kwnames, spawn_kwnames, ARG_COUNT,
+                    1, values) < 0)
+    return NULL;
+  unique_pywstr exe_path, command_line, current_directory;
+  unsigned int active_process_limit = 0;
+  if (GetWideString(values[EXE_PATH], "exe_path", &exe_path) < 0 ||
+      GetWideString(values[COMMAND_LINE], "command_line",
+                    &command_line) < 0 ||
+      GetWideString(values[CURRENT_DIRECTORY], "current_directory",
+                    &current_directory) < 0 ||
+      GetUnsignedInt(values[ACTIVE_PROCESS_LIMIT],
+                     &active_process_limit) < 0)
+    return NULL;
+  if (values[TARGET] && !PyObject_TypeCheck(values[TARGET], &g_target_type)) {
+    PyErr_SetString(PyExc_TypeError, "target must be winc.Target");
+    return NULL;
+  }
+  return Spawn(self, exe_path.get(), values[TARGET],
+               command_line.get(), current_directory.get(),
+               values[PROCESSOR_AFFINITY], values[MEMORY_LIMIT],
+               active_process_limit,
+               values[STDIN_HANDLE], values[STDOUT_HANDLE],
+               values[STDERR_HANDLE], values[AUTO_AFFINITY]);
+}
+
+#else
+
 PyObject *SpawnContainerObject(PyObject *self,
                                PyObject *args, PyObject *kwds) {
   static char *kwlist[] = {"exe_path", "target",
@@ -261,6 +555,7 @@ PyObject *SpawnContainerObject(PyObject *self,
                            "processor_affinity",
                            "memory_limit", "active_process_limit",
                            "stdin_handle", "stdout_handle", "stderr_handle",
+                           "auto_affinity",
                            NULL};
   Py_UNICODE *exe_path;
   PyObject *target = NULL;
@@ -272,7 +567,8 @@ PyObject *SpawnContainerObject(PyObject *self,
   PyObject *stdin_handle = NULL;
   PyObject *stdout_handle = NULL;
   PyObject *stderr_handle = NULL;
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "u|O!uuOOIOOO", kwlist,
+  PyObject *auto_affinity = NULL;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "u|O!uuOOIOOOO", kwlist,
                                    &exe_path,
                                    &g_target_type, &target,
                                    &command_line,
@@ -282,74 +578,137 @@ PyObject *SpawnContainerObject(PyObject *self,
                                    &active_process_limit,
                                    &stdin_handle,
                                    &stdout_handle,
-                                   &stderr_handle))
-    return NULL;
-  if (target) {
-    Py_INCREF(target);
-  } else {
-    target = PyObject_CallObject(reinterpret_cast<PyObject *>(&g_target_type),
-                                 NULL);
-    if (!target)
-      return NULL;
-  }
-  TargetObject *tobj = reinterpret_cast<TargetObject *>(target);
-  if (tobj->container_object) {
-    Py_DECREF(target);
-    PyErr_SetString(g_error_class, "target already in use");
-    return NULL;
-  }
-  unique_handle stdin_holder, stdout_holder, stderr_holder;
-  SpawnOptions options = {};
-  options.command_line = command_line;
-  options.current_directory = current_directory;
-  if (!(options.processor_affinity = reinterpret_cast<uintptr_t>(
-      GetOptionalPointer(processor_affinity))) && PyErr_Occurred()) {
-    Py_DECREF(target);
-    return NULL;
-  }
-  if (!(options.memory_limit = reinterpret_cast<uintptr_t>(
-      GetOptionalPointer(memory_limit))) && PyErr_Occurred()) {
-    Py_DECREF(target);
+                                   &stderr_handle,
+                                   &auto_affinity))
     return NULL;
-  }
-  options.active_process_limit = active_process_limit;
-  options.stdin_handle = GetInheritableHandle(stdin_handle, &stdin_holder);
-  if (!options.stdin_handle && PyErr_Occurred()) {
-    Py_DECREF(target);
+  return Spawn(self, exe_path, target, command_line, current_directory,
+               processor_affinity, memory_limit, active_process_limit,
+               stdin_handle, stdout_handle, stderr_handle, auto_affinity);
+}
+
+#endif
+
+PyStructSequence_Field run_result_fields[] = {
+  {"exit_code"},
+  {"job_time", "in 100 nanoseconds"},
+  {"peak_memory", "in bytes"},
+  {"time_limit_exceeded"},
+  {"stdout", "captured standard output, None if not captured"},
+  {"stderr", "captured standard error, None if not captured"},
+  {NULL}
+};
+
+PyStructSequence_Desc run_result_desc = {
+  "winc.RunResult",  // name
+  NULL,              // doc
+  run_result_fields,
+  // The captured streams are only accessible by name
+  4                  // n_in_sequence
+};
+
+// Spawns, runs and collects the target in a single crossing, without the
+// target object and its events
+PyObject *RunContainerObject(PyObject *self, PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {"exe_path",
+                           "command_line", "current_directory",
+                           "processor_affinity",
+                           "memory_limit", "active_process_limit",
+                           "stdin_handle", "stdout_handle", "stderr_handle",
+                           "auto_affinity", "time_limit",
+                           "stdout_capture_limit", "stderr_capture_limit",
+                           NULL};
+  Py_UNICODE *exe_path;
+  Py_UNICODE *command_line = NULL;
+  Py_UNICODE *current_directory = NULL;
+  PyObject *processor_affinity = NULL;
+  PyObject *memory_limit = NULL;
+  unsigned int active_process_limit = 0;
+  PyObject *stdin_handle = NULL;
+  PyObject *stdout_handle = NULL;
+  PyObject *stderr_handle = NULL;
+  PyObject *auto_affinity = NULL;
+  unsigned int time_limit = 0;
+  Py_ssize_t stdout_capture_limit = 0;
+  Py_ssize_t stderr_capture_limit = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "u|uuOOIOOOOInn", kwlist,
+                                   &exe_path,
+                                   &command_line,
+                                   &current_directory,
+                                   &processor_affinity,
+                                   &memory_limit,
+                                   &active_process_limit,
+                                   &stdin_handle,
+                                   &stdout_handle,
+                                   &stderr_handle,
+                                   &auto_affinity,
+                                   &time_limit,
+                                   &stdout_capture_limit,
+                                   &stderr_capture_limit))
     return NULL;
-  }
-  options.stdout_handle = GetInheritableHandle(stdout_handle, &stdout_holder);
-  if (!options.stdout_handle && PyErr_Occurred()) {
-    Py_DECREF(target);
+  if (stdout_capture_limit < 0 || stderr_capture_limit < 0) {
+    PyErr_SetString(PyExc_ValueError, "negative capture limit");
     return NULL;
   }
-  options.stderr_handle = GetInheritableHandle(stderr_handle, &stderr_holder);
-  if (!options.stderr_handle && PyErr_Occurred()) {
-    Py_DECREF(target);
+  unique_handle stdin_holder, stdout_holder, stderr_holder;
+  SpawnOptions options;
+  if (ParseSpawnOptions(command_line, current_directory,
+                        processor_affinity, memory_limit,
+                        active_process_limit,
+                        stdin_handle, stdout_handle, stderr_handle,
+                        auto_affinity, &options,
+                        &stdin_holder, &stdout_holder, &stderr_holder) < 0)
     return NULL;
-  }
+  RunLimits limits = {};
+  limits.time_limit_ms = time_limit;
+  limits.stdout_capture_limit = stdout_capture_limit;
+  limits.stderr_capture_limit = stderr_capture_limit;
   ContainerObject *cobj = reinterpret_cast<ContainerObject *>(self);
+  RunResult result;
   ResultCode rc;
   Py_BEGIN_ALLOW_THREADS
-  rc = cobj->container.Spawn(exe_path, &tobj->target, &options);
+  rc = cobj->container.Run(exe_path, &options, limits, &result);
   Py_END_ALLOW_THREADS
-  if (rc != WINC_OK) {
-    Py_DECREF(target);
+  if (rc != WINC_OK)
     return SetErrorFromResultCode(rc);
+  PyObject *robj = PyStructSequence_New(&g_run_result_type);
+  if (!robj)
+    return NULL;
+  PyStructSequence_SET_ITEM(robj, 0,
+                            PyLong_FromUnsignedLong(result.exit_code));
+  PyStructSequence_SET_ITEM(robj, 1,
+                            PyLong_FromUnsignedLongLong(result.job_time));
+  PyStructSequence_SET_ITEM(robj, 2,
+                            PyLong_FromSize_t(result.peak_memory));
+  PyStructSequence_SET_ITEM(robj, 3,
+                            PyBool_FromLong(result.time_limit_exceeded));
+  PyStructSequence_SET_ITEM(robj, 4, NewOutputObject(result.stdout_output));
+  PyStructSequence_SET_ITEM(robj, 5, NewOutputObject(result.stderr_output));
+  for (Py_ssize_t i = 0; i < 6; ++i) {
+    if (!PyStructSequence_GET_ITEM(robj, i)) {
+      Py_DECREF(robj);
+      return NULL;
+    }
   }
-  // The lifecycle of the container must be longer than the target,
-  // so we keep an implicit reference here
-  Py_INCREF(cobj);
-  tobj->container_object = cobj;
-  return target;
+  return robj;
 }
 
 PyMethodDef container_methods[] = {
+#ifdef WINC_PYTHON_FASTCALL
   {"spawn",
    reinterpret_cast<PyCFunction>(SpawnContainerObject),
+   METH_FASTCALL | METH_KEYWORDS},
+#else
+  {"spawn",
+   reinterpret_cast<PyCFunction>(SpawnContainerObject),
+   METH_VARARGS | METH_KEYWORDS},
+#endif
+  {"run",
+   reinterpret_cast<PyCFunction>(RunContainerObject),
    METH_VARARGS | METH_KEYWORDS},
   {"add_restricted_sid", AddRestrictedSidPolicyObject, METH_VARARGS},
   {"remove_restricted_sid", RemoveRestrictedSidPolicyObject, METH_VARARGS},
+  {"save_policy", SavePolicyObject, METH_NOARGS},
+  {"load_policy", LoadPolicyObject, METH_VARARGS},
   {NULL}
 };
 
@@ -357,6 +716,12 @@ PyGetSetDef container_getset[] = {
   {"use_desktop", GetUseDesktopPolicyObject, SetUseDesktopPolicyObject},
   {"job_basic_limit", GetJobBasicLimitPolicyObject, SetJobBasicLimitPolicyObject},
   {"job_ui_limit", GetJobUILimitPolicyObject, SetJobUILimitPolicyObject},
+  {"mitigation_policy", GetMitigationPolicyObject, SetMitigationPolicyObject},
+  {"job_pool_size", GetJobPoolSizePolicyObject, SetJobPoolSizePolicyObject},
+  {"default_memory_limit", GetDefaultMemoryLimitPolicyObject,
+   SetDefaultMemoryLimitPolicyObject},
+  {"default_active_process_limit", GetDefaultActiveProcessLimitPolicyObject,
+   SetDefaultActiveProcessLimitPolicyObject},
   {"logon", GetLogonPolicyObject, SetLogonPolicyObject},
   {"restricted_sids", GetRestrictedSids, NULL},
   {NULL}
@@ -370,7 +735,14 @@ PyTypeObject g_container_type = {
   sizeof(ContainerObject),  // tp_basicsize
 };
 
+PyTypeObject g_run_result_type;
+
 int InitContainerType() {
+#ifdef WINC_PYTHON_FASTCALL
+  if (InternKeywords(spawn_keywords, ARRAYSIZE(spawn_keywords),
+                     spawn_kwnames) < 0)
+    return -1;
+#endif
   g_container_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
   g_container_type.tp_methods = container_methods;
   g_container_type.tp_getset = container_getset;
@@ -378,6 +750,7 @@ int InitContainerType() {
   g_container_type.tp_dealloc = DeleteContainerObject;
   if (PyType_Ready(&g_container_type) < 0)
     return -1;
+  PyStructSequence_InitType(&g_run_result_type, &run_result_desc);
   return 0;
 }
 
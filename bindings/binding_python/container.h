@@ -22,6 +22,8 @@ struct ContainerObject {
 int InitContainerType();
 
 extern PyTypeObject g_container_type;
+// Result of Container.run, a struct sequence
+extern PyTypeObject g_run_result_type;
 
 }
 
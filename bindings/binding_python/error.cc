@@ -51,6 +51,21 @@ PyObject *SetErrorFromResultCode(ResultCode rc) {
   case WINC_PRIVILEGE_NOT_HELD:
     desc = "privilege not held";
     break;
+  case WINC_ERROR_NO_FREE_CORE:
+    desc = "no free core";
+    break;
+  case WINC_ERROR_OVER_BUDGET:
+    desc = "request over budget";
+    break;
+  case WINC_ERROR_ENVIRONMENT:
+    desc = "environment error";
+    break;
+  case WINC_ERROR_POLICY:
+    desc = "policy error";
+    break;
+  case WINC_ERROR_TIMEOUT:
+    desc = "timeout";
+    break;
   }
   return PyErr_Format(g_error_class, "%s (%d)", desc, rc);
 }
@@ -0,0 +1,249 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "bindings/binding_python/event_queue.h"
+
+#include <Python.h>
+#include <winc.h>
+#include <malloc.h>
+
+#include "bindings/binding_python/target.h"
+
+namespace winc {
+
+namespace python {
+
+namespace {
+
+struct EventEntry {
+  SLIST_ENTRY entry;
+  TargetObject *target;
+  EventType type;
+  DWORD process_id;
+  unsigned int level;
+  SIZE_T bytes;
+};
+
+bool IsSameAddress(const sockaddr_in &a, const sockaddr_in &b) {
+  return a.sin_port == b.sin_port &&
+         a.sin_addr.s_addr == b.sin_addr.s_addr;
+}
+
+bool ConnectSocketPair(SOCKET listener, SOCKET *out_read, SOCKET *out_write) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int addr_size = sizeof(addr);
+  if (::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) ||
+      ::getsockname(listener, reinterpret_cast<sockaddr *>(&addr),
+                    &addr_size) ||
+      ::listen(listener, 1))
+    return false;
+  SOCKET writer = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (writer == INVALID_SOCKET)
+    return false;
+  if (::connect(writer, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+    ::closesocket(writer);
+    return false;
+  }
+  SOCKET reader = ::accept(listener, NULL, NULL);
+  if (reader == INVALID_SOCKET) {
+    ::closesocket(writer);
+    return false;
+  }
+  // Anyone on the machine may connect to the listener, so make sure that
+  // the accepted socket is the peer of ours
+  sockaddr_in writer_addr, reader_peer_addr;
+  int writer_addr_size = sizeof(writer_addr);
+  int reader_peer_addr_size = sizeof(reader_peer_addr);
+  bool verified = !::getsockname(writer,
+                                 reinterpret_cast<sockaddr *>(&writer_addr),
+                                 &writer_addr_size) &&
+                  !::getpeername(reader,
+                                 reinterpret_cast<sockaddr *>(
+                                     &reader_peer_addr),
+                                 &reader_peer_addr_size);
+  if (verified && !IsSameAddress(writer_addr, reader_peer_addr)) {
+    ::WSASetLastError(WSAECONNREFUSED);
+    verified = false;
+  }
+  u_long non_blocking = 1;
+  BOOL no_delay = TRUE;
+  if (!verified ||
+      ::ioctlsocket(reader, FIONBIO, &non_blocking) ||
+      ::setsockopt(writer, IPPROTO_TCP, TCP_NODELAY,
+                   reinterpret_cast<const char *>(&no_delay),
+                   sizeof(no_delay))) {
+    ::closesocket(reader);
+    ::closesocket(writer);
+    return false;
+  }
+  *out_read = reader;
+  *out_write = writer;
+  return true;
+}
+
+// There is no socketpair on Windows, the pair is connected through a
+// listener on the loopback interface
+bool CreateSocketPair(SOCKET *out_read, SOCKET *out_write) {
+  SOCKET listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listener == INVALID_SOCKET)
+    return false;
+  bool connected = ConnectSocketPair(listener, out_read, out_write);
+  int error = ::WSAGetLastError();
+  ::closesocket(listener);
+  ::WSASetLastError(error);
+  return connected;
+}
+
+// Frees the entries, releasing the references carried by exit all events
+void FreeEntries(PSLIST_ENTRY first) {
+  while (first) {
+    EventEntry *entry = CONTAINING_RECORD(first, EventEntry, entry);
+    first = first->Next;
+    if (entry->type == EVENT_EXIT_ALL)
+      Py_DECREF(entry->target);
+    _aligned_free(entry);
+  }
+}
+
+PyObject *CreateEventQueueObject(PyTypeObject *subtype,
+                                 PyObject *args, PyObject *kwds) {
+  PSLIST_HEADER events = static_cast<PSLIST_HEADER>(
+      _aligned_malloc(sizeof(SLIST_HEADER), MEMORY_ALLOCATION_ALIGNMENT));
+  if (!events)
+    return PyErr_NoMemory();
+  ::InitializeSListHead(events);
+  WSADATA wsa_data;
+  int error = ::WSAStartup(MAKEWORD(2, 2), &wsa_data);
+  if (error) {
+    _aligned_free(events);
+    PyErr_SetExcFromWindowsErr(PyExc_WindowsError, error);
+    return NULL;
+  }
+  SOCKET signal_read, signal_write;
+  if (!CreateSocketPair(&signal_read, &signal_write)) {
+    PyErr_SetExcFromWindowsErr(PyExc_WindowsError, ::WSAGetLastError());
+    ::WSACleanup();
+    _aligned_free(events);
+    return NULL;
+  }
+  PyObject *obj = subtype->tp_alloc(subtype, 0);
+  if (!obj) {
+    ::closesocket(signal_read);
+    ::closesocket(signal_write);
+    ::WSACleanup();
+    _aligned_free(events);
+    return NULL;
+  }
+  EventQueueObject *qobj = reinterpret_cast<EventQueueObject *>(obj);
+  qobj->events = events;
+  qobj->signal_read = signal_read;
+  qobj->signal_write = signal_write;
+  qobj->signaled = 0;
+  return obj;
+}
+
+void DeleteEventQueueObject(PyObject *self) {
+  // The started targets keep the queue alive, so nothing is pushed
+  // any more
+  EventQueueObject *qobj = reinterpret_cast<EventQueueObject *>(self);
+  FreeEntries(::InterlockedFlushSList(qobj->events));
+  _aligned_free(qobj->events);
+  ::closesocket(qobj->signal_read);
+  ::closesocket(qobj->signal_write);
+  ::WSACleanup();
+  Py_TYPE(self)->tp_free(self);
+}
+
+PyObject *FilenoEventQueueObject(PyObject *self, PyObject *args) {
+  EventQueueObject *qobj = reinterpret_cast<EventQueueObject *>(self);
+  return PyLong_FromUnsignedLongLong(qobj->signal_read);
+}
+
+// Returns the pending events as a list of (target, type, process_id, level,
+// bytes) in the order of delivery
+PyObject *DrainEventQueueObject(PyObject *self, PyObject *args) {
+  EventQueueObject *qobj = reinterpret_cast<EventQueueObject *>(self);
+  // The socket is drained before the flag is reset, so that a byte sent
+  // after the reset is left for the next wakeup. Events pushed after the
+  // reset signal again, the ones before are taken by the flush below.
+  char buffer[64];
+  while (::recv(qobj->signal_read, buffer, sizeof(buffer), 0) > 0);
+  ::InterlockedExchange(&qobj->signaled, 0);
+
+  // The list is in the reverse order of the pushes
+  PSLIST_ENTRY pushed = ::InterlockedFlushSList(qobj->events);
+  PSLIST_ENTRY first = NULL;
+  while (pushed) {
+    PSLIST_ENTRY next = pushed->Next;
+    pushed->Next = first;
+    first = pushed;
+    pushed = next;
+  }
+
+  PyObject *list = PyList_New(0);
+  for (PSLIST_ENTRY current = first; list && current;
+       current = current->Next) {
+    EventEntry *entry = CONTAINING_RECORD(current, EventEntry, entry);
+    PyObject *item = Py_BuildValue("(OiIIK)", entry->target,
+                                   static_cast<int>(entry->type),
+                                   static_cast<unsigned int>(
+                                       entry->process_id),
+                                   entry->level,
+                                   static_cast<unsigned long long>(
+                                       entry->bytes));
+    if (!item || PyList_Append(list, item) < 0)
+      Py_CLEAR(list);
+    Py_XDECREF(item);
+  }
+  FreeEntries(first);
+  return list;
+}
+
+PyMethodDef event_queue_methods[] = {
+  {"fileno", FilenoEventQueueObject, METH_NOARGS},
+  {"drain",  DrainEventQueueObject,  METH_NOARGS},
+  {NULL}
+};
+
+}
+
+void PushEvent(EventQueueObject *qobj, TargetObject *tobj,
+               EventType type, DWORD process_id,
+               unsigned int level, SIZE_T bytes) {
+  EventEntry *entry = static_cast<EventEntry *>(
+      _aligned_malloc(sizeof(EventEntry), MEMORY_ALLOCATION_ALIGNMENT));
+  if (!entry)
+    return;
+  entry->target = tobj;
+  entry->type = type;
+  entry->process_id = process_id;
+  entry->level = level;
+  entry->bytes = bytes;
+  ::InterlockedPushEntrySList(qobj->events, &entry->entry);
+  // One byte wakes the consumer for all of the events until it drains
+  if (!::InterlockedExchange(&qobj->signaled, 1))
+    ::send(qobj->signal_write, "", 1, 0);
+}
+
+PyTypeObject g_event_queue_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "winc.EventQueue",         // tp_name
+  sizeof(EventQueueObject),  // tp_basicsize
+};
+
+int InitEventQueueType() {
+  g_event_queue_type.tp_flags = Py_TPFLAGS_DEFAULT;
+  g_event_queue_type.tp_methods = event_queue_methods;
+  g_event_queue_type.tp_new = CreateEventQueueObject;
+  g_event_queue_type.tp_dealloc = DeleteEventQueueObject;
+  if (PyType_Ready(&g_event_queue_type) < 0)
+    return -1;
+  return 0;
+}
+
+}
+
+}
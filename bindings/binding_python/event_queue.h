@@ -0,0 +1,55 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_BINDING_PYTHON_EVENT_QUEUE_H_
+#define WINC_BINDING_PYTHON_EVENT_QUEUE_H_
+
+#include <Python.h>
+#include <winc.h>
+
+namespace winc {
+
+namespace python {
+
+struct TargetObject;
+
+enum EventType {
+  EVENT_ACTIVE_PROCESS_LIMIT,
+  EVENT_EXIT_ALL,
+  EVENT_NEW_PROCESS,
+  EVENT_EXIT_PROCESS,
+  EVENT_MEMORY_LIMIT,
+  EVENT_MEMORY_THRESHOLD,
+};
+
+// Delivers the events of the targets started with the queue to a single
+// consumer thread, e.g. an asyncio loop. The event dispatcher pushes to a
+// lock-free list without taking the GIL and signals a loopback socket,
+// which the consumer waits on before draining the events in batches.
+struct EventQueueObject {
+  PyObject_HEAD
+  // Separately allocated to meet the alignment of the list header
+  PSLIST_HEADER events;
+  SOCKET signal_read;
+  SOCKET signal_write;
+  // Set once the socket is signaled, until the consumer drains
+  LONG volatile signaled;
+};
+
+// Called by the event dispatcher without the GIL. The exit all event
+// carries the reference of the started target to the consumer. The level
+// and the bytes are only set by the memory threshold event.
+void PushEvent(EventQueueObject *qobj, TargetObject *tobj,
+               EventType type, DWORD process_id,
+               unsigned int level = 0, SIZE_T bytes = 0);
+
+int InitEventQueueType();
+
+extern PyTypeObject g_event_queue_type;
+
+}
+
+}
+
+#endif
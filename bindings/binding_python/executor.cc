@@ -0,0 +1,224 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "bindings/binding_python/executor.h"
+
+#include <Python.h>
+#include <winc.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bindings/binding_python/container.h"
+#include "bindings/binding_python/error.h"
+
+using std::move;
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace winc {
+
+namespace python {
+
+namespace {
+
+// Returns -1 on error, 0 if the key is absent and 1 if found
+int GetLimit(PyObject *limits, const char *key, unsigned long long *out) {
+  PyObject *item = PyDict_GetItemString(limits, key);
+  if (!item)
+    return 0;
+  PyObject *number = PyNumber_Long(item);
+  if (!number)
+    return -1;
+  unsigned long long value = PyLong_AsUnsignedLongLong(number);
+  Py_DECREF(number);
+  if (value == static_cast<unsigned long long>(-1) && PyErr_Occurred())
+    return -1;
+  *out = value;
+  return 1;
+}
+
+// A job is a tuple of (exe_path, command_line, input, limits), where the
+// trailing items are optional and may be None. The limits are a dict with
+// the optional keys memory_limit, time_limit (in milliseconds),
+// active_process_limit and processor_affinity.
+int ParseJob(PyObject *item, ExecutorJob *job) {
+  if (!PyTuple_Check(item)) {
+    PyErr_SetString(PyExc_TypeError, "job tuple expected");
+    return -1;
+  }
+  Py_UNICODE *exe_path;
+  Py_UNICODE *command_line = NULL;
+  PyObject *input = Py_None;
+  PyObject *limits = Py_None;
+  if (!PyArg_ParseTuple(item, "u|ZOO", &exe_path, &command_line,
+                        &input, &limits))
+    return -1;
+  job->exe_path = exe_path;
+  if (command_line)
+    job->command_line = command_line;
+  if (input != Py_None) {
+    char *data;
+    Py_ssize_t size;
+    if (PyBytes_AsStringAndSize(input, &data, &size) < 0)
+      return -1;
+    job->input.assign(data, size);
+  }
+  job->processor_affinity = 0;
+  job->auto_affinity = false;
+  job->memory_limit = 0;
+  job->active_process_limit = 0;
+  job->time_limit_ms = 0;
+  if (limits != Py_None) {
+    if (!PyDict_Check(limits)) {
+      PyErr_SetString(PyExc_TypeError, "limits dict expected");
+      return -1;
+    }
+    unsigned long long value;
+    int found;
+    if ((found = GetLimit(limits, "memory_limit", &value)) < 0)
+      return -1;
+    if (found)
+      job->memory_limit = static_cast<uintptr_t>(value);
+    if ((found = GetLimit(limits, "time_limit", &value)) < 0)
+      return -1;
+    if (found)
+      job->time_limit_ms = static_cast<DWORD>(value);
+    if ((found = GetLimit(limits, "active_process_limit", &value)) < 0)
+      return -1;
+    if (found)
+      job->active_process_limit = static_cast<uint32_t>(value);
+    if ((found = GetLimit(limits, "processor_affinity", &value)) < 0)
+      return -1;
+    if (found)
+      job->processor_affinity = static_cast<uintptr_t>(value);
+  }
+  return 0;
+}
+
+PyObject *CreateExecutorObject(PyTypeObject *subtype,
+                               PyObject *args, PyObject *kwds) {
+  static char *kwlist[] = {"container", "jobs", "workers", NULL};
+  PyObject *container;
+  PyObject *jobs;
+  unsigned int workers = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O|I", kwlist,
+                                   &g_container_type, &container,
+                                   &jobs, &workers))
+    return NULL;
+  PyObject *jobs_seq = PySequence_Fast(jobs, "jobs must be a sequence");
+  if (!jobs_seq)
+    return NULL;
+  Py_ssize_t job_count = PySequence_Fast_GET_SIZE(jobs_seq);
+  vector<ExecutorJob> executor_jobs(job_count);
+  for (Py_ssize_t i = 0; i < job_count; ++i) {
+    if (ParseJob(PySequence_Fast_GET_ITEM(jobs_seq, i),
+                 &executor_jobs[i]) < 0) {
+      Py_DECREF(jobs_seq);
+      return NULL;
+    }
+  }
+  Py_DECREF(jobs_seq);
+
+  PyObject *obj = subtype->tp_alloc(subtype, 0);
+  if (!obj)
+    return NULL;
+  ExecutorObject *eobj = reinterpret_cast<ExecutorObject *>(obj);
+  new (&eobj->executor) Executor;
+  eobj->iterating = false;
+  ContainerObject *cobj = reinterpret_cast<ContainerObject *>(container);
+  ResultCode rc;
+  Py_BEGIN_ALLOW_THREADS
+  rc = eobj->executor.Init(&cobj->container, move(executor_jobs), workers);
+  Py_END_ALLOW_THREADS
+  if (rc != WINC_OK) {
+    Py_BEGIN_ALLOW_THREADS
+    eobj->executor.~Executor();
+    Py_END_ALLOW_THREADS
+    subtype->tp_free(obj);
+    return SetErrorFromResultCode(rc);
+  }
+  // The container must outlive the executor
+  Py_INCREF(cobj);
+  eobj->container_object = cobj;
+  return obj;
+}
+
+void DeleteExecutorObject(PyObject *self) {
+  ExecutorObject *eobj = reinterpret_cast<ExecutorObject *>(self);
+  // Waits for the running jobs
+  Py_BEGIN_ALLOW_THREADS
+  eobj->executor.~Executor();
+  Py_END_ALLOW_THREADS
+  Py_XDECREF(eobj->container_object);
+  Py_TYPE(self)->tp_free(self);
+}
+
+PyObject *IterExecutorObject(PyObject *self) {
+  Py_INCREF(self);
+  return self;
+}
+
+PyObject *IterNextExecutorObject(PyObject *self) {
+  ExecutorObject *eobj = reinterpret_cast<ExecutorObject *>(self);
+  if (eobj->iterating) {
+    PyErr_SetString(PyExc_RuntimeError, "executor already iterating");
+    return NULL;
+  }
+  eobj->iterating = true;
+  ExecutorResult result;
+  bool finished;
+  ResultCode rc;
+  Py_BEGIN_ALLOW_THREADS
+  rc = eobj->executor.Next(&result, &finished);
+  Py_END_ALLOW_THREADS
+  eobj->iterating = false;
+  if (rc != WINC_OK)
+    return SetErrorFromResultCode(rc);
+  if (finished)
+    return NULL;
+  if (result.rc != WINC_OK)
+    return SetErrorFromResultCode(result.rc);
+  return Py_BuildValue("(nkKnO)",
+                       static_cast<Py_ssize_t>(result.index),
+                       static_cast<unsigned long>(result.exit_code),
+                       static_cast<unsigned long long>(result.job_time),
+                       static_cast<Py_ssize_t>(result.peak_memory),
+                       result.time_limit_exceeded ? Py_True : Py_False);
+}
+
+PyObject *GetJobCountExecutorObject(PyObject *self, void *closure) {
+  ExecutorObject *eobj = reinterpret_cast<ExecutorObject *>(self);
+  return PyLong_FromSize_t(eobj->executor.job_count());
+}
+
+PyGetSetDef executor_getset[] = {
+  {"job_count", GetJobCountExecutorObject, NULL},
+  {NULL}
+};
+
+}
+
+PyTypeObject g_executor_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "winc.Executor",         // tp_name
+  sizeof(ExecutorObject),  // tp_basicsize
+};
+
+int InitExecutorType() {
+  g_executor_type.tp_flags = Py_TPFLAGS_DEFAULT;
+  g_executor_type.tp_getset = executor_getset;
+  g_executor_type.tp_new = CreateExecutorObject;
+  g_executor_type.tp_dealloc = DeleteExecutorObject;
+  g_executor_type.tp_iter = IterExecutorObject;
+  g_executor_type.tp_iternext = IterNextExecutorObject;
+  if (PyType_Ready(&g_executor_type) < 0)
+    return -1;
+  return 0;
+}
+
+}
+
+}
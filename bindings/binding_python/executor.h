@@ -0,0 +1,34 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_BINDING_PYTHON_EXECUTOR_H_
+#define WINC_BINDING_PYTHON_EXECUTOR_H_
+
+#include <Python.h>
+#include <winc.h>
+
+namespace winc {
+
+namespace python {
+
+struct ContainerObject;
+
+struct ExecutorObject {
+  PyObject_HEAD
+  Executor executor;
+  // Reference to the container object
+  ContainerObject *container_object;
+  // Set while a thread is blocked for the next result
+  bool iterating;
+};
+
+int InitExecutorType();
+
+extern PyTypeObject g_executor_type;
+
+}
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "bindings/binding_python/fastcall.h"
+
+#include <Python.h>
+
+#ifdef WINC_PYTHON_FASTCALL
+
+namespace winc {
+
+namespace python {
+
+namespace {
+
+// Returns -1 if not found
+Py_ssize_t FindKeyword(PyObject *key, PyObject *const *names,
+                       Py_ssize_t count) {
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    if (key == names[i])
+      return i;
+  }
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    if (!PyUnicode_Compare(key, names[i]))
+      return i;
+  }
+  return -1;
+}
+
+}
+
+int InternKeywords(const char *const *names, Py_ssize_t count,
+                   PyObject **out_names) {
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    out_names[i] = PyUnicode_InternFromString(names[i]);
+    if (!out_names[i])
+      return -1;
+  }
+  return 0;
+}
+
+int ParseFastArgs(const char *function,
+                  PyObject *const *args, Py_ssize_t nargs,
+                  PyObject *kwnames,
+                  PyObject *const *names, Py_ssize_t count,
+                  Py_ssize_t required_count, PyObject **out_values) {
+  if (nargs > count) {
+    PyErr_Format(PyExc_TypeError,
+                 "%s() takes at most %zd arguments (%zd given)",
+                 function, count, nargs);
+    return -1;
+  }
+  for (Py_ssize_t i = 0; i < count; ++i)
+    out_values[i] = i < nargs ? args[i] : NULL;
+  Py_ssize_t kwcount = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+  for (Py_ssize_t i = 0; i < kwcount; ++i) {
+    PyObject *key = PyTuple_GET_ITEM(kwnames, i);
+    Py_ssize_t index = FindKeyword(key, names, count);
+    if (index < 0) {
+      PyErr_Format(PyExc_TypeError,
+                   "%s() got an unexpected keyword argument '%U'",
+                   function, key);
+      return -1;
+    }
+    if (out_values[index]) {
+      PyErr_Format(PyExc_TypeError,
+                   "%s() got multiple values for argument '%U'",
+                   function, key);
+      return -1;
+    }
+    out_values[index] = args[nargs + i];
+  }
+  for (Py_ssize_t i = 0; i < required_count; ++i) {
+    if (!out_values[i]) {
+      PyErr_Format(PyExc_TypeError,
+                   "%s() missing required argument '%U'",
+                   function, names[i]);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int GetWideString(PyObject *object, const char *name,
+                  unique_pywstr *out_string) {
+  if (!object) {
+    out_string->reset();
+    return 0;
+  }
+  if (!PyUnicode_Check(object)) {
+    PyErr_Format(PyExc_TypeError, "%s must be str", name);
+    return -1;
+  }
+  wchar_t *string = PyUnicode_AsWideCharString(object, NULL);
+  if (!string)
+    return -1;
+  out_string->reset(string);
+  return 0;
+}
+
+int GetUnsignedInt(PyObject *object, unsigned int *out_value) {
+  if (!object)
+    return 0;
+  if (PyFloat_Check(object)) {
+    PyErr_SetString(PyExc_TypeError, "integer argument expected, got float");
+    return -1;
+  }
+  unsigned long value = PyLong_AsUnsignedLongMask(object);
+  if (value == static_cast<unsigned long>(-1) && PyErr_Occurred())
+    return -1;
+  *out_value = static_cast<unsigned int>(value);
+  return 0;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_BINDING_PYTHON_FASTCALL_H_
+#define WINC_BINDING_PYTHON_FASTCALL_H_
+
+#include <Python.h>
+#include <memory>
+
+// The hot methods take METH_FASTCALL | METH_KEYWORDS on python 3.7+, which
+// passes the arguments as a vector and the keyword names as a tuple of
+// strings instead of building a tuple and a dict for every call
+#if PY_VERSION_HEX >= 0x03070000
+#define WINC_PYTHON_FASTCALL 1
+#endif
+
+#ifdef WINC_PYTHON_FASTCALL
+
+namespace winc {
+
+namespace python {
+
+struct PyMemDeleter {
+  void operator()(void *p) const {
+    PyMem_Free(p);
+  }
+};
+
+typedef std::unique_ptr<wchar_t, PyMemDeleter> unique_pywstr;
+
+// Interns the keyword names of a method, so that the keyword names of a
+// call, which are interned by the compiler, usually compare by identity
+int InternKeywords(const char *const *names, Py_ssize_t count,
+                   PyObject **out_names);
+
+// Matches the arguments of a fast call with the keyword names, the absent
+// arguments are set to NULL. The first required_count arguments must be
+// present. The values are borrowed references.
+int ParseFastArgs(const char *function,
+                  PyObject *const *args, Py_ssize_t nargs,
+                  PyObject *kwnames,
+                  PyObject *const *names, Py_ssize_t count,
+                  Py_ssize_t required_count, PyObject **out_values);
+
+// Copies an optional string argument, out_string is null if absent
+int GetWideString(PyObject *object, const char *name,
+                  unique_pywstr *out_string);
+
+// Converts an optional unsigned int argument with the truncation of the
+// "I" format, out_value is unchanged if absent
+int GetUnsignedInt(PyObject *object, unsigned int *out_value);
+
+}
+
+}
+
+#endif
+
+#endif
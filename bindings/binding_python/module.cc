@@ -7,6 +7,9 @@
 
 #include "bindings/binding_python/error.h"
 #include "bindings/binding_python/container.h"
+#include "bindings/binding_python/event_queue.h"
+#include "bindings/binding_python/executor.h"
+#include "bindings/binding_python/output.h"
 #include "bindings/binding_python/target.h"
 #include "bindings/binding_python/logon.h"
 #include "bindings/binding_python/sid.h"
@@ -45,6 +48,9 @@ PyMODINIT_FUNC initwinc() {
 #endif
   InitErrorClass();
   InitContainerType();
+  InitEventQueueType();
+  InitExecutorType();
+  InitOutputType();
   InitTargetType();
   InitLogonTypes();
   InitSidType();
@@ -59,9 +65,24 @@ PyMODINIT_FUNC initwinc() {
   Py_INCREF(&g_container_type);
   PyModule_AddObject(module, "Container",
                      reinterpret_cast<PyObject *>(&g_container_type));
+  Py_INCREF(&g_run_result_type);
+  PyModule_AddObject(module, "RunResult",
+                     reinterpret_cast<PyObject *>(&g_run_result_type));
+  Py_INCREF(&g_event_queue_type);
+  PyModule_AddObject(module, "EventQueue",
+                     reinterpret_cast<PyObject *>(&g_event_queue_type));
+  Py_INCREF(&g_executor_type);
+  PyModule_AddObject(module, "Executor",
+                     reinterpret_cast<PyObject *>(&g_executor_type));
+  Py_INCREF(&g_output_type);
+  PyModule_AddObject(module, "Output",
+                     reinterpret_cast<PyObject *>(&g_output_type));
   Py_INCREF(&g_target_type);
   PyModule_AddObject(module, "Target",
                      reinterpret_cast<PyObject *>(&g_target_type));
+  Py_INCREF(&g_process_record_type);
+  PyModule_AddObject(module, "ProcessRecord",
+                     reinterpret_cast<PyObject *>(&g_process_record_type));
   Py_INCREF(&g_logon_type);
   PyModule_AddObject(module, "Logon",
                      reinterpret_cast<PyObject *>(&g_logon_type));
@@ -82,6 +103,29 @@ PyMODINIT_FUNC initwinc() {
   PyModule_AddObject(module, "HIGH_INTEGRITY_LEVEL",
                      PyLong_FromUnsignedLong(SECURITY_MANDATORY_HIGH_RID));
 
+  PyModule_AddObject(module, "EVENT_ACTIVE_PROCESS_LIMIT",
+                     PyLong_FromLong(EVENT_ACTIVE_PROCESS_LIMIT));
+  PyModule_AddObject(module, "EVENT_EXIT_ALL",
+                     PyLong_FromLong(EVENT_EXIT_ALL));
+  PyModule_AddObject(module, "EVENT_NEW_PROCESS",
+                     PyLong_FromLong(EVENT_NEW_PROCESS));
+  PyModule_AddObject(module, "EVENT_EXIT_PROCESS",
+                     PyLong_FromLong(EVENT_EXIT_PROCESS));
+  PyModule_AddObject(module, "EVENT_MEMORY_LIMIT",
+                     PyLong_FromLong(EVENT_MEMORY_LIMIT));
+  PyModule_AddObject(module, "EVENT_MEMORY_THRESHOLD",
+                     PyLong_FromLong(EVENT_MEMORY_THRESHOLD));
+
+  PyModule_AddObject(module, "MITIGATION_WIN32K_SYSTEM_CALL_DISABLE",
+                     PyLong_FromUnsignedLongLong(
+                         PROCESS_CREATION_MITIGATION_POLICY_WIN32K_SYSTEM_CALL_DISABLE_ALWAYS_ON));
+  PyModule_AddObject(module, "MITIGATION_EXTENSION_POINT_DISABLE",
+                     PyLong_FromUnsignedLongLong(
+                         PROCESS_CREATION_MITIGATION_POLICY_EXTENSION_POINT_DISABLE_ALWAYS_ON));
+  PyModule_AddObject(module, "MITIGATION_STRICT_HANDLE_CHECKS",
+                     PyLong_FromUnsignedLongLong(
+                         PROCESS_CREATION_MITIGATION_POLICY_STRICT_HANDLE_CHECKS_ALWAYS_ON));
+
   BuildSidObject(module, "WinNullSid", WinNullSid);
   BuildSidObject(module, "WinWorldSid", WinWorldSid);
   BuildSidObject(module, "WinInteractiveSid", WinInteractiveSid);
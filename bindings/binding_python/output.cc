@@ -0,0 +1,92 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "bindings/binding_python/output.h"
+
+#include <Python.h>
+#include <winc.h>
+#include <memory>
+
+using std::shared_ptr;
+
+namespace winc {
+
+namespace python {
+
+namespace {
+
+void DeleteOutputObject(PyObject *self) {
+  OutputObject *oobj = reinterpret_cast<OutputObject *>(self);
+  oobj->output.~shared_ptr<CapturedOutput>();
+  Py_TYPE(self)->tp_free(self);
+}
+
+int GetBufferOutputObject(PyObject *self, Py_buffer *view, int flags) {
+  OutputObject *oobj = reinterpret_cast<OutputObject *>(self);
+  // The data of an empty output may be null
+  static char empty;
+  char *data = oobj->output->size() ?
+      const_cast<char *>(oobj->output->data()) : &empty;
+  return PyBuffer_FillInfo(view, self, data,
+                           static_cast<Py_ssize_t>(oobj->output->size()),
+                           1, flags);
+}
+
+Py_ssize_t LengthOutputObject(PyObject *self) {
+  OutputObject *oobj = reinterpret_cast<OutputObject *>(self);
+  return static_cast<Py_ssize_t>(oobj->output->size());
+}
+
+PyObject *GetTruncatedOutputObject(PyObject *self, void *closure) {
+  OutputObject *oobj = reinterpret_cast<OutputObject *>(self);
+  return PyBool_FromLong(oobj->output->truncated());
+}
+
+PyBufferProcs output_buffer_procs;
+
+PySequenceMethods output_sequence_methods;
+
+PyGetSetDef output_getset[] = {
+  {"truncated", GetTruncatedOutputObject, NULL},
+  {NULL}
+};
+
+}
+
+PyObject *NewOutputObject(const shared_ptr<CapturedOutput> &output) {
+  if (!output)
+    Py_RETURN_NONE;
+  OutputObject *oobj = PyObject_New(OutputObject, &g_output_type);
+  if (!oobj)
+    return NULL;
+  new (&oobj->output) shared_ptr<CapturedOutput>(output);
+  return reinterpret_cast<PyObject *>(oobj);
+}
+
+PyTypeObject g_output_type = {
+  PyVarObject_HEAD_INIT(NULL, 0)
+  "winc.Output",         // tp_name
+  sizeof(OutputObject),  // tp_basicsize
+};
+
+int InitOutputType() {
+  output_buffer_procs.bf_getbuffer = GetBufferOutputObject;
+  output_sequence_methods.sq_length = LengthOutputObject;
+#if PY_MAJOR_VERSION >= 3
+  g_output_type.tp_flags = Py_TPFLAGS_DEFAULT;
+#else
+  g_output_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+  g_output_type.tp_as_buffer = &output_buffer_procs;
+  g_output_type.tp_as_sequence = &output_sequence_methods;
+  g_output_type.tp_getset = output_getset;
+  g_output_type.tp_dealloc = DeleteOutputObject;
+  if (PyType_Ready(&g_output_type) < 0)
+    return -1;
+  return 0;
+}
+
+}
+
+}
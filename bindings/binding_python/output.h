@@ -0,0 +1,34 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_BINDING_PYTHON_OUTPUT_H_
+#define WINC_BINDING_PYTHON_OUTPUT_H_
+
+#include <Python.h>
+#include <winc.h>
+#include <memory>
+
+namespace winc {
+
+namespace python {
+
+// A captured stream exported through the buffer protocol without a copy,
+// the object keeps the native buffer alive
+struct OutputObject {
+  PyObject_HEAD
+  std::shared_ptr<CapturedOutput> output;
+};
+
+// Returns None for a null output
+PyObject *NewOutputObject(const std::shared_ptr<CapturedOutput> &output);
+
+int InitOutputType();
+
+extern PyTypeObject g_output_type;
+
+}
+
+}
+
+#endif
@@ -11,6 +11,7 @@
 
 #include "bindings/binding_python/error.h"
 
+using std::string;
 using std::wstring;
 
 namespace winc {
@@ -79,12 +80,8 @@ int InitSidObject(PyObject *self, PyObject *args, PyObject *kwds) {
 
 PyObject *StrSidObject(PyObject *self) {
   SidObject *sobj = reinterpret_cast<SidObject *>(self);
-  LPWSTR string_sid;
-  if (!::ConvertSidToStringSidW(sobj->sid.data(), &string_sid))
-    return PyErr_SetFromWindowsErr(::GetLastError());
-  PyObject *str = PyUnicode_FromWideChar(string_sid, wcslen(string_sid));
-  ::LocalFree(string_sid);
-  return str;
+  string string_sid = sobj->sid.Format();
+  return PyUnicode_FromStringAndSize(string_sid.data(), string_sid.size());
 }
 
 PyObject *ReprSidObject(PyObject *self) {
@@ -102,6 +99,13 @@ PyObject *ReprSidObject(PyObject *self) {
   return PyUnicode_FromWideChar(repr.data(), repr.size());
 }
 
+Py_hash_t HashSidObject(PyObject *self) {
+  SidObject *sobj = reinterpret_cast<SidObject *>(self);
+  Py_hash_t hash = static_cast<Py_hash_t>(sobj->sid.Hash());
+  // -1 is reserved for errors
+  return hash == -1 ? -2 : hash;
+}
+
 PyObject *CompareSidObject(PyObject *obj1, PyObject *obj2, int op) {
   SidObject *sobj1 = reinterpret_cast<SidObject *>(obj1);
   SidObject *sobj2 = reinterpret_cast<SidObject *>(obj2);
@@ -138,6 +142,7 @@ int InitSidType() {
   g_sid_type.tp_init = InitSidObject;
   g_sid_type.tp_str = StrSidObject;
   g_sid_type.tp_repr = ReprSidObject;
+  g_sid_type.tp_hash = HashSidObject;
   g_sid_type.tp_richcompare = CompareSidObject;
   if (PyType_Ready(&g_sid_type) < 0)
     return -1;
@@ -6,8 +6,13 @@
 
 #include <Python.h>
 #include <winc.h>
+#include <vector>
 
 #include "bindings/binding_python/error.h"
+#include "bindings/binding_python/event_queue.h"
+#include "bindings/binding_python/fastcall.h"
+
+using std::vector;
 
 namespace winc {
 
@@ -23,6 +28,7 @@ PyObject *CreateTargetObject(PyTypeObject *subtype,
   TargetObject *tobj = reinterpret_cast<TargetObject *>(obj);
   new (&tobj->target) TargetDirector;
   tobj->container_object = NULL;
+  tobj->event_queue = NULL;
   return obj;
 }
 
@@ -32,19 +38,30 @@ void DeleteTargetObject(PyObject *self) {
   tobj->target.~TargetDirector();
   Py_END_ALLOW_THREADS
   Py_XDECREF(tobj->container_object);
+  Py_XDECREF(tobj->event_queue);
   Py_TYPE(self)->tp_free(self);
 }
 
-PyObject *StartTargetObject(PyObject *self, PyObject *args) {
+PyObject *Start(PyObject *self, PyObject *event_queue) {
   TargetObject *tobj = reinterpret_cast<TargetObject *>(self);
+  if (tobj->event_queue) {
+    PyErr_SetString(g_error_class, "target already started");
+    return NULL;
+  }
+  if (event_queue) {
+    Py_INCREF(event_queue);
+    tobj->event_queue = reinterpret_cast<EventQueueObject *>(event_queue);
+  } else {
+    PyEval_InitThreads();
+  }
   // The event dispatcher owns the target object
   Py_INCREF(self);
-  PyEval_InitThreads();
   ResultCode rc;
   Py_BEGIN_ALLOW_THREADS
   rc = tobj->target.Start(true);
   Py_END_ALLOW_THREADS
   if (rc != WINC_OK) {
+    Py_CLEAR(tobj->event_queue);
     Py_DECREF(self);
     return SetErrorFromResultCode(rc);
   }
@@ -52,11 +69,8 @@ PyObject *StartTargetObject(PyObject *self, PyObject *args) {
   return self;
 }
 
-PyObject *WaitForProcessTargetObject(PyObject *self, PyObject *args) {
+PyObject *WaitForProcess(PyObject *self, unsigned int timeout_ms) {
   TargetObject *tobj = reinterpret_cast<TargetObject *>(self);
-  unsigned int timeout_ms = INFINITE;
-  if (!PyArg_ParseTuple(args, "|I", &timeout_ms))
-    return NULL;
   bool timeouted;
   ResultCode rc;
   Py_BEGIN_ALLOW_THREADS
@@ -70,11 +84,8 @@ PyObject *WaitForProcessTargetObject(PyObject *self, PyObject *args) {
     Py_RETURN_FALSE;
 }
 
-PyObject *TerminateJobTargetObject(PyObject *self, PyObject *args) {
+PyObject *TerminateJob(PyObject *self, unsigned int exit_code) {
   TargetObject *tobj = reinterpret_cast<TargetObject *>(self);
-  unsigned int exit_code = 0;
-  if (!PyArg_ParseTuple(args, "|I", &exit_code))
-    return NULL;
   ResultCode rc = tobj->target.TerminateJob(exit_code);
   if (rc != WINC_OK)
     return SetErrorFromResultCode(rc);
@@ -82,6 +93,111 @@ PyObject *TerminateJobTargetObject(PyObject *self, PyObject *args) {
   return self;
 }
 
+// Takes a sequence of the thresholds in bytes, strictly ascending
+PyObject *SetMemoryThresholdsTargetObject(PyObject *self, PyObject *arg) {
+  TargetObject *tobj = reinterpret_cast<TargetObject *>(self);
+  PyObject *seq = PySequence_Fast(arg, "thresholds must be a sequence");
+  if (!seq)
+    return NULL;
+  Py_ssize_t count = PySequence_Fast_GET_SIZE(seq);
+  vector<SIZE_T> thresholds(count);
+  for (Py_ssize_t i = 0; i < count; ++i) {
+    PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+#if PY_MAJOR_VERSION >= 3
+    if (!PyLong_Check(item)) {
+#else
+    if (!PyInt_Check(item) && !PyLong_Check(item)) {
+#endif
+      Py_DECREF(seq);
+      PyErr_SetString(PyExc_TypeError, "integer expected");
+      return NULL;
+    }
+    void *ptr_val = PyLong_AsVoidPtr(item);
+    if (!ptr_val && PyErr_Occurred()) {
+      Py_DECREF(seq);
+      return NULL;
+    }
+    thresholds[i] = reinterpret_cast<uintptr_t>(ptr_val);
+  }
+  Py_DECREF(seq);
+  ResultCode rc = tobj->target.SetMemoryThresholds(thresholds.data(),
+                                                   thresholds.size());
+  if (rc != WINC_OK)
+    return SetErrorFromResultCode(rc);
+  Py_INCREF(self);
+  return self;
+}
+
+#ifdef WINC_PYTHON_FASTCALL
+
+const char *const start_keywords[] = {"event_queue"};
+const char *const wait_for_process_keywords[] = {"timeout"};
+const char *const terminate_job_keywords[] = {"exit_code"};
+
+PyObject *start_kwnames[ARRAYSIZE(start_keywords)];
+PyObject *wait_for_process_kwnames[ARRAYSIZE(wait_for_process_keywords)];
+PyObject *terminate_job_kwnames[ARRAYSIZE(terminate_job_keywords)];
+
+PyObject *StartTargetObject(PyObject *self, PyObject *const *args,
+                            Py_ssize_t nargs, PyObject *kwnames) {
+  PyObject *event_queue;
+  if (ParseFastArgs("start", args, nargs, kwnames, start_kwnames, 1, 0,
+                    &event_queue) < 0)
+    return NULL;
+  if (event_queue && !PyObject_TypeCheck(event_queue, &g_event_queue_type)) {
+    PyErr_SetString(PyExc_TypeError, "event_queue must be winc.EventQueue");
+    return NULL;
+  }
+  return Start(self, event_queue);
+}
+
+PyObject *WaitForProcessTargetObject(PyObject *self, PyObject *const *args,
+                                     Py_ssize_t nargs, PyObject *kwnames) {
+  PyObject *timeout;
+  unsigned int timeout_ms = INFINITE;
+  if (ParseFastArgs("wait_for_process", args, nargs, kwnames,
+                    wait_for_process_kwnames, 1, 0, &timeout) < 0 ||
+      GetUnsignedInt(timeout, &timeout_ms) < 0)
+    return NULL;
+  return WaitForProcess(self, timeout_ms);
+}
+
+PyObject *TerminateJobTargetObject(PyObject *self, PyObject *const *args,
+                                   Py_ssize_t nargs, PyObject *kwnames) {
+  PyObject *exit_code_object;
+  unsigned int exit_code = 0;
+  if (ParseFastArgs("terminate_job", args, nargs, kwnames,
+                    terminate_job_kwnames, 1, 0, &exit_code_object) < 0 ||
+      GetUnsignedInt(exit_code_object, &exit_code) < 0)
+    return NULL;
+  return TerminateJob(self, exit_code);
+}
+
+#else
+
+PyObject *StartTargetObject(PyObject *self, PyObject *args) {
+  PyObject *event_queue = NULL;
+  if (!PyArg_ParseTuple(args, "|O!", &g_event_queue_type, &event_queue))
+    return NULL;
+  return Start(self, event_queue);
+}
+
+PyObject *WaitForProcessTargetObject(PyObject *self, PyObject *args) {
+  unsigned int timeout_ms = INFINITE;
+  if (!PyArg_ParseTuple(args, "|I", &timeout_ms))
+    return NULL;
+  return WaitForProcess(self, timeout_ms);
+}
+
+PyObject *TerminateJobTargetObject(PyObject *self, PyObject *args) {
+  unsigned int exit_code = 0;
+  if (!PyArg_ParseTuple(args, "|I", &exit_code))
+    return NULL;
+  return TerminateJob(self, exit_code);
+}
+
+#endif
+
 PyObject *GetProcessIdTargetObject(PyObject *self, void *closure) {
   TargetObject *tobj = reinterpret_cast<TargetObject *>(self);
   return PyLong_FromUnsignedLong(tobj->target.process_id());
@@ -141,13 +257,105 @@ PyObject *GetProcessExitCodeTargetObject(PyObject *self, void *closure) {
   return PyLong_FromUnsignedLong(exit_code);
 }
 
+PyStructSequence_Field process_record_fields[] = {
+  {"process_id"},
+  {"parent_process_id"},
+  {"creation_time", "in 100 nanoseconds since 1601"},
+  {"exit_time", "in 100 nanoseconds since 1601"},
+  {"user_time", "in 100 nanoseconds"},
+  {"kernel_time", "in 100 nanoseconds"},
+  {"peak_memory", "in bytes"},
+  {"exit_code"},
+  {"exited"},
+  {"lost", "the process could not be opened, only the ID is known"},
+  {NULL}
+};
+
+PyStructSequence_Desc process_record_desc = {
+  "winc.ProcessRecord",  // name
+  NULL,                  // doc
+  process_record_fields,
+  10                     // n_in_sequence
+};
+
+PyObject *NewProcessRecordObject(const ProcessRecord &record) {
+  PyObject *robj = PyStructSequence_New(&g_process_record_type);
+  if (!robj)
+    return NULL;
+  PyStructSequence_SET_ITEM(robj, 0,
+                            PyLong_FromUnsignedLong(record.process_id));
+  PyStructSequence_SET_ITEM(robj, 1,
+                            PyLong_FromUnsignedLong(record.parent_process_id));
+  PyStructSequence_SET_ITEM(robj, 2,
+                            PyLong_FromUnsignedLongLong(record.creation_time));
+  PyStructSequence_SET_ITEM(robj, 3,
+                            PyLong_FromUnsignedLongLong(record.exit_time));
+  PyStructSequence_SET_ITEM(robj, 4,
+                            PyLong_FromUnsignedLongLong(record.user_time));
+  PyStructSequence_SET_ITEM(robj, 5,
+                            PyLong_FromUnsignedLongLong(record.kernel_time));
+  PyStructSequence_SET_ITEM(robj, 6, PyLong_FromSize_t(record.peak_memory));
+  PyStructSequence_SET_ITEM(robj, 7,
+                            PyLong_FromUnsignedLong(record.exit_code));
+  PyStructSequence_SET_ITEM(robj, 8, PyBool_FromLong(record.exited));
+  PyStructSequence_SET_ITEM(robj, 9, PyBool_FromLong(record.lost));
+  for (Py_ssize_t i = 0; i < 10; ++i) {
+    if (!PyStructSequence_GET_ITEM(robj, i)) {
+      Py_DECREF(robj);
+      return NULL;
+    }
+  }
+  return robj;
+}
+
+PyObject *GetProcessTableTargetObject(PyObject *self, void *closure) {
+  TargetObject *tobj = reinterpret_cast<TargetObject *>(self);
+  vector<ProcessRecord> table;
+  ResultCode rc = tobj->target.GetProcessTable(&table);
+  if (rc != WINC_OK)
+    return SetErrorFromResultCode(rc);
+  PyObject *tuple = PyTuple_New(table.size());
+  if (!tuple)
+    return NULL;
+  for (size_t index = 0; index < table.size(); ++index) {
+    PyObject *robj = NewProcessRecordObject(table[index]);
+    if (!robj) {
+      Py_DECREF(tuple);
+      return NULL;
+    }
+    PyTuple_SET_ITEM(tuple, index, robj);
+  }
+  return tuple;
+}
+
+#ifdef WINC_PYTHON_FASTCALL
+
+PyMethodDef target_methods[] = {
+  {"start",
+   reinterpret_cast<PyCFunction>(StartTargetObject),
+   METH_FASTCALL | METH_KEYWORDS},
+  {"wait_for_process",
+   reinterpret_cast<PyCFunction>(WaitForProcessTargetObject),
+   METH_FASTCALL | METH_KEYWORDS},
+  {"terminate_job",
+   reinterpret_cast<PyCFunction>(TerminateJobTargetObject),
+   METH_FASTCALL | METH_KEYWORDS},
+  {"set_memory_thresholds", SetMemoryThresholdsTargetObject, METH_O},
+  {NULL}
+};
+
+#else
+
 PyMethodDef target_methods[] = {
-  {"start",            StartTargetObject,          METH_NOARGS},
-  {"wait_for_process", WaitForProcessTargetObject, METH_VARARGS},
-  {"terminate_job",    TerminateJobTargetObject,   METH_VARARGS},
+  {"start",                 StartTargetObject,               METH_VARARGS},
+  {"wait_for_process",      WaitForProcessTargetObject,      METH_VARARGS},
+  {"terminate_job",         TerminateJobTargetObject,        METH_VARARGS},
+  {"set_memory_thresholds", SetMemoryThresholdsTargetObject, METH_O},
   {NULL}
 };
 
+#endif
+
 PyGetSetDef target_getset[] = {
   {"process_id",          GetProcessIdTargetObject,         NULL},
   {"job_time",            GetJobTimeTargetObject,           NULL},
@@ -156,6 +364,7 @@ PyGetSetDef target_getset[] = {
   {"job_peak_memory",     GetJobPeakMemoryTargetObject,     NULL},
   {"process_peak_memory", GetProcessPeakMemoryTargetObject, NULL},
   {"process_exit_code",   GetProcessExitCodeTargetObject,   NULL},
+  {"process_table",       GetProcessTableTargetObject,      NULL},
   {NULL}
 };
 
@@ -163,6 +372,10 @@ PyGetSetDef target_getset[] = {
 
 void TargetDirector::OnActiveProcessLimit() {
   TargetObject *tobj = CONTAINING_RECORD(this, TargetObject, target);
+  if (tobj->event_queue) {
+    PushEvent(tobj->event_queue, tobj, EVENT_ACTIVE_PROCESS_LIMIT, 0);
+    return;
+  }
   PyGILState_STATE gstate = PyGILState_Ensure();
   if (!PyObject_CallMethod(reinterpret_cast<PyObject *>(tobj),
                            "on_active_process_limit", NULL))
@@ -172,6 +385,10 @@ void TargetDirector::OnActiveProcessLimit() {
 
 void TargetDirector::OnExitAll() {
   TargetObject *tobj = CONTAINING_RECORD(this, TargetObject, target);
+  if (tobj->event_queue) {
+    PushEvent(tobj->event_queue, tobj, EVENT_EXIT_ALL, 0);
+    return;
+  }
   PyGILState_STATE gstate = PyGILState_Ensure();
   if (!PyObject_CallMethod(reinterpret_cast<PyObject *>(tobj),
                            "on_exit_all", NULL))
@@ -183,6 +400,10 @@ void TargetDirector::OnExitAll() {
 
 void TargetDirector::OnNewProcess(DWORD process_id) {
   TargetObject *tobj = CONTAINING_RECORD(this, TargetObject, target);
+  if (tobj->event_queue) {
+    PushEvent(tobj->event_queue, tobj, EVENT_NEW_PROCESS, process_id);
+    return;
+  }
   PyGILState_STATE gstate = PyGILState_Ensure();
   if (!PyObject_CallMethod(reinterpret_cast<PyObject *>(tobj),
                            "on_new_process", "I", process_id))
@@ -192,6 +413,10 @@ void TargetDirector::OnNewProcess(DWORD process_id) {
 
 void TargetDirector::OnExitProcess(DWORD process_id) {
   TargetObject *tobj = CONTAINING_RECORD(this, TargetObject, target);
+  if (tobj->event_queue) {
+    PushEvent(tobj->event_queue, tobj, EVENT_EXIT_PROCESS, process_id);
+    return;
+  }
   PyGILState_STATE gstate = PyGILState_Ensure();
   if (!PyObject_CallMethod(reinterpret_cast<PyObject *>(tobj),
                            "on_exit_process", "I", process_id))
@@ -201,6 +426,10 @@ void TargetDirector::OnExitProcess(DWORD process_id) {
 
 void TargetDirector::OnMemoryLimit(DWORD process_id) {
   TargetObject *tobj = CONTAINING_RECORD(this, TargetObject, target);
+  if (tobj->event_queue) {
+    PushEvent(tobj->event_queue, tobj, EVENT_MEMORY_LIMIT, process_id);
+    return;
+  }
   PyGILState_STATE gstate = PyGILState_Ensure();
   if (!PyObject_CallMethod(reinterpret_cast<PyObject *>(tobj),
                            "on_memory_limit", "I", process_id))
@@ -208,13 +437,41 @@ void TargetDirector::OnMemoryLimit(DWORD process_id) {
   PyGILState_Release(gstate);
 }
 
+void TargetDirector::OnMemoryThreshold(unsigned int level, SIZE_T bytes) {
+  TargetObject *tobj = CONTAINING_RECORD(this, TargetObject, target);
+  if (tobj->event_queue) {
+    PushEvent(tobj->event_queue, tobj, EVENT_MEMORY_THRESHOLD, 0, level,
+              bytes);
+    return;
+  }
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  if (!PyObject_CallMethod(reinterpret_cast<PyObject *>(tobj),
+                           "on_memory_threshold", "IK", level,
+                           static_cast<unsigned long long>(bytes)))
+    PyErr_Clear();
+  PyGILState_Release(gstate);
+}
+
 PyTypeObject g_target_type = {
   PyVarObject_HEAD_INIT(NULL, 0)
   "winc.Target",        // tp_name
   sizeof(TargetObject), // tp_basicsize
 };
 
+PyTypeObject g_process_record_type;
+
 int InitTargetType() {
+#ifdef WINC_PYTHON_FASTCALL
+  if (InternKeywords(start_keywords, ARRAYSIZE(start_keywords),
+                     start_kwnames) < 0 ||
+      InternKeywords(wait_for_process_keywords,
+                     ARRAYSIZE(wait_for_process_keywords),
+                     wait_for_process_kwnames) < 0 ||
+      InternKeywords(terminate_job_keywords,
+                     ARRAYSIZE(terminate_job_keywords),
+                     terminate_job_kwnames) < 0)
+    return -1;
+#endif
   g_target_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
   g_target_type.tp_methods = target_methods;
   g_target_type.tp_getset = target_getset;
@@ -222,6 +479,7 @@ int InitTargetType() {
   g_target_type.tp_dealloc = DeleteTargetObject;
   if (PyType_Ready(&g_target_type) < 0)
     return -1;
+  PyStructSequence_InitType(&g_process_record_type, &process_record_desc);
   return 0;
 }
 
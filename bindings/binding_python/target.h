@@ -13,6 +13,7 @@ namespace winc {
 namespace python {
 
 struct ContainerObject;
+struct EventQueueObject;
 
 class TargetDirector : public Target {
 protected:
@@ -21,6 +22,7 @@ protected:
   virtual void OnNewProcess(DWORD process_id) override;
   virtual void OnExitProcess(DWORD process_id) override;
   virtual void OnMemoryLimit(DWORD process_id) override;
+  virtual void OnMemoryThreshold(unsigned int level, SIZE_T bytes) override;
 };
 
 struct TargetObject {
@@ -28,11 +30,15 @@ struct TargetObject {
   TargetDirector target;
   // Reference to the container object
   ContainerObject *container_object;
+  // Reference to the event queue if started with one, the events are
+  // pushed to the queue instead of calling the methods of the object
+  EventQueueObject *event_queue;
 };
 
 int InitTargetType();
 
 extern PyTypeObject g_target_type;
+extern PyTypeObject g_process_record_type;
 
 }
 
@@ -0,0 +1,121 @@
+"""asyncio integration of the winc module.
+
+Targets started by start() deliver their events through a winc.EventQueue
+shared by all of the targets of a loop. The event dispatcher pushes the
+events without taking the GIL and signals the socket of the queue, which
+the loop drains in batches, so no thread is used per target. The loop
+must support add_reader, e.g. asyncio.SelectorEventLoop on Windows.
+
+    target = winc_aio.start(container.spawn(exe))
+    async for event in target.events():
+        print(event.type, event.process_id)
+    await target.wait()
+"""
+
+import asyncio
+import collections
+import weakref
+
+import winc
+
+# The level and the bytes are only set by the memory threshold event
+Event = collections.namedtuple('Event',
+                               ['type', 'process_id', 'level', 'bytes'])
+
+
+class AsyncTarget(object):
+    """A started target with its events delivered to the loop."""
+
+    def __init__(self, target, loop):
+        self.target = target
+        self._loop = loop
+        self._events = collections.deque()
+        self._waiter = None
+        self._exited = loop.create_future()
+
+    def _push(self, event):
+        self._events.append(event)
+        if self._waiter is not None and not self._waiter.done():
+            self._waiter.set_result(None)
+        if event.type == winc.EVENT_EXIT_ALL:
+            self._exited.set_result(None)
+
+    async def wait(self):
+        """Waits until all processes of the target exit."""
+        await asyncio.shield(self._exited)
+        return self.target
+
+    def events(self):
+        """Iterates over the events, ending with the exit all event.
+
+        The events are buffered from the start, so only one iteration may
+        be active at a time.
+        """
+        return _EventIterator(self)
+
+
+class _EventIterator(object):
+
+    def __init__(self, target):
+        self._target = target
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self):
+        target = self._target
+        while not target._events:
+            if target._exited.done():
+                raise StopAsyncIteration
+            target._waiter = target._loop.create_future()
+            await target._waiter
+        return target._events.popleft()
+
+
+class _Dispatcher(object):
+    """The event queue of a loop and the targets started with it."""
+
+    def __init__(self, loop):
+        self._queue = winc.EventQueue()
+        self._targets = {}
+        loop.add_reader(self._queue.fileno(), self._drain)
+
+    def start(self, target, loop):
+        async_target = AsyncTarget(target, loop)
+        # Events are only drained on the loop, so registering before the
+        # start does not race with the delivery
+        self._targets[target] = async_target
+        try:
+            target.start(self._queue)
+        except:
+            del self._targets[target]
+            raise
+        return async_target
+
+    def _drain(self):
+        for (target, event_type, process_id,
+             level, size) in self._queue.drain():
+            async_target = self._targets.get(target)
+            if async_target is None:
+                continue
+            if event_type == winc.EVENT_EXIT_ALL:
+                del self._targets[target]
+            async_target._push(Event(event_type, process_id, level, size))
+
+
+_dispatchers = weakref.WeakKeyDictionary()
+
+
+def start(target, loop=None):
+    """Starts a spawned target and returns its AsyncTarget.
+
+    The on_* methods of the target are not called, the events are
+    delivered to the returned object instead.
+    """
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    dispatcher = _dispatchers.get(loop)
+    if dispatcher is None:
+        dispatcher = _Dispatcher(loop)
+        _dispatchers[loop] = dispatcher
+    return dispatcher.start(target, loop)
@@ -0,0 +1,152 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <winc/command_line.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace winc {
+
+namespace {
+
+// Counts the characters in the size pass
+class CountingSink {
+public:
+  CountingSink()
+    : count_(0)
+    {}
+
+  void Put(wchar_t) {
+    ++count_;
+  }
+
+  void Repeat(wchar_t, size_t n) {
+    count_ += n;
+  }
+
+  size_t count() const {
+    return count_;
+  }
+
+private:
+  size_t count_;
+};
+
+// Writes the characters in the write pass
+class WritingSink {
+public:
+  explicit WritingSink(wchar_t *buffer)
+    : begin_(buffer)
+    , p_(buffer)
+    {}
+
+  void Put(wchar_t c) {
+    *p_++ = c;
+  }
+
+  void Repeat(wchar_t c, size_t n) {
+    for (; n; --n)
+      *p_++ = c;
+  }
+
+  size_t count() const {
+    return p_ - begin_;
+  }
+
+private:
+  wchar_t *begin_;
+  wchar_t *p_;
+};
+
+bool HasAny(const wchar_t *arg, const wchar_t *chars) {
+  for (; *arg; ++arg) {
+    for (const wchar_t *c = chars; *c; ++c) {
+      if (*arg == *c)
+        return true;
+    }
+  }
+  return false;
+}
+
+// The program name ends at the next whitespace, or at the closing quote if
+// it starts with one
+template <typename Sink>
+void EmitProgramName(const wchar_t *arg, Sink *sink) {
+  bool quoted = !*arg || HasAny(arg, L" \t");
+  if (quoted)
+    sink->Put(L'"');
+  for (; *arg; ++arg) {
+    if (*arg != L'"')
+      sink->Put(*arg);
+  }
+  if (quoted)
+    sink->Put(L'"');
+}
+
+template <typename Sink>
+void EmitArgument(const wchar_t *arg, Sink *sink) {
+  if (*arg && !HasAny(arg, L" \t\n\v\"")) {
+    for (; *arg; ++arg)
+      sink->Put(*arg);
+    return;
+  }
+  sink->Put(L'"');
+  for (;;) {
+    size_t backslashes = 0;
+    while (*arg == L'\\') {
+      ++backslashes;
+      ++arg;
+    }
+    if (!*arg) {
+      // Before the closing quote
+      sink->Repeat(L'\\', backslashes * 2);
+      break;
+    }
+    if (*arg == L'"') {
+      sink->Repeat(L'\\', backslashes * 2 + 1);
+    } else {
+      sink->Repeat(L'\\', backslashes);
+    }
+    sink->Put(*arg++);
+  }
+  sink->Put(L'"');
+}
+
+template <typename Sink>
+void Emit(const wchar_t *const *argv, size_t argc, Sink *sink) {
+  for (size_t i = 0; i < argc; ++i) {
+    if (i) {
+      sink->Put(L' ');
+      EmitArgument(argv[i], sink);
+    } else {
+      EmitProgramName(argv[i], sink);
+    }
+  }
+}
+
+}
+
+size_t CommandLineBuilder::ComputeSize(const wchar_t *const *argv,
+                                       size_t argc) {
+  CountingSink sink;
+  Emit(argv, argc, &sink);
+  return sink.count() + 1;
+}
+
+size_t CommandLineBuilder::Write(const wchar_t *const *argv, size_t argc,
+                                 wchar_t *buffer) {
+  WritingSink sink(buffer);
+  Emit(argv, argc, &sink);
+  size_t size = sink.count();
+  buffer[size] = L'\0';
+  return size;
+}
+
+void CommandLineBuilder::Build(const wchar_t *const *argv, size_t argc) {
+  buffer_.reset(new wchar_t[ComputeSize(argv, argc)]);
+  size_ = Write(argv, argc, buffer_.get());
+}
+
+}
@@ -8,13 +8,17 @@
 #include <memory>
 
 #include <winc_types.h>
+#include <winc/command_line.h>
+#include <winc/core_allocator.h>
 #include <winc/desktop.h>
+#include <winc/environment.h>
 #include <winc/logon.h>
 #include <winc/policy.h>
 #include <winc/target.h>
 #include <winc/util.h>
-#include "core/ntnative.h"
 #include "core/job_object.h"
+#include "core/output_reader.h"
+#include "core/platform.h"
 
 using std::make_unique;
 using std::shared_ptr;
@@ -22,11 +26,67 @@ using std::unique_ptr;
 
 namespace winc {
 
+namespace {
+
+// Returns the leased core to the allocator unless it is handed to a target
+class CoreLeaseHolder {
+public:
+  CoreLeaseHolder()
+    : affinity_(0)
+    {}
+
+  ~CoreLeaseHolder() {
+    if (affinity_)
+      allocator_->Release(affinity_);
+  }
+
+  ResultCode Lease(const shared_ptr<CoreAllocator> &allocator) {
+    ResultCode rc = allocator->Lease(&affinity_);
+    if (rc != WINC_OK)
+      return rc;
+    allocator_ = allocator;
+    return WINC_OK;
+  }
+
+  uintptr_t affinity() const {
+    return affinity_;
+  }
+
+  const shared_ptr<CoreAllocator> &allocator() const {
+    return allocator_;
+  }
+
+  uintptr_t release() {
+    uintptr_t affinity = affinity_;
+    affinity_ = 0;
+    return affinity;
+  }
+
+private:
+  shared_ptr<CoreAllocator> allocator_;
+  uintptr_t affinity_;
+};
+
+}
+
+Container::Container() {
+  ::InitializeSRWLock(&lock_);
+}
+
 ResultCode Container::Spawn(const wchar_t *exe_path,
                             Target *target,
                             SpawnOptions *options) {
+  ::AcquireSRWLockExclusive(&lock_);
+  ResultCode rc = SpawnLocked(exe_path, target, options);
+  ::ReleaseSRWLockExclusive(&lock_);
+  return rc;
+}
+
+ResultCode Container::SpawnLocked(const wchar_t *exe_path,
+                                  Target *target,
+                                  SpawnOptions *options) {
   Policy *policy;
-  ResultCode rc = GetPolicy(&policy);
+  ResultCode rc = GetPolicyLocked(&policy);
   if (rc != WINC_OK)
     return rc;
 
@@ -40,7 +100,8 @@ ResultCode Container::Spawn(const wchar_t *exe_path,
   si.StartupInfo.dwFlags = STARTF_FORCEOFFFEEDBACK;
 
   Desktop *desktop;
-  rc = policy->GetDesktop(&desktop);
+  shared_ptr<AlternateDesktop> desktop_lease;
+  rc = policy->GetDesktop(&desktop, &desktop_lease);
   if (rc != WINC_OK)
     return rc;
   if (!desktop->IsDefaultDesktop()) {
@@ -60,30 +121,49 @@ ResultCode Container::Spawn(const wchar_t *exe_path,
   ProcThreadAttributeList attribute_list;
   HANDLE inherit_list[3];
   SIZE_T inherit_count = 0;
+  CoreLeaseHolder core_lease;
+  uintptr_t processor_affinity = 0;
+  uintptr_t memory_limit = policy->default_memory_limit();
+  uint32_t active_process_limit = policy->default_active_process_limit();
   if (options) {
-    if (options->processor_affinity ||
-        options->memory_limit ||
-        options->active_process_limit) {
-      JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit;
-      rc = job_object->GetBasicLimit(&limit);
+    processor_affinity = options->processor_affinity;
+    if (options->auto_affinity) {
+      shared_ptr<CoreAllocator> core_allocator;
+      rc = GetCoreAllocatorLocked(&core_allocator);
       if (rc != WINC_OK)
         return rc;
-      if (options->processor_affinity) {
-        limit.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_AFFINITY;
-        limit.BasicLimitInformation.Affinity = options->processor_affinity;
-      }
-      if (options->memory_limit) {
-        limit.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
-        limit.JobMemoryLimit = options->memory_limit;
-      }
-      if (options->active_process_limit) {
-        limit.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_ACTIVE_PROCESS;
-        limit.BasicLimitInformation.ActiveProcessLimit = options->active_process_limit;
-      }
-      rc = job_object->SetBasicLimit(limit);
+      rc = core_lease.Lease(core_allocator);
       if (rc != WINC_OK)
         return rc;
+      processor_affinity = core_lease.affinity();
     }
+    if (options->memory_limit)
+      memory_limit = options->memory_limit;
+    if (options->active_process_limit)
+      active_process_limit = options->active_process_limit;
+  }
+  if (processor_affinity || memory_limit || active_process_limit) {
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit;
+    rc = job_object->GetBasicLimit(&limit);
+    if (rc != WINC_OK)
+      return rc;
+    if (processor_affinity) {
+      limit.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_AFFINITY;
+      limit.BasicLimitInformation.Affinity = processor_affinity;
+    }
+    if (memory_limit) {
+      limit.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+      limit.JobMemoryLimit = memory_limit;
+    }
+    if (active_process_limit) {
+      limit.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_ACTIVE_PROCESS;
+      limit.BasicLimitInformation.ActiveProcessLimit = active_process_limit;
+    }
+    rc = job_object->SetBasicLimit(limit);
+    if (rc != WINC_OK)
+      return rc;
+  }
+  if (options) {
     if (options->stdin_handle) {
       si.StartupInfo.dwFlags |= STARTF_USESTDHANDLES;
       si.StartupInfo.hStdInput = options->stdin_handle;
@@ -99,25 +179,71 @@ ResultCode Container::Spawn(const wchar_t *exe_path,
       si.StartupInfo.hStdError = options->stderr_handle;
       inherit_list[inherit_count++] = options->stderr_handle;
     }
+  }
+
+  // The mitigation policy is kept as a ready-to-use attribute value in the
+  // policy, so applying it costs a single attribute update per spawn
+  DWORD64 mitigation_policy = policy->mitigation_policy();
+  DWORD attribute_count = (inherit_count ? 1 : 0) + (mitigation_policy ? 1 : 0);
+  DWORD creation_flags = CREATE_BREAKAWAY_FROM_JOB | CREATE_SUSPENDED;
+  if (attribute_count) {
+    rc = attribute_list.Init(attribute_count, 0);
+    if (rc != WINC_OK)
+      return rc;
     if (inherit_count) {
-      rc = attribute_list.Init(1, 0);
-      if (rc != WINC_OK)
-        return rc;
       rc = attribute_list.Update(0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
                                  inherit_list, inherit_count * sizeof(HANDLE));
       if (rc != WINC_OK)
         return rc;
-      si.lpAttributeList = attribute_list.data();
     }
+    if (mitigation_policy) {
+      rc = attribute_list.Update(0, PROC_THREAD_ATTRIBUTE_MITIGATION_POLICY,
+                                 &mitigation_policy, sizeof(mitigation_policy));
+      if (rc != WINC_OK)
+        return rc;
+    }
+    si.lpAttributeList = attribute_list.data();
+    creation_flags |= EXTENDED_STARTUPINFO_PRESENT;
   }
 
+  const wchar_t *environment = nullptr;
+  shared_ptr<const EnvironmentBlock> base_environment = policy->environment();
+  if (options && options->environment_override_count) {
+    if (!base_environment) {
+      if (!process_environment_) {
+        rc = EnvironmentBlock::FromCurrentProcess(&process_environment_);
+        if (rc != WINC_OK)
+          return rc;
+      }
+      base_environment = process_environment_;
+    }
+    rc = base_environment->Merge(options->environment_overrides,
+                                 options->environment_override_count,
+                                 &environment_arena_);
+    if (rc != WINC_OK)
+      return rc;
+    environment = environment_arena_.data();
+  } else if (base_environment) {
+    environment = base_environment->data();
+  }
+  if (environment)
+    creation_flags |= CREATE_UNICODE_ENVIRONMENT;
+
+  wchar_t *command_line = options ? options->command_line : NULL;
+  CommandLineBuilder command_line_builder;
+  if (options && options->argv) {
+    command_line_builder.Build(options->argv, options->argc);
+    command_line = command_line_builder.command_line();
+  }
+
+  Platform *platform = Platform::Get();
   PROCESS_INFORMATION pi;
-  BOOL success = ::CreateProcessAsUserW(restricted_token,
+  BOOL success = platform->CreateUserProcess(restricted_token,
     exe_path,
-    options ? options->command_line : NULL,
-    NULL, NULL, inherit_count ? TRUE : FALSE,
-    CREATE_BREAKAWAY_FROM_JOB | CREATE_SUSPENDED,
-    NULL,
+    command_line,
+    inherit_count ? TRUE : FALSE,
+    creation_flags,
+    environment,
     options ? options->current_directory : NULL,
     &si.StartupInfo, &pi);
   if (!success) {
@@ -131,34 +257,91 @@ ResultCode Container::Spawn(const wchar_t *exe_path,
   unique_handle process_holder(pi.hProcess);
   unique_handle thread_holder(pi.hThread);
   if (rc != WINC_OK) {
-    ::TerminateProcess(pi.hProcess, 1);
+    platform->TerminateProcess(pi.hProcess, 1);
     return rc;
   }
 
   // Disable hard error of the target process
-  NTSTATUS status;
-  ULONG default_hard_error_mode;
-  status = ::NtQueryInformationProcess(pi.hProcess,
-                                       ProcessDefaultHardErrorMode,
-                                       &default_hard_error_mode,
-                                       sizeof(default_hard_error_mode),
-                                       NULL);
-  if (!NT_SUCCESS(status))
-    return WINC_ERROR_SPAWN;
-  default_hard_error_mode &= ~1;
-  status = ::NtSetInformationProcess(pi.hProcess,
-                                     ProcessDefaultHardErrorMode,
-                                     &default_hard_error_mode,
-                                     sizeof(default_hard_error_mode));
-  if (!NT_SUCCESS(status))
+  if (!platform->DisableHardError(pi.hProcess))
     return WINC_ERROR_SPAWN;
 
   target->Assign(pi.dwProcessId, job_object_holder,
                  process_holder, thread_holder);
+  if (core_lease.affinity())
+    target->AssignCore(core_lease.allocator(), core_lease.release());
+  if (desktop_lease)
+    target->AssignDesktop(desktop_lease);
+  return WINC_OK;
+}
+
+ResultCode Container::Run(const wchar_t *exe_path, SpawnOptions *options,
+                          const RunLimits &limits, RunResult *out_result) {
+  SpawnOptions run_options = options ? *options : SpawnOptions();
+  OutputReader stdout_reader, stderr_reader;
+  ResultCode rc;
+  if (limits.stdout_capture_limit) {
+    rc = stdout_reader.Init(limits.stdout_capture_limit,
+                            &run_options.stdout_handle);
+    if (rc != WINC_OK)
+      return rc;
+  }
+  if (limits.stderr_capture_limit) {
+    rc = stderr_reader.Init(limits.stderr_capture_limit,
+                            &run_options.stderr_handle);
+    if (rc != WINC_OK)
+      return rc;
+  }
+
+  Target target;
+  rc = Spawn(exe_path, &target, &run_options);
+  if (rc != WINC_OK)
+    return rc;
+  if (limits.stdout_capture_limit)
+    rc = stdout_reader.Start();
+  if (rc == WINC_OK && limits.stderr_capture_limit)
+    rc = stderr_reader.Start();
+  if (rc != WINC_OK) {
+    target.TerminateJob(1);
+    return rc;
+  }
+  RunResult result;
+  rc = target.Run(limits, &result);
+  if (rc != WINC_OK)
+    return rc;
+  if (!limits.stdout_capture_limit && !limits.stderr_capture_limit) {
+    *out_result = result;
+    return WINC_OK;
+  }
+
+  // Processes left in the job would hold the captured streams open, the
+  // statistics of the job are already collected
+  rc = target.TerminateJob(1);
+  if (rc != WINC_OK)
+    return rc;
+  if (limits.stdout_capture_limit) {
+    rc = stdout_reader.Wait(INFINITE, nullptr);
+    if (rc != WINC_OK)
+      return rc;
+    result.stdout_output = stdout_reader.output();
+  }
+  if (limits.stderr_capture_limit) {
+    rc = stderr_reader.Wait(INFINITE, nullptr);
+    if (rc != WINC_OK)
+      return rc;
+    result.stderr_output = stderr_reader.output();
+  }
+  *out_result = result;
   return WINC_OK;
 }
 
 ResultCode Container::GetPolicy(Policy **out_policy) {
+  ::AcquireSRWLockExclusive(&lock_);
+  ResultCode rc = GetPolicyLocked(out_policy);
+  ::ReleaseSRWLockExclusive(&lock_);
+  return rc;
+}
+
+ResultCode Container::GetPolicyLocked(Policy **out_policy) {
   if (!policy_) {
     auto policy = make_unique<Policy>();
     shared_ptr<Logon> logon;
@@ -170,16 +353,8 @@ ResultCode Container::GetPolicy(Policy **out_policy) {
     if (rc != WINC_OK)
       return rc;
     policy->AddRestrictSid(*logon_sid);
-    Sid builtin_user_sid;
-    rc = builtin_user_sid.Init(WinBuiltinUsersSid);
-    if (rc != WINC_OK)
-      return rc;
-    policy->AddRestrictSid(builtin_user_sid);
-    Sid world_sid;
-    rc = world_sid.Init(WinWorldSid);
-    if (rc != WINC_OK)
-      return rc;
-    policy->AddRestrictSid(world_sid);
+    policy->AddRestrictSid(kBuiltinUsersSid);
+    policy->AddRestrictSid(kWorldSid);
     policy->set_job_basic_limit(JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION
                               | JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE);
     policy->set_job_ui_limit(JOB_OBJECT_UILIMIT_HANDLES
@@ -196,4 +371,29 @@ ResultCode Container::GetPolicy(Policy **out_policy) {
   return WINC_OK;
 }
 
+ResultCode Container::GetCoreAllocator(
+    shared_ptr<CoreAllocator> *out_allocator) {
+  ::AcquireSRWLockExclusive(&lock_);
+  ResultCode rc = GetCoreAllocatorLocked(out_allocator);
+  ::ReleaseSRWLockExclusive(&lock_);
+  return rc;
+}
+
+ResultCode Container::GetCoreAllocatorLocked(
+    shared_ptr<CoreAllocator> *out_allocator) {
+  if (!core_allocator_) {
+    ResultCode rc = CoreAllocator::GetShared(&core_allocator_);
+    if (rc != WINC_OK)
+      return rc;
+  }
+  *out_allocator = core_allocator_;
+  return WINC_OK;
+}
+
+void Container::SetCoreAllocator(const shared_ptr<CoreAllocator> &allocator) {
+  ::AcquireSRWLockExclusive(&lock_);
+  core_allocator_ = allocator;
+  ::ReleaseSRWLockExclusive(&lock_);
+}
+
 }
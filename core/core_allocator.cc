@@ -0,0 +1,155 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <winc/core_allocator.h>
+
+#include <Windows.h>
+#include <memory>
+#include <vector>
+
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+
+namespace winc {
+
+namespace {
+
+shared_ptr<CoreAllocator> *g_shared_allocator = nullptr;
+
+uintptr_t LowestProcessor(uintptr_t mask) {
+  return mask & (~mask + 1);
+}
+
+}
+
+CoreAllocator::CoreAllocator() {
+  ::InitializeCriticalSection(&crit_sec_);
+}
+
+CoreAllocator::~CoreAllocator() {
+  ::DeleteCriticalSection(&crit_sec_);
+}
+
+ResultCode CoreAllocator::Init() {
+  DWORD size = 0;
+  if (!::GetLogicalProcessorInformation(NULL, &size) &&
+      ::GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    return WINC_ERROR_UTIL;
+  vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(
+      size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+  if (!::GetLogicalProcessorInformation(info.data(), &size))
+    return WINC_ERROR_UTIL;
+
+  // Only the processors available to this process can be leased
+  DWORD_PTR process_mask, system_mask;
+  if (!::GetProcessAffinityMask(::GetCurrentProcess(),
+                                &process_mask, &system_mask))
+    return WINC_ERROR_UTIL;
+
+  vector<uintptr_t> cache_masks;
+  for (const auto &entry : info) {
+    if (entry.Relationship == RelationCache && entry.Cache.Level == 2)
+      cache_masks.push_back(entry.ProcessorMask);
+  }
+
+  vector<Core> cores;
+  for (const auto &entry : info) {
+    if (entry.Relationship != RelationProcessorCore)
+      continue;
+    uintptr_t mask = entry.ProcessorMask & process_mask;
+    if (!mask)
+      continue;
+    Core core;
+    core.processor_mask = mask;
+    core.leased = false;
+    // Cores without a known L2 cache get a group of their own
+    core.cache_group = static_cast<unsigned int>(cache_masks.size());
+    for (unsigned int i = 0; i < cache_masks.size(); ++i) {
+      if (cache_masks[i] & mask) {
+        core.cache_group = i;
+        break;
+      }
+    }
+    if (core.cache_group == cache_masks.size())
+      cache_masks.push_back(mask);
+    cores.push_back(core);
+  }
+  if (cores.empty())
+    return WINC_ERROR_UTIL;
+
+  cores_ = move(cores);
+  cache_group_leased_.assign(cache_masks.size(), 0);
+  return WINC_OK;
+}
+
+ResultCode CoreAllocator::Lease(uintptr_t *out_affinity) {
+  ::EnterCriticalSection(&crit_sec_);
+  Core *best = nullptr;
+  for (Core &core : cores_) {
+    if (core.leased)
+      continue;
+    if (!best || cache_group_leased_[core.cache_group] <
+                 cache_group_leased_[best->cache_group])
+      best = &core;
+  }
+  if (!best) {
+    ::LeaveCriticalSection(&crit_sec_);
+    return WINC_ERROR_NO_FREE_CORE;
+  }
+  best->leased = true;
+  ++cache_group_leased_[best->cache_group];
+  ::LeaveCriticalSection(&crit_sec_);
+  *out_affinity = LowestProcessor(best->processor_mask);
+  return WINC_OK;
+}
+
+void CoreAllocator::Release(uintptr_t affinity) {
+  ::EnterCriticalSection(&crit_sec_);
+  for (Core &core : cores_) {
+    if (core.leased && (core.processor_mask & affinity)) {
+      core.leased = false;
+      --cache_group_leased_[core.cache_group];
+      break;
+    }
+  }
+  ::LeaveCriticalSection(&crit_sec_);
+}
+
+unsigned int CoreAllocator::free_core_count() {
+  unsigned int count = 0;
+  ::EnterCriticalSection(&crit_sec_);
+  for (const Core &core : cores_) {
+    if (!core.leased)
+      ++count;
+  }
+  ::LeaveCriticalSection(&crit_sec_);
+  return count;
+}
+
+ResultCode CoreAllocator::GetShared(shared_ptr<CoreAllocator> *out_allocator) {
+  shared_ptr<CoreAllocator> *shared = g_shared_allocator;
+  if (shared) {
+    *out_allocator = *shared;
+    return WINC_OK;
+  }
+
+  // Create a new allocator, and then set the global pointer
+  // by interlocked operation
+  auto allocator = make_shared<CoreAllocator>();
+  ResultCode rc = allocator->Init();
+  if (rc != WINC_OK)
+    return rc;
+  shared = new shared_ptr<CoreAllocator>(move(allocator));
+  PVOID original = ::InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID *>(&g_shared_allocator), shared, nullptr);
+  if (original) {
+    delete shared;
+    shared = reinterpret_cast<shared_ptr<CoreAllocator> *>(original);
+  }
+  *out_allocator = *shared;
+  return WINC_OK;
+}
+
+}
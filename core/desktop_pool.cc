@@ -0,0 +1,140 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/desktop_pool.h"
+
+#include <Windows.h>
+#include <Aclapi.h>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <winc/desktop.h>
+#include <winc/logon.h>
+
+using std::make_unique;
+using std::move;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+namespace winc {
+
+namespace {
+
+struct DesktopPoolEntry {
+  // Keeps the logon alive, so that its address is not reused while the
+  // entry is in the pool
+  shared_ptr<Logon> logon;
+  vector<unique_ptr<AlternateDesktop>> idle_desktops;
+};
+
+SRWLOCK g_pool_lock = SRWLOCK_INIT;
+unordered_map<const Logon *, DesktopPoolEntry> *g_pool;
+// Leased desktops which must not return to the pool
+unordered_set<const AlternateDesktop *> *g_discarded;
+
+// Must be called with the lock held exclusively
+size_t TrimLocked() {
+  if (!g_pool)
+    return 0;
+  size_t idle_count = 0;
+  for (auto iter = g_pool->begin(); iter != g_pool->end();) {
+    // Leased desktops hold a reference to their logon too
+    if (iter->second.logon.use_count() == 1) {
+      iter = g_pool->erase(iter);
+    } else {
+      idle_count += iter->second.idle_desktops.size();
+      ++iter;
+    }
+  }
+  return idle_count;
+}
+
+void Release(const shared_ptr<Logon> &logon, AlternateDesktop *desktop) {
+  unique_ptr<AlternateDesktop> holder(desktop);
+  ::AcquireSRWLockExclusive(&g_pool_lock);
+  if (g_discarded && g_discarded->erase(desktop)) {
+    ::ReleaseSRWLockExclusive(&g_pool_lock);
+    return;
+  }
+  if (!g_pool)
+    g_pool = new unordered_map<const Logon *, DesktopPoolEntry>;
+  DesktopPoolEntry &entry = (*g_pool)[logon.get()];
+  if (!entry.logon)
+    entry.logon = logon;
+  if (entry.idle_desktops.size() < DesktopPool::kMaxIdleDesktops)
+    entry.idle_desktops.push_back(move(holder));
+  // The logon of this desktop is still referenced by the lease, the others
+  // may have been released since
+  TrimLocked();
+  ::ReleaseSRWLockExclusive(&g_pool_lock);
+}
+
+ResultCode MakeDesktop(const Logon &logon,
+                       unique_ptr<AlternateDesktop> *out_desktop) {
+  auto desktop = make_unique<AlternateDesktop>();
+  ResultCode rc = desktop->Init(DESKTOP_READOBJECTS | DESKTOP_CREATEWINDOW |
+                                DESKTOP_WRITEOBJECTS | DESKTOP_SWITCHDESKTOP |
+                                READ_CONTROL | WRITE_DAC | WRITE_OWNER);
+  if (rc != WINC_OK)
+    return rc;
+  rc = logon.GrantAccess(desktop->GetDesktopHandle(), SE_WINDOW_OBJECT,
+                         GENERIC_READ | GENERIC_WRITE | GENERIC_EXECUTE);
+  if (rc != WINC_OK)
+    return rc;
+  rc = logon.GrantAccess(desktop->GetWinstaHandle(), SE_WINDOW_OBJECT,
+                         GENERIC_READ | GENERIC_WRITE | GENERIC_EXECUTE);
+  if (rc != WINC_OK)
+    return rc;
+  *out_desktop = move(desktop);
+  return WINC_OK;
+}
+
+}
+
+ResultCode DesktopPool::Acquire(const shared_ptr<Logon> &logon,
+                                shared_ptr<AlternateDesktop> *out_desktop) {
+  unique_ptr<AlternateDesktop> desktop;
+  ::AcquireSRWLockExclusive(&g_pool_lock);
+  if (g_pool) {
+    auto iter = g_pool->find(logon.get());
+    if (iter != g_pool->end() && !iter->second.idle_desktops.empty()) {
+      desktop = move(iter->second.idle_desktops.back());
+      iter->second.idle_desktops.pop_back();
+    }
+  }
+  ::ReleaseSRWLockExclusive(&g_pool_lock);
+
+  // Created outside of the lock, it takes a few system calls
+  if (!desktop) {
+    ResultCode rc = MakeDesktop(*logon, &desktop);
+    if (rc != WINC_OK)
+      return rc;
+  }
+  out_desktop->reset(desktop.release(), [logon](AlternateDesktop *desktop) {
+    Release(logon, desktop);
+  });
+  return WINC_OK;
+}
+
+void DesktopPool::Discard(const shared_ptr<AlternateDesktop> &desktop) {
+  ::AcquireSRWLockExclusive(&g_pool_lock);
+  if (!g_discarded)
+    g_discarded = new unordered_set<const AlternateDesktop *>;
+  g_discarded->insert(desktop.get());
+  ::ReleaseSRWLockExclusive(&g_pool_lock);
+}
+
+size_t DesktopPool::Trim() {
+  ::AcquireSRWLockExclusive(&g_pool_lock);
+  size_t idle_count = TrimLocked();
+  ::ReleaseSRWLockExclusive(&g_pool_lock);
+  return idle_count;
+}
+
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_DESKTOP_POOL_H_
+#define WINC_CORE_DESKTOP_POOL_H_
+
+#include <memory>
+
+#include <winc_types.h>
+
+namespace winc {
+
+class AlternateDesktop;
+class Logon;
+
+// The alternate desktops of the process, with the access of their logon
+// already granted. A desktop is leased to one policy at a time, and to the
+// targets spawned on it until their processes exit. It returns to the pool
+// when the last lease is released, e.g. by Policy::SetLogon, so
+// that the desktops, which come from the small desktop heap of the session,
+// are not created again. A desktop is only reused for the logon it was
+// made for, as all targets of a policy share its desktop anyway.
+class DesktopPool {
+public:
+  // Idle desktops kept for each logon, the others are closed
+  static const size_t kMaxIdleDesktops = 4;
+
+  // Lease an idle desktop of the logon, or create one if there is none.
+  // The desktop returns to the pool when the last reference is released.
+  static ResultCode Acquire(const std::shared_ptr<Logon> &logon,
+                            std::shared_ptr<AlternateDesktop> *out_desktop);
+
+  // Marks a leased desktop to be closed instead of returned to the pool
+  // when the lease is released, e.g. when processes may be left on it
+  static void Discard(const std::shared_ptr<AlternateDesktop> &desktop);
+
+  // Closes the idle desktops of the logons no longer referenced outside of
+  // the pool, returns the number of idle desktops kept
+  static size_t Trim();
+};
+
+}
+
+#endif
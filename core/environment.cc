@@ -0,0 +1,218 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <winc/environment.h>
+
+#include <Windows.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <winc_types.h>
+
+using std::shared_ptr;
+using std::stable_sort;
+using std::unordered_multimap;
+using std::vector;
+using std::weak_ptr;
+
+namespace winc {
+
+namespace {
+
+// A variable in a list to be sorted
+struct Variable {
+  const wchar_t *text;
+  size_t name_size;
+  size_t size;
+  // Set unless the variable is removed by an override
+  bool has_value;
+};
+
+// The name ends at the first equal sign, which is not the first character,
+// so that the hidden variables of the drive directories like =C: are kept
+bool ParseVariable(const wchar_t *text, bool allow_removal,
+                   Variable *out_variable) {
+  size_t size = wcslen(text);
+  const wchar_t *equal = size > 1 ? wmemchr(text + 1, L'=', size - 1)
+                                  : nullptr;
+  if (!size || (!equal && !allow_removal))
+    return false;
+  out_variable->text = text;
+  out_variable->name_size = equal ? equal - text : size;
+  out_variable->size = size;
+  out_variable->has_value = equal != nullptr;
+  return true;
+}
+
+int CompareNames(const Variable &a, const Variable &b) {
+  size_t size = a.name_size < b.name_size ? a.name_size : b.name_size;
+  for (size_t i = 0; i < size; ++i) {
+    wint_t x = towupper(a.text[i]);
+    wint_t y = towupper(b.text[i]);
+    if (x != y)
+      return x < y ? -1 : 1;
+  }
+  if (a.name_size != b.name_size)
+    return a.name_size < b.name_size ? -1 : 1;
+  return 0;
+}
+
+// Sorts the variables by name, keeping only the last one of each name
+void SortVariables(vector<Variable> *variables) {
+  stable_sort(variables->begin(), variables->end(),
+              [](const Variable &a, const Variable &b) {
+                return CompareNames(a, b) < 0;
+              });
+  size_t kept = 0;
+  for (size_t i = 0; i < variables->size(); ++i) {
+    if (i + 1 < variables->size() &&
+        !CompareNames((*variables)[i], (*variables)[i + 1]))
+      continue;
+    (*variables)[kept++] = (*variables)[i];
+  }
+  variables->resize(kept);
+}
+
+wchar_t *AppendVariable(const Variable &variable, wchar_t *out) {
+  wmemcpy(out, variable.text, variable.size);
+  out[variable.size] = L'\0';
+  return out + variable.size + 1;
+}
+
+// An empty block still has the null of an empty string before the last one
+wchar_t *FinishBlock(wchar_t *begin, wchar_t *out) {
+  if (out == begin)
+    *out++ = L'\0';
+  *out++ = L'\0';
+  return out;
+}
+
+uint64_t HashBlock(const vector<wchar_t> &data) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (wchar_t c : data) {
+    hash ^= static_cast<uint64_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The live blocks by hash, never freed as blocks may outlive any owner
+SRWLOCK g_cache_lock = SRWLOCK_INIT;
+unordered_multimap<uint64_t, weak_ptr<const EnvironmentBlock>> *g_cache;
+
+}
+
+ResultCode EnvironmentBlock::Compile(
+    const wchar_t *const *variables, size_t count,
+    shared_ptr<const EnvironmentBlock> *out_block) {
+  vector<Variable> sorted(count);
+  size_t size = 2;
+  for (size_t i = 0; i < count; ++i) {
+    if (!ParseVariable(variables[i], false, &sorted[i]))
+      return WINC_ERROR_ENVIRONMENT;
+  }
+  SortVariables(&sorted);
+  for (const Variable &variable : sorted)
+    size += variable.size + 1;
+
+  shared_ptr<EnvironmentBlock> block(new EnvironmentBlock);
+  block->data_.resize(size);
+  wchar_t *begin = block->data_.data();
+  wchar_t *out = begin;
+  for (const Variable &variable : sorted)
+    out = AppendVariable(variable, out);
+  out = FinishBlock(begin, out);
+  block->data_.resize(out - begin);
+  block->hash_ = HashBlock(block->data_);
+
+  ::AcquireSRWLockExclusive(&g_cache_lock);
+  if (!g_cache)
+    g_cache = new unordered_multimap<uint64_t,
+                                     weak_ptr<const EnvironmentBlock>>;
+  auto range = g_cache->equal_range(block->hash_);
+  for (auto iter = range.first; iter != range.second;) {
+    shared_ptr<const EnvironmentBlock> cached = iter->second.lock();
+    if (!cached) {
+      iter = g_cache->erase(iter);
+      continue;
+    }
+    if (cached->data_ == block->data_) {
+      ::ReleaseSRWLockExclusive(&g_cache_lock);
+      *out_block = cached;
+      return WINC_OK;
+    }
+    ++iter;
+  }
+  g_cache->emplace(block->hash_, block);
+  ::ReleaseSRWLockExclusive(&g_cache_lock);
+  *out_block = block;
+  return WINC_OK;
+}
+
+ResultCode EnvironmentBlock::FromCurrentProcess(
+    shared_ptr<const EnvironmentBlock> *out_block) {
+  wchar_t *strings = ::GetEnvironmentStringsW();
+  if (!strings)
+    return WINC_ERROR_ENVIRONMENT;
+  vector<const wchar_t *> variables;
+  for (const wchar_t *p = strings; *p; p += wcslen(p) + 1)
+    variables.push_back(p);
+  ResultCode rc = Compile(variables.data(), variables.size(), out_block);
+  ::FreeEnvironmentStringsW(strings);
+  return rc;
+}
+
+ResultCode EnvironmentBlock::Merge(const wchar_t *const *overrides,
+                                   size_t count,
+                                   vector<wchar_t> *arena) const {
+  vector<Variable> sorted(count);
+  size_t size = data_.size();
+  for (size_t i = 0; i < count; ++i) {
+    if (!ParseVariable(overrides[i], true, &sorted[i]))
+      return WINC_ERROR_ENVIRONMENT;
+    size += sorted[i].size + 1;
+  }
+  SortVariables(&sorted);
+
+  // The size is an upper bound, so the arena is not grown during the merge
+  if (arena->size() < size)
+    arena->resize(size);
+  wchar_t *begin = arena->data();
+  wchar_t *out = begin;
+  auto override_iter = sorted.begin();
+  for (const wchar_t *p = data_.data(); *p;) {
+    Variable base;
+    ParseVariable(p, false, &base);
+    p += base.size + 1;
+    int order = -1;
+    for (; override_iter != sorted.end(); ++override_iter) {
+      order = CompareNames(*override_iter, base);
+      if (order > 0)
+        break;
+      if (override_iter->has_value)
+        out = AppendVariable(*override_iter, out);
+      if (!order) {
+        ++override_iter;
+        break;
+      }
+    }
+    if (order)
+      out = AppendVariable(base, out);
+  }
+  for (; override_iter != sorted.end(); ++override_iter) {
+    if (override_iter->has_value)
+      out = AppendVariable(*override_iter, out);
+  }
+  FinishBlock(begin, out);
+  return WINC_OK;
+}
+
+}
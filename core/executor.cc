@@ -0,0 +1,240 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <winc/executor.h>
+
+#include <Windows.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <winc_types.h>
+#include <winc/container.h>
+#include <winc/target.h>
+#include <winc/util.h>
+#include "core/input_writer.h"
+#include "core/output_reader.h"
+
+using std::make_unique;
+using std::min;
+using std::move;
+using std::vector;
+
+namespace winc {
+
+Executor::Executor()
+  : container_(nullptr)
+  , cancelled_(0)
+  , returned_count_(0) {
+  ::InitializeCriticalSection(&result_crit_sec_);
+}
+
+Executor::~Executor() {
+  ::InterlockedExchange(&cancelled_, 1);
+  for (auto &worker : workers_) {
+    if (worker->thread)
+      ::WaitForSingleObject(worker->thread.get(), INFINITE);
+    ::DeleteCriticalSection(&worker->crit_sec);
+  }
+  ::DeleteCriticalSection(&result_crit_sec_);
+}
+
+ResultCode Executor::Init(Container *container, vector<ExecutorJob> jobs,
+                          unsigned int worker_count) {
+  container_ = container;
+  jobs_ = move(jobs);
+  if (jobs_.empty())
+    return WINC_OK;
+  if (!worker_count) {
+    SYSTEM_INFO si;
+    ::GetSystemInfo(&si);
+    worker_count = si.dwNumberOfProcessors;
+  }
+  worker_count = static_cast<unsigned int>(min<size_t>(worker_count,
+                                                       jobs_.size()));
+
+  HANDLE semaphore = ::CreateSemaphoreW(NULL, 0,
+      static_cast<LONG>(jobs_.size()), NULL);
+  if (!semaphore)
+    return WINC_ERROR_UTIL;
+  result_semaphore_.reset(semaphore);
+
+  // Deal the jobs before any worker starts, so that stealing only happens
+  // when a worker runs out of its share
+  for (unsigned int i = 0; i < worker_count; ++i) {
+    auto worker = make_unique<Worker>();
+    worker->executor = this;
+    worker->id = i;
+    ::InitializeCriticalSection(&worker->crit_sec);
+    workers_.push_back(move(worker));
+  }
+  for (size_t index = 0; index < jobs_.size(); ++index)
+    workers_[index % worker_count]->pending.push_front(index);
+
+  for (auto &worker : workers_) {
+    HANDLE thread = ::CreateThread(NULL, 0, WorkerThread, worker.get(),
+                                   0, NULL);
+    if (!thread) {
+      ::InterlockedExchange(&cancelled_, 1);
+      return WINC_ERROR_UTIL;
+    }
+    worker->thread.reset(thread);
+  }
+  return WINC_OK;
+}
+
+ResultCode Executor::Next(ExecutorResult *out_result, bool *finished) {
+  if (returned_count_ == jobs_.size()) {
+    *finished = true;
+    return WINC_OK;
+  }
+  if (::WaitForSingleObject(result_semaphore_.get(), INFINITE) != WAIT_OBJECT_0)
+    return WINC_ERROR_UTIL;
+  ::EnterCriticalSection(&result_crit_sec_);
+  *out_result = results_.front();
+  results_.pop_front();
+  ::LeaveCriticalSection(&result_crit_sec_);
+  ++returned_count_;
+  *finished = false;
+  return WINC_OK;
+}
+
+DWORD WINAPI Executor::WorkerThread(PVOID param) {
+  Worker *worker = reinterpret_cast<Worker *>(param);
+  Executor *executor = worker->executor;
+  size_t index;
+  while (!executor->cancelled_ && (executor->PopJob(worker, &index) ||
+                                   executor->StealJob(worker, &index))) {
+    ExecutorResult result;
+    executor->RunJob(index, &result);
+    executor->PushResult(result);
+  }
+  return 0;
+}
+
+bool Executor::PopJob(Worker *worker, size_t *out_index) {
+  ::EnterCriticalSection(&worker->crit_sec);
+  bool found = !worker->pending.empty();
+  if (found) {
+    *out_index = worker->pending.back();
+    worker->pending.pop_back();
+  }
+  ::LeaveCriticalSection(&worker->crit_sec);
+  return found;
+}
+
+bool Executor::StealJob(Worker *thief, size_t *out_index) {
+  // No job is added after the start, so a full round without success
+  // means that every job has been taken
+  size_t count = workers_.size();
+  for (size_t i = 1; i < count; ++i) {
+    Worker *victim = workers_[(thief->id + i) % count].get();
+    ::EnterCriticalSection(&victim->crit_sec);
+    bool found = !victim->pending.empty();
+    if (found) {
+      *out_index = victim->pending.front();
+      victim->pending.pop_front();
+    }
+    ::LeaveCriticalSection(&victim->crit_sec);
+    if (found)
+      return true;
+  }
+  return false;
+}
+
+void Executor::RunJob(size_t index, ExecutorResult *result) {
+  const ExecutorJob &job = jobs_[index];
+  *result = ExecutorResult();
+  result->index = index;
+
+  // The command line must be writable
+  vector<wchar_t> command_line(job.command_line.begin(),
+                               job.command_line.end());
+  command_line.push_back(L'\0');
+  SpawnOptions options = {};
+  if (!job.command_line.empty())
+    options.command_line = command_line.data();
+  options.processor_affinity = job.processor_affinity;
+  options.auto_affinity = job.auto_affinity;
+  options.memory_limit = job.memory_limit;
+  options.active_process_limit = job.active_process_limit;
+
+  InputWriter input_writer;
+  if (!job.input.empty()) {
+    ResultCode rc = input_writer.Init(job.input.data(), job.input.size(),
+                                      &options.stdin_handle);
+    if (rc != WINC_OK) {
+      result->rc = rc;
+      return;
+    }
+  }
+
+  OutputReader output_reader;
+  if (job.output_limit) {
+    ResultCode rc = output_reader.Init(job.output_limit,
+                                       &options.stdout_handle);
+    if (rc != WINC_OK) {
+      result->rc = rc;
+      return;
+    }
+  }
+
+  Target target;
+  ResultCode rc = container_->Spawn(job.exe_path.c_str(), &target, &options);
+  if (rc != WINC_OK) {
+    result->rc = rc;
+    return;
+  }
+  if (job.output_limit) {
+    rc = output_reader.Start();
+    if (rc != WINC_OK) {
+      target.TerminateJob(1);
+      result->rc = rc;
+      return;
+    }
+  }
+  // The input is written while the target runs, it may not fit in the pipe
+  if (!job.input.empty()) {
+    rc = input_writer.Start();
+    if (rc != WINC_OK) {
+      target.TerminateJob(1);
+      result->rc = rc;
+      return;
+    }
+  }
+
+  RunLimits limits = {};
+  limits.time_limit_ms = job.time_limit_ms;
+  RunResult run_result;
+  rc = target.Run(limits, &run_result);
+  if (rc != WINC_OK) {
+    result->rc = rc;
+    return;
+  }
+  result->time_limit_exceeded = run_result.time_limit_exceeded;
+  result->exit_code = run_result.exit_code;
+  result->job_time = run_result.job_time;
+  result->peak_memory = run_result.peak_memory;
+  if (job.output_limit) {
+    // Processes left in the job would hold the pipe open, as in
+    // Container::Run
+    rc = target.TerminateJob(1);
+    if (rc == WINC_OK)
+      rc = output_reader.Wait(INFINITE, nullptr);
+    if (rc == WINC_OK)
+      result->output = output_reader.output();
+  }
+  result->rc = rc;
+}
+
+void Executor::PushResult(const ExecutorResult &result) {
+  ::EnterCriticalSection(&result_crit_sec_);
+  results_.push_back(result);
+  ::LeaveCriticalSection(&result_crit_sec_);
+  ::ReleaseSemaphore(result_semaphore_.get(), 1, NULL);
+}
+
+}
@@ -0,0 +1,924 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/fake_platform.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+using std::deque;
+using std::find;
+using std::make_shared;
+using std::max;
+using std::min;
+using std::shared_ptr;
+using std::static_pointer_cast;
+using std::vector;
+
+namespace winc {
+
+namespace {
+
+class AutoLock {
+public:
+  explicit AutoLock(CRITICAL_SECTION *crit_sec)
+    : crit_sec_(crit_sec) {
+    ::EnterCriticalSection(crit_sec_);
+  }
+
+  ~AutoLock() {
+    ::LeaveCriticalSection(crit_sec_);
+  }
+
+private:
+  CRITICAL_SECTION *crit_sec_;
+
+private:
+  AutoLock(const AutoLock &) = delete;
+  void operator=(const AutoLock &) = delete;
+};
+
+void ToFileTime(ULONG64 time, FILETIME *out_time) {
+  out_time->dwLowDateTime = static_cast<DWORD>(time);
+  out_time->dwHighDateTime = static_cast<DWORD>(time >> 32);
+}
+
+// Writes a SID with the given sub authorities
+void WriteSid(PSID sid, SID_IDENTIFIER_AUTHORITY authority,
+              const DWORD *sub_authorities, BYTE count) {
+  ::InitializeSid(sid, &authority, count);
+  for (BYTE i = 0; i < count; ++i)
+    *::GetSidSubAuthority(sid, i) = sub_authorities[i];
+}
+
+// Identity of the fake user, S-1-5-21-1-2-3-1000 with the logon session
+// S-1-5-5-0-1
+const DWORD USER_SUB_AUTHORITIES[] = {SECURITY_NT_NON_UNIQUE, 1, 2, 3, 1000};
+const DWORD LOGON_SUB_AUTHORITIES[] = {SECURITY_LOGON_IDS_RID, 0, 1};
+
+// The fake clock starts in 2015
+const ULONG64 CLOCK_BASE = 130645440000000000ull;
+
+// Every new process moves the clock forward by a millisecond
+const ULONG64 CLOCK_TICK = 10000;
+
+}
+
+struct FakePlatform::Object {
+  enum Kind {
+    PROCESS,
+    THREAD,
+    JOB,
+    PORT,
+    TOKEN,
+  };
+
+  explicit Object(Kind kind)
+    : kind(kind)
+    {}
+
+  virtual ~Object() {}
+
+  Kind kind;
+};
+
+struct FakePlatform::Process : public Object {
+  Process()
+    : Object(PROCESS), id(0), parent_id(0), suspended(false), exited(false),
+      exit_code(STILL_ACTIVE), creation_time(0), exit_time(0), user_time(0),
+      kernel_time(0), cycles(0), commit(0), peak_commit(0)
+    {}
+
+  DWORD id;
+  DWORD parent_id;
+  bool suspended;
+  bool exited;
+  DWORD exit_code;
+  shared_ptr<Job> job;
+  ULONG64 creation_time;
+  ULONG64 exit_time;
+  ULONG64 user_time;
+  ULONG64 kernel_time;
+  ULONG64 cycles;
+  SIZE_T commit;
+  SIZE_T peak_commit;
+};
+
+struct FakePlatform::Thread : public Object {
+  explicit Thread(const shared_ptr<Process> &process)
+    : Object(THREAD), process(process)
+    {}
+
+  shared_ptr<Process> process;
+};
+
+struct FakePlatform::Job : public Object {
+  Job()
+    : Object(JOB), ui_limit(0), key(0), memory(0),
+      notification_memory_limit(0) {
+    limit = {};
+    account = {};
+  }
+
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit;
+  DWORD ui_limit;
+  JOBOBJECT_BASIC_ACCOUNTING_INFORMATION account;
+  shared_ptr<Port> port;
+  ULONG_PTR key;
+  // Committed memory of the active processes
+  SIZE_T memory;
+  // Job memory notification limit, zero if not armed. The message is
+  // posted once, the limit must be set again for the next one.
+  SIZE_T notification_memory_limit;
+  vector<shared_ptr<Process>> active;
+};
+
+struct FakePlatform::Port : public Object {
+  Port()
+    : Object(PORT), closed(false)
+    {}
+
+  bool closed;
+  deque<OVERLAPPED_ENTRY> entries;
+};
+
+struct FakePlatform::Token : public Object {
+  Token()
+    : Object(TOKEN), integrity_level(SECURITY_MANDATORY_MEDIUM_RID),
+      restricted_sids_count(0)
+    {}
+
+  DWORD integrity_level;
+  DWORD restricted_sids_count;
+};
+
+FakePlatform::FakePlatform()
+  : next_handle_(0x10001)
+  , next_process_id_(1000)
+  , last_process_id_(0)
+  , process_count_(0)
+  , clock_(CLOCK_BASE) {
+  ::InitializeCriticalSection(&crit_sec_);
+  ::InitializeConditionVariable(&changed_);
+}
+
+FakePlatform::~FakePlatform() {
+  // Break the references between the running processes and their jobs
+  for (auto &entry : processes_)
+    entry.second->job.reset();
+  processes_.clear();
+  handles_.clear();
+  ::DeleteCriticalSection(&crit_sec_);
+}
+
+BOOL FakePlatform::SimulateRun(DWORD process_id, ULONG64 user_time,
+                               ULONG64 kernel_time, ULONG64 cycles) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> process = FindProcessById(process_id);
+  if (!process)
+    return FALSE;
+  process->user_time += user_time;
+  process->kernel_time += kernel_time;
+  process->cycles += cycles;
+  if (process->job) {
+    process->job->account.TotalUserTime.QuadPart += user_time;
+    process->job->account.TotalKernelTime.QuadPart += kernel_time;
+  }
+  clock_ += user_time + kernel_time;
+  return TRUE;
+}
+
+BOOL FakePlatform::SimulateAllocation(DWORD process_id, SSIZE_T size) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> process = FindProcessById(process_id);
+  if (!process)
+    return FALSE;
+  Job *job = process->job.get();
+  if (size < 0) {
+    SIZE_T decommit = min(process->commit, static_cast<SIZE_T>(-size));
+    process->commit -= decommit;
+    if (job)
+      job->memory -= decommit;
+    return TRUE;
+  }
+
+  SIZE_T commit = static_cast<SIZE_T>(size);
+  if (job) {
+    const JOBOBJECT_EXTENDED_LIMIT_INFORMATION &limit = job->limit;
+    DWORD flags = limit.BasicLimitInformation.LimitFlags;
+    if ((flags & JOB_OBJECT_LIMIT_PROCESS_MEMORY) &&
+        process->commit + commit > limit.ProcessMemoryLimit) {
+      PostJobMessage(job, JOB_OBJECT_MSG_PROCESS_MEMORY_LIMIT, process->id);
+      ::SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+      return FALSE;
+    }
+    if ((flags & JOB_OBJECT_LIMIT_JOB_MEMORY) &&
+        job->memory + commit > limit.JobMemoryLimit) {
+      PostJobMessage(job, JOB_OBJECT_MSG_JOB_MEMORY_LIMIT, process->id);
+      ::SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+      return FALSE;
+    }
+  }
+  process->commit += commit;
+  process->peak_commit = max(process->peak_commit, process->commit);
+  if (job) {
+    job->memory += commit;
+    job->limit.PeakJobMemoryUsed = max(job->limit.PeakJobMemoryUsed,
+                                       job->memory);
+    job->limit.PeakProcessMemoryUsed = max(job->limit.PeakProcessMemoryUsed,
+                                           process->commit);
+    if (job->notification_memory_limit &&
+        job->memory > job->notification_memory_limit) {
+      job->notification_memory_limit = 0;
+      PostJobMessage(job, JOB_OBJECT_MSG_NOTIFICATION_LIMIT, process->id);
+    }
+  }
+  return TRUE;
+}
+
+BOOL FakePlatform::SimulateChild(DWORD parent_id, DWORD *out_child_id) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> parent = FindProcessById(parent_id);
+  if (!parent)
+    return FALSE;
+  shared_ptr<Process> child = NewProcess();
+  child->parent_id = parent->id;
+  if (parent->job && !AddToJob(parent->job, child)) {
+    processes_.erase(child->id);
+    --process_count_;
+    return FALSE;
+  }
+  *out_child_id = child->id;
+  return TRUE;
+}
+
+BOOL FakePlatform::SimulateExit(DWORD process_id, DWORD exit_code) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> process = FindProcessById(process_id);
+  if (!process)
+    return FALSE;
+  Exit(process, exit_code, false);
+  return TRUE;
+}
+
+DWORD FakePlatform::last_process_id() {
+  AutoLock lock(&crit_sec_);
+  return last_process_id_;
+}
+
+vector<wchar_t> FakePlatform::last_environment() {
+  AutoLock lock(&crit_sec_);
+  return last_environment_;
+}
+
+unsigned int FakePlatform::process_count() {
+  AutoLock lock(&crit_sec_);
+  return process_count_;
+}
+
+unsigned int FakePlatform::handle_count() {
+  AutoLock lock(&crit_sec_);
+  return static_cast<unsigned int>(handles_.size());
+}
+
+BOOL FakePlatform::CloseHandle(HANDLE object) {
+  {
+    AutoLock lock(&crit_sec_);
+    auto iter = handles_.find(object);
+    if (iter != handles_.end()) {
+      shared_ptr<Object> closed = iter->second;
+      handles_.erase(iter);
+      if (closed->kind == Object::JOB) {
+        shared_ptr<Job> job = static_pointer_cast<Job>(closed);
+        // The processes are killed when the last handle is closed
+        bool last_handle = true;
+        for (const auto &entry : handles_) {
+          if (entry.second == closed)
+            last_handle = false;
+        }
+        if (last_handle &&
+            (job->limit.BasicLimitInformation.LimitFlags &
+             JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE)) {
+          vector<shared_ptr<Process>> active = job->active;
+          for (const shared_ptr<Process> &process : active)
+            Exit(process, 0, true);
+        }
+      } else if (closed->kind == Object::PORT) {
+        static_pointer_cast<Port>(closed)->closed = true;
+        ::WakeAllConditionVariable(&changed_);
+      }
+      return TRUE;
+    }
+  }
+  return ::CloseHandle(object);
+}
+
+BOOL FakePlatform::DuplicateHandle(HANDLE object, HANDLE *out_object) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Object> found = FindObject(object);
+  if (!found) {
+    ::SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+  }
+  *out_object = AddHandle(found);
+  return TRUE;
+}
+
+DWORD FakePlatform::WaitForSingleObject(HANDLE object, DWORD timeout_ms) {
+  {
+    AutoLock lock(&crit_sec_);
+    shared_ptr<Object> found = FindObject(object);
+    if (found) {
+      shared_ptr<Process> process;
+      if (found->kind == Object::PROCESS)
+        process = static_pointer_cast<Process>(found);
+      else if (found->kind == Object::THREAD)
+        process = static_pointer_cast<Thread>(found)->process;
+      if (!process) {
+        ::SetLastError(ERROR_INVALID_HANDLE);
+        return WAIT_FAILED;
+      }
+      ULONGLONG deadline = ::GetTickCount64() + timeout_ms;
+      while (!process->exited) {
+        if (!WaitChange(timeout_ms, deadline))
+          return WAIT_TIMEOUT;
+      }
+      return WAIT_OBJECT_0;
+    }
+  }
+  return ::WaitForSingleObject(object, timeout_ms);
+}
+
+BOOL FakePlatform::CreateUserProcess(HANDLE token,
+                                     const wchar_t *exe_path,
+                                     wchar_t *command_line,
+                                     BOOL inherit_handles,
+                                     DWORD creation_flags,
+                                     const wchar_t *environment,
+                                     const wchar_t *current_directory,
+                                     STARTUPINFOW *startup_info,
+                                     PROCESS_INFORMATION *out_info) {
+  AutoLock lock(&crit_sec_);
+  if (!FindToken(token))
+    return FALSE;
+  shared_ptr<Process> process = NewProcess();
+  process->parent_id = ::GetCurrentProcessId();
+  process->suspended = (creation_flags & CREATE_SUSPENDED) != 0;
+  last_process_id_ = process->id;
+  last_environment_.clear();
+  if (environment) {
+    const wchar_t *end = environment;
+    while (*end || end[1])
+      ++end;
+    last_environment_.assign(environment, end + 2);
+  }
+  out_info->hProcess = AddHandle(process);
+  out_info->hThread = AddHandle(make_shared<Thread>(process));
+  out_info->dwProcessId = process->id;
+  out_info->dwThreadId = process->id + 2;
+  return TRUE;
+}
+
+DWORD FakePlatform::ResumeThread(HANDLE thread) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Object> found = FindObject(thread);
+  if (!found || found->kind != Object::THREAD) {
+    ::SetLastError(ERROR_INVALID_HANDLE);
+    return static_cast<DWORD>(-1);
+  }
+  Process *process = static_pointer_cast<Thread>(found)->process.get();
+  DWORD previous_count = process->suspended ? 1 : 0;
+  process->suspended = false;
+  return previous_count;
+}
+
+BOOL FakePlatform::TerminateProcess(HANDLE process, UINT exit_code) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found = FindProcess(process);
+  if (!found)
+    return FALSE;
+  if (!found->exited)
+    Exit(found, exit_code, true);
+  return TRUE;
+}
+
+BOOL FakePlatform::DisableHardError(HANDLE process) {
+  AutoLock lock(&crit_sec_);
+  return FindProcess(process) ? TRUE : FALSE;
+}
+
+BOOL FakePlatform::GetExitCodeProcess(HANDLE process, DWORD *out_code) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found = FindProcess(process);
+  if (!found)
+    return FALSE;
+  *out_code = found->exit_code;
+  return TRUE;
+}
+
+BOOL FakePlatform::GetProcessTimes(HANDLE process, FILETIME *out_creation_time,
+                                   FILETIME *out_exit_time,
+                                   FILETIME *out_kernel_time,
+                                   FILETIME *out_user_time) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found = FindProcess(process);
+  if (!found)
+    return FALSE;
+  ToFileTime(found->creation_time, out_creation_time);
+  ToFileTime(found->exit_time, out_exit_time);
+  ToFileTime(found->kernel_time, out_kernel_time);
+  ToFileTime(found->user_time, out_user_time);
+  return TRUE;
+}
+
+BOOL FakePlatform::QueryProcessCycleTime(HANDLE process, ULONG64 *out_cycle) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found = FindProcess(process);
+  if (!found)
+    return FALSE;
+  *out_cycle = found->cycles;
+  return TRUE;
+}
+
+BOOL FakePlatform::GetProcessMemoryCounters(
+    HANDLE process, PROCESS_MEMORY_COUNTERS *out_counters) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found = FindProcess(process);
+  if (!found)
+    return FALSE;
+  *out_counters = {};
+  out_counters->cb = sizeof(PROCESS_MEMORY_COUNTERS);
+  out_counters->WorkingSetSize = found->commit;
+  out_counters->PeakWorkingSetSize = found->peak_commit;
+  out_counters->PagefileUsage = found->commit;
+  out_counters->PeakPagefileUsage = found->peak_commit;
+  return TRUE;
+}
+
+HANDLE FakePlatform::OpenProcess(DWORD access, DWORD process_id) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> process = FindProcessById(process_id);
+  if (!process)
+    return NULL;
+  return AddHandle(process);
+}
+
+BOOL FakePlatform::GetParentProcessId(HANDLE process, DWORD *out_parent_id) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found = FindProcess(process);
+  if (!found)
+    return FALSE;
+  *out_parent_id = found->parent_id;
+  return TRUE;
+}
+
+HANDLE FakePlatform::CreateJob() {
+  AutoLock lock(&crit_sec_);
+  return AddHandle(make_shared<Job>());
+}
+
+BOOL FakePlatform::AssignProcessToJobObject(HANDLE job, HANDLE process) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Job> found_job = FindJob(job);
+  shared_ptr<Process> found_process = FindProcess(process);
+  if (!found_job || !found_process)
+    return FALSE;
+  if (found_process->exited || found_process->job) {
+    ::SetLastError(ERROR_ACCESS_DENIED);
+    return FALSE;
+  }
+  // The process is terminated if it is refused by the job
+  if (!AddToJob(found_job, found_process)) {
+    Exit(found_process, ERROR_NOT_ENOUGH_QUOTA, true);
+    ::SetLastError(ERROR_NOT_ENOUGH_QUOTA);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL FakePlatform::QueryInformationJobObject(HANDLE job,
+                                             JOBOBJECTINFOCLASS info_class,
+                                             PVOID info, DWORD size) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Job> found = FindJob(job);
+  if (!found)
+    return FALSE;
+  switch (info_class) {
+  case JobObjectExtendedLimitInformation:
+    if (size < sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION))
+      break;
+    *reinterpret_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION *>(info) =
+        found->limit;
+    return TRUE;
+  case JobObjectBasicUIRestrictions:
+    if (size < sizeof(JOBOBJECT_BASIC_UI_RESTRICTIONS))
+      break;
+    reinterpret_cast<JOBOBJECT_BASIC_UI_RESTRICTIONS *>(info)
+        ->UIRestrictionsClass = found->ui_limit;
+    return TRUE;
+  case JobObjectBasicAccountingInformation:
+    if (size < sizeof(JOBOBJECT_BASIC_ACCOUNTING_INFORMATION))
+      break;
+    *reinterpret_cast<JOBOBJECT_BASIC_ACCOUNTING_INFORMATION *>(info) =
+        found->account;
+    return TRUE;
+  case JobObjectBasicProcessIdList: {
+    if (size < sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST))
+      break;
+    auto list = reinterpret_cast<JOBOBJECT_BASIC_PROCESS_ID_LIST *>(info);
+    size_t capacity = 1 + (size - sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST)) /
+                              sizeof(ULONG_PTR);
+    list->NumberOfAssignedProcesses =
+        static_cast<DWORD>(found->active.size());
+    list->NumberOfProcessIdsInList = 0;
+    for (const shared_ptr<Process> &process : found->active) {
+      if (list->NumberOfProcessIdsInList == capacity)
+        break;
+      list->ProcessIdList[list->NumberOfProcessIdsInList++] = process->id;
+    }
+    return TRUE;
+  }
+  }
+  ::SetLastError(ERROR_INVALID_PARAMETER);
+  return FALSE;
+}
+
+BOOL FakePlatform::SetInformationJobObject(HANDLE job,
+                                           JOBOBJECTINFOCLASS info_class,
+                                           PVOID info, DWORD size) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Job> found = FindJob(job);
+  if (!found)
+    return FALSE;
+  switch (info_class) {
+  case JobObjectExtendedLimitInformation: {
+    if (size < sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION))
+      break;
+    // The peaks are maintained by the job
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit =
+        *reinterpret_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION *>(info);
+    limit.PeakJobMemoryUsed = found->limit.PeakJobMemoryUsed;
+    limit.PeakProcessMemoryUsed = found->limit.PeakProcessMemoryUsed;
+    found->limit = limit;
+    return TRUE;
+  }
+  case JobObjectBasicUIRestrictions:
+    if (size < sizeof(JOBOBJECT_BASIC_UI_RESTRICTIONS))
+      break;
+    found->ui_limit = reinterpret_cast<JOBOBJECT_BASIC_UI_RESTRICTIONS *>(
+        info)->UIRestrictionsClass;
+    return TRUE;
+  case JobObjectNotificationLimitInformation: {
+    if (size < sizeof(JOBOBJECT_NOTIFICATION_LIMIT_INFORMATION))
+      break;
+    // Only the job memory notification limit is simulated
+    JOBOBJECT_NOTIFICATION_LIMIT_INFORMATION *limit =
+        reinterpret_cast<JOBOBJECT_NOTIFICATION_LIMIT_INFORMATION *>(info);
+    found->notification_memory_limit =
+        (limit->LimitFlags & JOB_OBJECT_LIMIT_JOB_MEMORY)
+            ? static_cast<SIZE_T>(limit->JobMemoryLimit) : 0;
+    return TRUE;
+  }
+  case JobObjectAssociateCompletionPortInformation: {
+    if (size < sizeof(JOBOBJECT_ASSOCIATE_COMPLETION_PORT) || found->port)
+      break;
+    JOBOBJECT_ASSOCIATE_COMPLETION_PORT *association =
+        reinterpret_cast<JOBOBJECT_ASSOCIATE_COMPLETION_PORT *>(info);
+    shared_ptr<Port> port = FindPort(association->CompletionPort);
+    if (!port)
+      return FALSE;
+    found->port = port;
+    found->key = reinterpret_cast<ULONG_PTR>(association->CompletionKey);
+    // The processes already in the job are reported as new processes
+    for (const shared_ptr<Process> &process : found->active)
+      PostJobMessage(found.get(), JOB_OBJECT_MSG_NEW_PROCESS, process->id);
+    return TRUE;
+  }
+  }
+  ::SetLastError(ERROR_INVALID_PARAMETER);
+  return FALSE;
+}
+
+BOOL FakePlatform::TerminateJobObject(HANDLE job, UINT exit_code) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Job> found = FindJob(job);
+  if (!found)
+    return FALSE;
+  vector<shared_ptr<Process>> active = found->active;
+  for (const shared_ptr<Process> &process : active)
+    Exit(process, exit_code, true);
+  return TRUE;
+}
+
+BOOL FakePlatform::IsProcessInJob(HANDLE process, HANDLE job,
+                                  BOOL *out_result) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Process> found_process = FindProcess(process);
+  shared_ptr<Job> found_job = FindJob(job);
+  if (!found_process || !found_job)
+    return FALSE;
+  *out_result = found_process->job == found_job;
+  return TRUE;
+}
+
+BOOL FakePlatform::OpenProcessToken(DWORD access, HANDLE *out_token) {
+  AutoLock lock(&crit_sec_);
+  *out_token = AddHandle(make_shared<Token>());
+  return TRUE;
+}
+
+BOOL FakePlatform::CreateRestrictedToken(HANDLE token, DWORD flags,
+                                         DWORD sids_count,
+                                         SID_AND_ATTRIBUTES *sids,
+                                         HANDLE *out_token) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Token> found = FindToken(token);
+  if (!found)
+    return FALSE;
+  auto restricted_token = make_shared<Token>();
+  restricted_token->integrity_level = found->integrity_level;
+  restricted_token->restricted_sids_count =
+      found->restricted_sids_count + sids_count;
+  *out_token = AddHandle(restricted_token);
+  return TRUE;
+}
+
+BOOL FakePlatform::GetTokenInformation(HANDLE token,
+                                       TOKEN_INFORMATION_CLASS info_class,
+                                       PVOID info, DWORD size,
+                                       DWORD *out_size) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Token> found = FindToken(token);
+  if (!found)
+    return FALSE;
+  DWORD header_size;
+  BYTE sub_authority_count;
+  switch (info_class) {
+  case TokenUser:
+    header_size = sizeof(TOKEN_USER);
+    sub_authority_count = ARRAYSIZE(USER_SUB_AUTHORITIES);
+    break;
+  case TokenGroups:
+    header_size = sizeof(TOKEN_GROUPS);
+    sub_authority_count = ARRAYSIZE(LOGON_SUB_AUTHORITIES);
+    break;
+  case TokenIntegrityLevel:
+    header_size = sizeof(TOKEN_MANDATORY_LABEL);
+    sub_authority_count = 1;
+    break;
+  default:
+    ::SetLastError(ERROR_INVALID_PARAMETER);
+    return FALSE;
+  }
+  *out_size = header_size + ::GetSidLengthRequired(sub_authority_count);
+  if (size < *out_size) {
+    ::SetLastError(ERROR_INSUFFICIENT_BUFFER);
+    return FALSE;
+  }
+
+  PSID sid = reinterpret_cast<BYTE *>(info) + header_size;
+  switch (info_class) {
+  case TokenUser: {
+    SID_IDENTIFIER_AUTHORITY authority = SECURITY_NT_AUTHORITY;
+    WriteSid(sid, authority, USER_SUB_AUTHORITIES, sub_authority_count);
+    TOKEN_USER *user = reinterpret_cast<TOKEN_USER *>(info);
+    user->User.Sid = sid;
+    user->User.Attributes = 0;
+    break;
+  }
+  case TokenGroups: {
+    SID_IDENTIFIER_AUTHORITY authority = SECURITY_NT_AUTHORITY;
+    WriteSid(sid, authority, LOGON_SUB_AUTHORITIES, sub_authority_count);
+    TOKEN_GROUPS *groups = reinterpret_cast<TOKEN_GROUPS *>(info);
+    groups->GroupCount = 1;
+    groups->Groups[0].Sid = sid;
+    groups->Groups[0].Attributes = SE_GROUP_LOGON_ID | SE_GROUP_ENABLED;
+    break;
+  }
+  default: {
+    SID_IDENTIFIER_AUTHORITY authority = SECURITY_MANDATORY_LABEL_AUTHORITY;
+    WriteSid(sid, authority, &found->integrity_level, sub_authority_count);
+    TOKEN_MANDATORY_LABEL *label =
+        reinterpret_cast<TOKEN_MANDATORY_LABEL *>(info);
+    label->Label.Sid = sid;
+    label->Label.Attributes = SE_GROUP_INTEGRITY;
+    break;
+  }
+  }
+  return TRUE;
+}
+
+BOOL FakePlatform::SetTokenInformation(HANDLE token,
+                                       TOKEN_INFORMATION_CLASS info_class,
+                                       PVOID info, DWORD size) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Token> found = FindToken(token);
+  if (!found)
+    return FALSE;
+  if (info_class != TokenIntegrityLevel ||
+      size < sizeof(TOKEN_MANDATORY_LABEL)) {
+    ::SetLastError(ERROR_INVALID_PARAMETER);
+    return FALSE;
+  }
+  PSID sid = reinterpret_cast<TOKEN_MANDATORY_LABEL *>(info)->Label.Sid;
+  if (*::GetSidSubAuthorityCount(sid) != 1) {
+    ::SetLastError(ERROR_INVALID_PARAMETER);
+    return FALSE;
+  }
+  found->integrity_level = *::GetSidSubAuthority(sid, 0);
+  return TRUE;
+}
+
+HANDLE FakePlatform::CreateCompletionPort() {
+  AutoLock lock(&crit_sec_);
+  return AddHandle(make_shared<Port>());
+}
+
+BOOL FakePlatform::PostQueuedCompletionStatus(HANDLE port, DWORD bytes,
+                                              ULONG_PTR key,
+                                              LPOVERLAPPED overlapped) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Port> found = FindPort(port);
+  if (!found)
+    return FALSE;
+  OVERLAPPED_ENTRY entry = {};
+  entry.lpCompletionKey = key;
+  entry.lpOverlapped = overlapped;
+  entry.dwNumberOfBytesTransferred = bytes;
+  found->entries.push_back(entry);
+  ::WakeAllConditionVariable(&changed_);
+  return TRUE;
+}
+
+BOOL FakePlatform::GetQueuedCompletionStatusEx(HANDLE port,
+                                               OVERLAPPED_ENTRY *entries,
+                                               ULONG count, ULONG *out_count,
+                                               DWORD timeout_ms) {
+  AutoLock lock(&crit_sec_);
+  shared_ptr<Port> found = FindPort(port);
+  if (!found)
+    return FALSE;
+  ULONGLONG deadline = ::GetTickCount64() + timeout_ms;
+  while (found->entries.empty()) {
+    if (found->closed) {
+      ::SetLastError(ERROR_ABANDONED_WAIT_0);
+      return FALSE;
+    }
+    if (!WaitChange(timeout_ms, deadline)) {
+      ::SetLastError(WAIT_TIMEOUT);
+      return FALSE;
+    }
+  }
+  ULONG actual_count = 0;
+  while (actual_count < count && !found->entries.empty()) {
+    entries[actual_count++] = found->entries.front();
+    found->entries.pop_front();
+  }
+  *out_count = actual_count;
+  return TRUE;
+}
+
+HANDLE FakePlatform::AddHandle(const shared_ptr<Object> &object) {
+  HANDLE handle = reinterpret_cast<HANDLE>(next_handle_);
+  next_handle_ += 4;
+  handles_[handle] = object;
+  return handle;
+}
+
+shared_ptr<FakePlatform::Object> FakePlatform::FindObject(HANDLE handle) {
+  auto iter = handles_.find(handle);
+  if (iter == handles_.end())
+    return nullptr;
+  return iter->second;
+}
+
+shared_ptr<FakePlatform::Process> FakePlatform::FindProcess(HANDLE handle) {
+  shared_ptr<Object> found = FindObject(handle);
+  if (!found || found->kind != Object::PROCESS) {
+    ::SetLastError(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+  return static_pointer_cast<Process>(found);
+}
+
+shared_ptr<FakePlatform::Process> FakePlatform::FindProcessById(
+    DWORD process_id) {
+  auto iter = processes_.find(process_id);
+  if (iter == processes_.end()) {
+    ::SetLastError(ERROR_INVALID_PARAMETER);
+    return nullptr;
+  }
+  return iter->second;
+}
+
+shared_ptr<FakePlatform::Job> FakePlatform::FindJob(HANDLE handle) {
+  shared_ptr<Object> found = FindObject(handle);
+  if (!found || found->kind != Object::JOB) {
+    ::SetLastError(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+  return static_pointer_cast<Job>(found);
+}
+
+shared_ptr<FakePlatform::Port> FakePlatform::FindPort(HANDLE handle) {
+  shared_ptr<Object> found = FindObject(handle);
+  if (!found || found->kind != Object::PORT) {
+    ::SetLastError(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+  return static_pointer_cast<Port>(found);
+}
+
+shared_ptr<FakePlatform::Token> FakePlatform::FindToken(HANDLE handle) {
+  shared_ptr<Object> found = FindObject(handle);
+  if (!found || found->kind != Object::TOKEN) {
+    ::SetLastError(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+  return static_pointer_cast<Token>(found);
+}
+
+shared_ptr<FakePlatform::Process> FakePlatform::NewProcess() {
+  auto process = make_shared<Process>();
+  process->id = next_process_id_;
+  next_process_id_ += 4;
+  clock_ += CLOCK_TICK;
+  process->creation_time = clock_;
+  processes_[process->id] = process;
+  ++process_count_;
+  return process;
+}
+
+BOOL FakePlatform::AddToJob(const shared_ptr<Job> &job,
+                            const shared_ptr<Process> &process) {
+  const JOBOBJECT_BASIC_LIMIT_INFORMATION &limit =
+      job->limit.BasicLimitInformation;
+  if ((limit.LimitFlags & JOB_OBJECT_LIMIT_ACTIVE_PROCESS) &&
+      job->active.size() >= limit.ActiveProcessLimit) {
+    PostJobMessage(job.get(), JOB_OBJECT_MSG_ACTIVE_PROCESS_LIMIT, 0);
+    ::SetLastError(ERROR_NOT_ENOUGH_QUOTA);
+    return FALSE;
+  }
+  process->job = job;
+  job->active.push_back(process);
+  job->memory += process->commit;
+  ++job->account.TotalProcesses;
+  ++job->account.ActiveProcesses;
+  PostJobMessage(job.get(), JOB_OBJECT_MSG_NEW_PROCESS, process->id);
+  return TRUE;
+}
+
+void FakePlatform::Exit(const shared_ptr<Process> &process, DWORD exit_code,
+                        bool terminated) {
+  process->exited = true;
+  process->exit_code = exit_code;
+  process->exit_time = clock_;
+  processes_.erase(process->id);
+  Job *job = process->job.get();
+  if (job) {
+    job->active.erase(find(job->active.begin(), job->active.end(), process));
+    job->memory -= process->commit;
+    --job->account.ActiveProcesses;
+    if (terminated)
+      ++job->account.TotalTerminatedProcesses;
+    // Exit codes of the exception range are abnormal
+    bool abnormal = (exit_code & 0xC0000000) == 0xC0000000;
+    PostJobMessage(job, abnormal ? JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS
+                                 : JOB_OBJECT_MSG_EXIT_PROCESS,
+                   process->id);
+    if (job->active.empty())
+      PostJobMessage(job, JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO, 0);
+  }
+  ::WakeAllConditionVariable(&changed_);
+}
+
+void FakePlatform::PostJobMessage(Job *job, DWORD message_id,
+                                  DWORD process_id) {
+  if (!job->port || job->port->closed)
+    return;
+  OVERLAPPED_ENTRY entry = {};
+  entry.lpCompletionKey = job->key;
+  entry.lpOverlapped = reinterpret_cast<LPOVERLAPPED>(
+      static_cast<uintptr_t>(process_id));
+  entry.dwNumberOfBytesTransferred = message_id;
+  job->port->entries.push_back(entry);
+  ::WakeAllConditionVariable(&changed_);
+}
+
+bool FakePlatform::WaitChange(DWORD timeout_ms, ULONGLONG deadline) {
+  DWORD wait_ms = INFINITE;
+  if (timeout_ms != INFINITE) {
+    ULONGLONG now = ::GetTickCount64();
+    if (now >= deadline)
+      return false;
+    wait_ms = static_cast<DWORD>(deadline - now);
+  }
+  ::SleepConditionVariableCS(&changed_, &crit_sec_, wait_ms);
+  return true;
+}
+
+}
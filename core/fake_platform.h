@@ -0,0 +1,167 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_FAKE_PLATFORM_H_
+#define WINC_CORE_FAKE_PLATFORM_H_
+
+#include <Windows.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "core/platform.h"
+
+namespace winc {
+
+// An in-memory platform for tests and benchmarks of the library itself.
+// Processes, job objects, tokens and completion ports are simulated
+// without calling the operating system. Nothing runs in a fake process,
+// the test drives it with the Simulate methods instead, and the job
+// messages are queued to the completion port in the order of the calls.
+//
+// Closing and waiting on handles which are not created by the fake
+// platform, e.g. pipes and events, are passed through to the operating
+// system. The fake handles never collide with real ones, as their low bits
+// are set.
+class FakePlatform : public Platform {
+public:
+  FakePlatform();
+  virtual ~FakePlatform() override;
+
+  // Simulation of the running processes, the processes are identified by
+  // their process ID. These fail with ERROR_INVALID_PARAMETER if the
+  // process does not exist or has exited.
+
+  // Adds user time, kernel time in 100 nanoseconds and cycles
+  BOOL SimulateRun(DWORD process_id, ULONG64 user_time, ULONG64 kernel_time,
+                   ULONG64 cycles);
+  // Commits memory, fails with ERROR_NOT_ENOUGH_MEMORY and posts the memory
+  // limit message beyond the job memory limit. Posts the notification limit
+  // message beyond the armed notification limit. A negative size decommits.
+  BOOL SimulateAllocation(DWORD process_id, SSIZE_T size);
+  // Creates a running child process in the job of the given process,
+  // fails with ERROR_NOT_ENOUGH_QUOTA beyond the active process limit
+  BOOL SimulateChild(DWORD parent_id, DWORD *out_child_id);
+  // Exits the process with the exit code
+  BOOL SimulateExit(DWORD process_id, DWORD exit_code);
+
+  // Process ID of the last process created by CreateUserProcess
+  DWORD last_process_id();
+  // Environment block of the last process created by CreateUserProcess,
+  // including the final nulls, empty if the environment is inherited
+  std::vector<wchar_t> last_environment();
+  // Number of processes created, including the simulated children but not
+  // the refused ones
+  unsigned int process_count();
+  // Number of open handles created by the fake platform
+  unsigned int handle_count();
+
+public:
+  virtual BOOL CloseHandle(HANDLE object) override;
+  virtual BOOL DuplicateHandle(HANDLE object, HANDLE *out_object) override;
+  virtual DWORD WaitForSingleObject(HANDLE object, DWORD timeout_ms) override;
+  virtual BOOL CreateUserProcess(HANDLE token,
+                                 const wchar_t *exe_path,
+                                 wchar_t *command_line,
+                                 BOOL inherit_handles,
+                                 DWORD creation_flags,
+                                 const wchar_t *environment,
+                                 const wchar_t *current_directory,
+                                 STARTUPINFOW *startup_info,
+                                 PROCESS_INFORMATION *out_info) override;
+  virtual DWORD ResumeThread(HANDLE thread) override;
+  virtual BOOL TerminateProcess(HANDLE process, UINT exit_code) override;
+  virtual BOOL DisableHardError(HANDLE process) override;
+  virtual BOOL GetExitCodeProcess(HANDLE process, DWORD *out_code) override;
+  virtual BOOL GetProcessTimes(HANDLE process, FILETIME *out_creation_time,
+                               FILETIME *out_exit_time,
+                               FILETIME *out_kernel_time,
+                               FILETIME *out_user_time) override;
+  virtual BOOL QueryProcessCycleTime(HANDLE process,
+                                     ULONG64 *out_cycle) override;
+  virtual BOOL GetProcessMemoryCounters(
+      HANDLE process, PROCESS_MEMORY_COUNTERS *out_counters) override;
+  virtual HANDLE OpenProcess(DWORD access, DWORD process_id) override;
+  virtual BOOL GetParentProcessId(HANDLE process,
+                                  DWORD *out_parent_id) override;
+  virtual HANDLE CreateJob() override;
+  virtual BOOL AssignProcessToJobObject(HANDLE job, HANDLE process) override;
+  virtual BOOL QueryInformationJobObject(HANDLE job,
+                                         JOBOBJECTINFOCLASS info_class,
+                                         PVOID info, DWORD size) override;
+  virtual BOOL SetInformationJobObject(HANDLE job,
+                                       JOBOBJECTINFOCLASS info_class,
+                                       PVOID info, DWORD size) override;
+  virtual BOOL TerminateJobObject(HANDLE job, UINT exit_code) override;
+  virtual BOOL IsProcessInJob(HANDLE process, HANDLE job,
+                              BOOL *out_result) override;
+  virtual BOOL OpenProcessToken(DWORD access, HANDLE *out_token) override;
+  virtual BOOL CreateRestrictedToken(HANDLE token, DWORD flags,
+                                     DWORD sids_count,
+                                     SID_AND_ATTRIBUTES *sids,
+                                     HANDLE *out_token) override;
+  virtual BOOL GetTokenInformation(HANDLE token,
+                                   TOKEN_INFORMATION_CLASS info_class,
+                                   PVOID info, DWORD size,
+                                   DWORD *out_size) override;
+  virtual BOOL SetTokenInformation(HANDLE token,
+                                   TOKEN_INFORMATION_CLASS info_class,
+                                   PVOID info, DWORD size) override;
+  virtual HANDLE CreateCompletionPort() override;
+  virtual BOOL PostQueuedCompletionStatus(HANDLE port, DWORD bytes,
+                                          ULONG_PTR key,
+                                          LPOVERLAPPED overlapped) override;
+  virtual BOOL GetQueuedCompletionStatusEx(HANDLE port,
+                                           OVERLAPPED_ENTRY *entries,
+                                           ULONG count, ULONG *out_count,
+                                           DWORD timeout_ms) override;
+
+private:
+  struct Object;
+  struct Process;
+  struct Thread;
+  struct Job;
+  struct Port;
+  struct Token;
+
+  // All of these must be called with the lock held
+  HANDLE AddHandle(const std::shared_ptr<Object> &object);
+  std::shared_ptr<Object> FindObject(HANDLE handle);
+  std::shared_ptr<Process> FindProcess(HANDLE handle);
+  std::shared_ptr<Process> FindProcessById(DWORD process_id);
+  std::shared_ptr<Job> FindJob(HANDLE handle);
+  std::shared_ptr<Port> FindPort(HANDLE handle);
+  std::shared_ptr<Token> FindToken(HANDLE handle);
+  std::shared_ptr<Process> NewProcess();
+  BOOL AddToJob(const std::shared_ptr<Job> &job,
+                const std::shared_ptr<Process> &process);
+  void Exit(const std::shared_ptr<Process> &process, DWORD exit_code,
+            bool terminated);
+  void PostJobMessage(Job *job, DWORD message_id, DWORD process_id);
+  // Waits for a change until the deadline, returns false on timeout
+  bool WaitChange(DWORD timeout_ms, ULONGLONG deadline);
+
+private:
+  CRITICAL_SECTION crit_sec_;
+  // Woken on every process exit and every queued message
+  CONDITION_VARIABLE changed_;
+  ULONG_PTR next_handle_;
+  DWORD next_process_id_;
+  DWORD last_process_id_;
+  std::vector<wchar_t> last_environment_;
+  unsigned int process_count_;
+  // Time of the simulated clock in 100 nanoseconds
+  ULONG64 clock_;
+  std::unordered_map<HANDLE, std::shared_ptr<Object>> handles_;
+  // Processes which have not exited
+  std::unordered_map<DWORD, std::shared_ptr<Process>> processes_;
+
+private:
+  FakePlatform(const FakePlatform &) = delete;
+  void operator=(const FakePlatform &) = delete;
+};
+
+}
+
+#endif
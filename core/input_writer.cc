@@ -0,0 +1,85 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/input_writer.h"
+
+#include <Windows.h>
+#include <algorithm>
+
+#include <winc_types.h>
+#include <winc/util.h>
+
+using std::min;
+
+namespace winc {
+
+namespace {
+
+const DWORD kWriteSize = 64 * 1024;
+
+}
+
+InputWriter::InputWriter()
+  : data_(nullptr)
+  , size_(0)
+  {}
+
+InputWriter::~InputWriter() {
+  if (!thread_)
+    return;
+  // A write which starts after the cancellation is not cancelled, so
+  // cancel until the thread exits
+  while (::WaitForSingleObject(thread_.get(), 10) == WAIT_TIMEOUT)
+    ::CancelSynchronousIo(thread_.get());
+}
+
+ResultCode InputWriter::Init(const char *data, size_t size,
+                             HANDLE *out_read_handle) {
+  SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+  HANDLE read_handle, write_handle;
+  if (!::CreatePipe(&read_handle, &write_handle, &sa, 0))
+    return WINC_ERROR_UTIL;
+  read_handle_.reset(read_handle);
+  write_handle_.reset(write_handle);
+  if (!::SetHandleInformation(write_handle, HANDLE_FLAG_INHERIT, 0))
+    return WINC_ERROR_UTIL;
+  data_ = data;
+  size_ = size;
+  *out_read_handle = read_handle;
+  return WINC_OK;
+}
+
+ResultCode InputWriter::Start() {
+  // The pipe breaks once the target and its children close their copies
+  read_handle_.reset();
+  HANDLE thread = ::CreateThread(NULL, 0, WriterThread, this, 0, NULL);
+  if (!thread)
+    return WINC_ERROR_UTIL;
+  thread_.reset(thread);
+  return WINC_OK;
+}
+
+DWORD WINAPI InputWriter::WriterThread(PVOID param) {
+  reinterpret_cast<InputWriter *>(param)->Write();
+  return 0;
+}
+
+void InputWriter::Write() {
+  // A target which exits without reading breaks the pipe, which is not an
+  // error of the target
+  const char *data = data_;
+  size_t remaining = size_;
+  while (remaining) {
+    DWORD written;
+    if (!::WriteFile(write_handle_.get(), data,
+                     static_cast<DWORD>(min<size_t>(remaining, kWriteSize)),
+                     &written, NULL))
+      break;
+    data += written;
+    remaining -= written;
+  }
+  write_handle_.reset();
+}
+
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_INPUT_WRITER_H_
+#define WINC_CORE_INPUT_WRITER_H_
+
+#include <Windows.h>
+
+#include <winc_types.h>
+#include <winc/util.h>
+
+namespace winc {
+
+// Feeds a buffer into a pipe on a thread of its own, so that an input
+// larger than the pipe does not block until the target reads it. The pipe
+// is closed once the whole input is written, which ends the input of the
+// target.
+class InputWriter {
+public:
+  InputWriter();
+  // Cancels the pending write and waits for the thread
+  ~InputWriter();
+
+  // Creates the pipe, the read handle is inheritable and stays valid until
+  // Start. The data must outlive the writer.
+  ResultCode Init(const char *data, size_t size, HANDLE *out_read_handle);
+
+  // Closes the read handle of the writer, to be called once the target
+  // inherited it, and starts writing
+  ResultCode Start();
+
+private:
+  static DWORD WINAPI WriterThread(PVOID param);
+  void Write();
+
+private:
+  const char *data_;
+  size_t size_;
+  unique_handle read_handle_;
+  unique_handle write_handle_;
+  unique_handle thread_;
+
+private:
+  InputWriter(const InputWriter &) = delete;
+  void operator=(const InputWriter &) = delete;
+};
+
+}
+
+#endif
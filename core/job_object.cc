@@ -4,11 +4,16 @@
 
 #include "core/job_object.h"
 
+#include <memory>
 #include <unordered_set>
 
 #include <winc/container.h>
 #include <winc/target.h>
+#include <winc/util.h>
+#include "core/platform.h"
+#include "core/process_table.h"
 
+using std::shared_ptr;
 using std::unordered_set;
 
 namespace winc {
@@ -23,12 +28,12 @@ public:
 
   ~JobObjectSharedResource() {
     if (completion_port)
-      ::CloseHandle(completion_port);
+      Platform::Get()->CloseHandle(completion_port);
     ::DeleteCriticalSection(&crit_sec);
   }
 
   ResultCode Init() {
-    HANDLE port = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    HANDLE port = Platform::Get()->CreateCompletionPort();
     if (!port)
       return WINC_ERROR_COMPLETION_PORT;
     completion_port = port;
@@ -61,6 +66,9 @@ public:
 
 namespace {
 
+// Process IDs queried at once while waiting for a terminated job
+const size_t kProcessIdListSize = 64;
+
 JobObjectSharedResource *g_shared = nullptr;
 
 ResultCode InitJobObjectSharedResource(JobObjectSharedResource **out_sr) {
@@ -90,73 +98,142 @@ ResultCode InitJobObjectSharedResource(JobObjectSharedResource **out_sr) {
 }
 
 ResultCode JobObject::Init() {
-  HANDLE job = ::CreateJobObjectW(NULL, NULL);
+  HANDLE job = Platform::Get()->CreateJob();
   if (!job)
     return WINC_ERROR_JOB_OBJECT;
   job_.reset(job);
   return WINC_OK;
 }
 
+ResultCode JobObject::Init(DWORD basic_limit, DWORD ui_limit) {
+  ResultCode rc = Init();
+  if (rc != WINC_OK)
+    return rc;
+
+  {
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit = {};
+    limit.BasicLimitInformation.LimitFlags = basic_limit;
+    rc = SetBasicLimit(limit);
+    if (rc != WINC_OK)
+      return rc;
+  }
+  {
+    JOBOBJECT_BASIC_UI_RESTRICTIONS limit = {};
+    limit.UIRestrictionsClass = ui_limit;
+    rc = SetUILimit(limit);
+    if (rc != WINC_OK)
+      return rc;
+  }
+  return WINC_OK;
+}
+
 ResultCode JobObject::AssignProcess(HANDLE process) {
-  if (!::AssignProcessToJobObject(job_.get(), process))
+  if (!Platform::Get()->AssignProcessToJobObject(job_.get(), process))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
 ResultCode JobObject::GetBasicLimit(JOBOBJECT_EXTENDED_LIMIT_INFORMATION *limit) {
-  if (!::QueryInformationJobObject(job_.get(),
-                                   JobObjectExtendedLimitInformation,
-                                   limit,
-                                   sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION),
-                                   NULL))
+  if (!Platform::Get()->QueryInformationJobObject(
+      job_.get(), JobObjectExtendedLimitInformation, limit,
+      sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION)))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
 ResultCode JobObject::SetBasicLimit(const JOBOBJECT_EXTENDED_LIMIT_INFORMATION &limit) {
-  if (!::SetInformationJobObject(job_.get(),
-                                 JobObjectExtendedLimitInformation,
-                                 const_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION *>(&limit),
-                                 sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION)))
+  if (!Platform::Get()->SetInformationJobObject(
+      job_.get(), JobObjectExtendedLimitInformation,
+      const_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION *>(&limit),
+      sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION)))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
 ResultCode JobObject::GetUILimit(JOBOBJECT_BASIC_UI_RESTRICTIONS *limit) {
-  if (!::QueryInformationJobObject(job_.get(),
-                                   JobObjectBasicUIRestrictions,
-                                   limit,
-                                   sizeof(JOBOBJECT_BASIC_UI_RESTRICTIONS),
-                                   NULL))
+  if (!Platform::Get()->QueryInformationJobObject(
+      job_.get(), JobObjectBasicUIRestrictions, limit,
+      sizeof(JOBOBJECT_BASIC_UI_RESTRICTIONS)))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
 
 ResultCode JobObject::SetUILimit(const JOBOBJECT_BASIC_UI_RESTRICTIONS &ui_limit) {
-  if (!::SetInformationJobObject(job_.get(), JobObjectBasicUIRestrictions,
+  if (!Platform::Get()->SetInformationJobObject(
+      job_.get(), JobObjectBasicUIRestrictions,
       const_cast<JOBOBJECT_BASIC_UI_RESTRICTIONS *>(&ui_limit),
       sizeof(JOBOBJECT_BASIC_UI_RESTRICTIONS)))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
+ResultCode JobObject::SetMemoryNotificationLimit(SIZE_T limit) {
+  JOBOBJECT_NOTIFICATION_LIMIT_INFORMATION info = {};
+  if (limit) {
+    info.LimitFlags = JOB_OBJECT_LIMIT_JOB_MEMORY;
+    info.JobMemoryLimit = limit;
+  }
+  if (!Platform::Get()->SetInformationJobObject(
+      job_.get(), JobObjectNotificationLimitInformation, &info, sizeof(info)))
+    return WINC_ERROR_JOB_OBJECT;
+  return WINC_OK;
+}
+
 ResultCode JobObject::GetAccountInfo(JOBOBJECT_BASIC_ACCOUNTING_INFORMATION *info) {
-  if (!::QueryInformationJobObject(job_.get(),
-                                   JobObjectBasicAccountingInformation,
-                                   info,
-                                   sizeof(JOBOBJECT_BASIC_ACCOUNTING_INFORMATION),
-                                   NULL))
+  if (!Platform::Get()->QueryInformationJobObject(
+      job_.get(), JobObjectBasicAccountingInformation, info,
+      sizeof(JOBOBJECT_BASIC_ACCOUNTING_INFORMATION)))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
 ResultCode JobObject::Terminate(UINT exit_code) {
-  if (!::TerminateJobObject(job_.get(), exit_code))
+  if (!Platform::Get()->TerminateJobObject(job_.get(), exit_code))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
 
+ResultCode JobObject::TerminateAndWait(UINT exit_code) {
+  ResultCode rc = Terminate(exit_code);
+  if (rc != WINC_OK)
+    return rc;
+  Platform *platform = Platform::Get();
+  while (true) {
+    JOBOBJECT_BASIC_ACCOUNTING_INFORMATION info;
+    rc = GetAccountInfo(&info);
+    if (rc != WINC_OK)
+      return rc;
+    if (!info.ActiveProcesses)
+      return WINC_OK;
+    // The terminated processes leave the job as they are torn down, wait
+    // for the listed ones and query again
+    struct {
+      JOBOBJECT_BASIC_PROCESS_ID_LIST list;
+      ULONG_PTR more_ids[kProcessIdListSize - 1];
+    } ids;
+    if (!platform->QueryInformationJobObject(
+        job_.get(), JobObjectBasicProcessIdList, &ids, sizeof(ids)) &&
+        ::GetLastError() != ERROR_MORE_DATA)
+      return WINC_ERROR_JOB_OBJECT;
+    bool waited = false;
+    for (DWORD i = 0; i < ids.list.NumberOfProcessIdsInList; ++i) {
+      unique_handle process(platform->OpenProcess(
+          SYNCHRONIZE, static_cast<DWORD>(ids.list.ProcessIdList[i])));
+      // The ID may have been reused by a process out of the job
+      BOOL in_job;
+      if (!process ||
+          !platform->IsProcessInJob(process.get(), job_.get(), &in_job) ||
+          !in_job)
+        continue;
+      platform->WaitForSingleObject(process.get(), INFINITE);
+      waited = true;
+    }
+    if (!waited)
+      ::Sleep(1);
+  }
+}
+
 ResultCode JobObject::AssociateCompletionPort(Target *target) {
   JobObjectSharedResource *sr;
   ResultCode rc = InitJobObjectSharedResource(&sr);
@@ -173,9 +250,9 @@ ResultCode JobObject::AssociateCompletionPort(Target *target) {
   JOBOBJECT_ASSOCIATE_COMPLETION_PORT port;
   port.CompletionKey = target;
   port.CompletionPort = sr->completion_port;
-  if (!::SetInformationJobObject(job_.get(),
-                                 JobObjectAssociateCompletionPortInformation,
-                                 &port, sizeof(port)))
+  if (!Platform::Get()->SetInformationJobObject(
+      job_.get(), JobObjectAssociateCompletionPortInformation,
+      &port, sizeof(port)))
     return WINC_ERROR_JOB_OBJECT;
   return WINC_OK;
 }
@@ -187,42 +264,104 @@ void JobObject::DeassociateCompletionPort(Target *target) {
   ::LeaveCriticalSection(&sr->crit_sec);
 }
 
+ResultCode JobObject::AttachTargetForTesting(Target *target) {
+  JobObjectSharedResource *sr;
+  ResultCode rc = InitJobObjectSharedResource(&sr);
+  if (rc != WINC_OK)
+    return rc;
+  rc = sr->GuardCompletionPortThread();
+  if (rc != WINC_OK)
+    return rc;
+
+  ::EnterCriticalSection(&sr->crit_sec);
+  sr->attached_target.insert(target);
+  ::LeaveCriticalSection(&sr->crit_sec);
+  target->listening_ = true;
+  return WINC_OK;
+}
+
+ResultCode JobObject::PostMessageForTesting(Target *target, DWORD message_id,
+                                            DWORD process_id) {
+  JobObjectSharedResource *sr = g_shared;
+  if (!sr)
+    return WINC_ERROR_COMPLETION_PORT;
+  // Same layout as the messages posted by the system for job objects
+  if (!Platform::Get()->PostQueuedCompletionStatus(
+      sr->completion_port, message_id, reinterpret_cast<ULONG_PTR>(target),
+      reinterpret_cast<LPOVERLAPPED>(static_cast<uintptr_t>(process_id))))
+    return WINC_ERROR_COMPLETION_PORT;
+  return WINC_OK;
+}
+
+void JobObject::RecordProcess(JobObjectSharedResource *sr, Target *target,
+                              DWORD message_id, DWORD process_id) {
+  // The process is queried outside of the lock, so that the other targets
+  // are not held up by the system calls. The table is kept alive by the
+  // reference in case the target is destroyed meanwhile.
+  shared_ptr<ProcessTable> process_table;
+  ::EnterCriticalSection(&sr->crit_sec);
+  if (sr->attached_target.find(target) != sr->attached_target.end())
+    process_table = target->process_table_;
+  ::LeaveCriticalSection(&sr->crit_sec);
+  // Targets attached for testing have no table
+  if (!process_table)
+    return;
+  if (message_id == JOB_OBJECT_MSG_NEW_PROCESS)
+    process_table->AddProcess(process_id);
+  else
+    process_table->FinishProcess(process_id);
+}
+
 DWORD WINAPI JobObject::MessageThread(PVOID param) {
   const ULONG ENTRY_PER_CALL = 16;
   JobObjectSharedResource *sr =
       reinterpret_cast<JobObjectSharedResource *>(param);
   OVERLAPPED_ENTRY entries[ENTRY_PER_CALL];
   ULONG actual_count;
-  while (::GetQueuedCompletionStatusEx(sr->completion_port, entries,
-                                       ENTRY_PER_CALL, &actual_count,
-                                       INFINITE, FALSE)) {
+  Platform *platform = Platform::Get();
+  while (platform->GetQueuedCompletionStatusEx(sr->completion_port, entries,
+                                               ENTRY_PER_CALL, &actual_count,
+                                               INFINITE)) {
     for (OVERLAPPED_ENTRY *entry = entries;
          entry != entries + actual_count; ++entry) {
       Target *target =
           reinterpret_cast<Target *>(entry->lpCompletionKey);
+      DWORD message_id = entry->dwNumberOfBytesTransferred;
+      if (message_id == JOB_OBJECT_MSG_NEW_PROCESS ||
+          message_id == JOB_OBJECT_MSG_EXIT_PROCESS ||
+          message_id == JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS)
+        RecordProcess(sr, target, message_id, static_cast<DWORD>(
+            reinterpret_cast<uintptr_t>(entry->lpOverlapped)));
       ::EnterCriticalSection(&sr->crit_sec);
       if (sr->attached_target.find(target) != sr->attached_target.end()) {
-        DWORD message_id = entry->dwNumberOfBytesTransferred;
         switch (message_id) {
         case JOB_OBJECT_MSG_ACTIVE_PROCESS_LIMIT:
           target->OnActiveProcessLimit();
           break;
         case JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO:
+          target->ReleaseResources();
           target->OnExitAll();
           break;
-        case JOB_OBJECT_MSG_NEW_PROCESS:
-          target->OnNewProcess(static_cast<DWORD>(
-              reinterpret_cast<uintptr_t>(entry->lpOverlapped)));
+        case JOB_OBJECT_MSG_NEW_PROCESS: {
+          DWORD process_id = static_cast<DWORD>(
+              reinterpret_cast<uintptr_t>(entry->lpOverlapped));
+          target->OnNewProcess(process_id);
           break;
+        }
         case JOB_OBJECT_MSG_EXIT_PROCESS:
-        case JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS:
-          target->OnExitProcess(static_cast<DWORD>(
-              reinterpret_cast<uintptr_t>(entry->lpOverlapped)));
+        case JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS: {
+          DWORD process_id = static_cast<DWORD>(
+              reinterpret_cast<uintptr_t>(entry->lpOverlapped));
+          target->OnExitProcess(process_id);
           break;
+        }
         case JOB_OBJECT_MSG_JOB_MEMORY_LIMIT:
           target->OnMemoryLimit(static_cast<DWORD>(
               reinterpret_cast<uintptr_t>(entry->lpOverlapped)));
           break;
+        case JOB_OBJECT_MSG_NOTIFICATION_LIMIT:
+          target->CheckMemoryThresholds();
+          break;
         }
       }
       ::LeaveCriticalSection(&sr->crit_sec);
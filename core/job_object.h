@@ -18,16 +18,33 @@ class Target;
 class JobObject {
 public:
   ResultCode Init();
+  // Create the job object and apply the basic and UI limits
+  ResultCode Init(DWORD basic_limit, DWORD ui_limit);
   ResultCode AssignProcess(HANDLE process);
   ResultCode GetBasicLimit(JOBOBJECT_EXTENDED_LIMIT_INFORMATION *limit);
   ResultCode SetBasicLimit(const JOBOBJECT_EXTENDED_LIMIT_INFORMATION &limit);
   ResultCode GetUILimit(JOBOBJECT_BASIC_UI_RESTRICTIONS *ui_limit);
   ResultCode SetUILimit(const JOBOBJECT_BASIC_UI_RESTRICTIONS &ui_limit);
+  // Arm the job memory notification limit, which posts the notification
+  // limit message when exceeded, zero to clear
+  ResultCode SetMemoryNotificationLimit(SIZE_T limit);
   ResultCode GetAccountInfo(JOBOBJECT_BASIC_ACCOUNTING_INFORMATION *info);
   ResultCode Terminate(UINT exit_code);
+  // Terminate the job and wait until none of its processes is active
+  ResultCode TerminateAndWait(UINT exit_code);
+
+  // Testing hooks which drive the event dispatcher without job objects.
+  // An attached target is detached when it is destroyed.
+  static ResultCode AttachTargetForTesting(Target *target);
+  static ResultCode PostMessageForTesting(Target *target, DWORD message_id,
+                                          DWORD process_id);
 
 private:
   static DWORD WINAPI MessageThread(PVOID param);
+  // Record a new or exited process in the table of the target, called by
+  // the event dispatcher before the event is delivered
+  static void RecordProcess(JobObjectSharedResource *sr, Target *target,
+                            DWORD message_id, DWORD process_id);
 
 private:
   friend class JobObjectSharedResource;
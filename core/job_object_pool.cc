@@ -0,0 +1,112 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/job_object_pool.h"
+
+#include <Windows.h>
+#include <memory>
+
+#include "core/job_object.h"
+
+using std::unique_ptr;
+
+namespace winc {
+
+JobObjectPool::JobObjectPool()
+  : basic_limit_(0)
+  , ui_limit_(0)
+  , capacity_(0)
+  , refill_work_(NULL)
+  , refill_pending_(false) {
+  ::InitializeCriticalSection(&crit_sec_);
+}
+
+JobObjectPool::~JobObjectPool() {
+  if (refill_work_) {
+    ::WaitForThreadpoolWorkCallbacks(refill_work_, TRUE);
+    ::CloseThreadpoolWork(refill_work_);
+  }
+  for (JobObject *job : jobs_)
+    delete job;
+  ::DeleteCriticalSection(&crit_sec_);
+}
+
+ResultCode JobObjectPool::Init(DWORD basic_limit, DWORD ui_limit,
+                               unsigned int capacity) {
+  PTP_WORK work = ::CreateThreadpoolWork(RefillCallback, this, NULL);
+  if (!work)
+    return WINC_ERROR_JOB_OBJECT;
+  refill_work_ = work;
+  basic_limit_ = basic_limit;
+  ui_limit_ = ui_limit;
+  capacity_ = capacity;
+  jobs_.reserve(capacity);
+
+  ::EnterCriticalSection(&crit_sec_);
+  GuardRefill();
+  ::LeaveCriticalSection(&crit_sec_);
+  return WINC_OK;
+}
+
+ResultCode JobObjectPool::Acquire(JobObject **out_job) {
+  JobObject *job = nullptr;
+  ::EnterCriticalSection(&crit_sec_);
+  if (!jobs_.empty()) {
+    job = jobs_.back();
+    jobs_.pop_back();
+  }
+  GuardRefill();
+  ::LeaveCriticalSection(&crit_sec_);
+  if (job) {
+    *out_job = job;
+    return WINC_OK;
+  }
+
+  // The pool is drained, fall back to creating one in place
+  unique_ptr<JobObject> new_job(new JobObject);
+  ResultCode rc = new_job->Init(basic_limit_, ui_limit_);
+  if (rc != WINC_OK)
+    return rc;
+  *out_job = new_job.release();
+  return WINC_OK;
+}
+
+void CALLBACK JobObjectPool::RefillCallback(PTP_CALLBACK_INSTANCE instance,
+                                            PVOID context, PTP_WORK work) {
+  reinterpret_cast<JobObjectPool *>(context)->Refill();
+}
+
+void JobObjectPool::Refill() {
+  while (true) {
+    ::EnterCriticalSection(&crit_sec_);
+    if (jobs_.size() >= capacity_) {
+      refill_pending_ = false;
+      ::LeaveCriticalSection(&crit_sec_);
+      return;
+    }
+    ::LeaveCriticalSection(&crit_sec_);
+
+    unique_ptr<JobObject> job(new JobObject);
+    ResultCode rc = job->Init(basic_limit_, ui_limit_);
+
+    ::EnterCriticalSection(&crit_sec_);
+    if (rc != WINC_OK) {
+      // Give up for now, the next acquire will try again
+      refill_pending_ = false;
+      ::LeaveCriticalSection(&crit_sec_);
+      return;
+    }
+    jobs_.push_back(job.release());
+    ::LeaveCriticalSection(&crit_sec_);
+  }
+}
+
+void JobObjectPool::GuardRefill() {
+  if (!refill_pending_ && jobs_.size() < capacity_) {
+    refill_pending_ = true;
+    ::SubmitThreadpoolWork(refill_work_);
+  }
+}
+
+}
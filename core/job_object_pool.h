@@ -0,0 +1,58 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_JOB_OBJECT_POOL_H_
+#define WINC_CORE_JOB_OBJECT_POOL_H_
+
+#include <Windows.h>
+#include <vector>
+
+#include <winc_types.h>
+
+namespace winc {
+
+class JobObject;
+
+// A pool of empty job objects with the basic and UI limits already applied.
+// The pool is refilled by a thread pool work item, so that creating and
+// configuring a job object is off the spawn path.
+class JobObjectPool {
+public:
+  JobObjectPool();
+  ~JobObjectPool();
+
+  ResultCode Init(DWORD basic_limit, DWORD ui_limit, unsigned int capacity);
+
+  bool Matches(DWORD basic_limit, DWORD ui_limit) const {
+    return basic_limit_ == basic_limit && ui_limit_ == ui_limit;
+  }
+
+  // Take a job object from the pool, or create one if the pool is drained,
+  // returns new reference
+  ResultCode Acquire(JobObject **out_job);
+
+private:
+  static void CALLBACK RefillCallback(PTP_CALLBACK_INSTANCE instance,
+                                      PVOID context, PTP_WORK work);
+  void Refill();
+  // Must be called with the lock held
+  void GuardRefill();
+
+private:
+  DWORD basic_limit_;
+  DWORD ui_limit_;
+  unsigned int capacity_;
+  PTP_WORK refill_work_;
+  bool refill_pending_;
+  CRITICAL_SECTION crit_sec_;
+  std::vector<JobObject *> jobs_;
+
+private:
+  JobObjectPool(const JobObjectPool &) = delete;
+  void operator=(const JobObjectPool &) = delete;
+};
+
+}
+
+#endif
@@ -6,14 +6,25 @@
 
 #include <Windows.h>
 #include <malloc.h>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <winc/sid.h>
+#include "core/platform.h"
 
 using namespace std;
 
 namespace winc {
 
+namespace {
+
+// The shared logons of the current user by integrity level, never freed
+SRWLOCK g_shared_logons_lock = SRWLOCK_INIT;
+unordered_map<DWORD, shared_ptr<CurrentLogon>> *g_shared_logons;
+
+}
+
 ResultCode Logon::GetUserSid(Sid **out_sid) const {
   if (!is_user_sid_cached_) {
     ResultCode rc = InitUserSidCache();
@@ -40,10 +51,9 @@ ResultCode Logon::FilterToken(const SID_AND_ATTRIBUTES *sids,
                               DWORD sids_count,
                               HANDLE *out_token) const {
   HANDLE new_token;
-  if (!::CreateRestrictedToken(token_.get(), DISABLE_MAX_PRIVILEGE,
-                               0, NULL, 0, NULL, sids_count,
-                               const_cast<SID_AND_ATTRIBUTES *>(sids),
-                               &new_token))
+  if (!Platform::Get()->CreateRestrictedToken(
+      token_.get(), DISABLE_MAX_PRIVILEGE, sids_count,
+      const_cast<SID_AND_ATTRIBUTES *>(sids), &new_token))
     return WINC_ERROR_LOGON;
   *out_token = new_token;
   return WINC_OK;
@@ -52,7 +62,8 @@ ResultCode Logon::FilterToken(const SID_AND_ATTRIBUTES *sids,
 ResultCode Logon::InitUserSidCache() const {
   DWORD size = sizeof(TOKEN_USER) + SECURITY_MAX_SID_SIZE;
   TOKEN_USER *info = reinterpret_cast<TOKEN_USER *>(_alloca(size));
-  if (!::GetTokenInformation(token_.get(), TokenUser, info, size, &size))
+  if (!Platform::Get()->GetTokenInformation(token_.get(), TokenUser, info,
+                                            size, &size))
     return WINC_ERROR_LOGON;
 
   user_sid_cache_.Init(info->User.Sid);
@@ -62,14 +73,17 @@ ResultCode Logon::InitUserSidCache() const {
 
 ResultCode Logon::InitGroupSidCache() const {
   DWORD size;
-  if (!::GetTokenInformation(token_.get(), TokenGroups, NULL, 0, &size) &&
+  Platform *platform = Platform::Get();
+  if (!platform->GetTokenInformation(token_.get(), TokenGroups, NULL, 0,
+                                     &size) &&
       ::GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
     return WINC_ERROR_LOGON;
   }
 
   vector<BYTE> buffer(size);
   TOKEN_GROUPS *info = reinterpret_cast<TOKEN_GROUPS *>(buffer.data());
-  if (::GetTokenInformation(token_.get(), TokenGroups, info, size, &size)) {
+  if (platform->GetTokenInformation(token_.get(), TokenGroups, info, size,
+                                    &size)) {
     for (unsigned int i = 0; i < info->GroupCount; ++i) {
       if (info->Groups[i].Attributes & SE_GROUP_LOGON_ID) {
         group_sid_cache_.Init(info->Groups[i].Sid);
@@ -91,20 +105,15 @@ ResultCode LogonWithIntegrity::FilterToken(const SID_AND_ATTRIBUTES *sids,
     return rc;
 
   // Set the integrity level of the new token
-  SID_IDENTIFIER_AUTHORITY authority = SECURITY_MANDATORY_LABEL_AUTHORITY;
-  Sid sid;
-  rc = sid.Init(&authority, integrity_level_);
-  if (rc != WINC_OK) {
-    ::CloseHandle(new_token);
-    return rc;
-  }
+  Sid sid = MandatoryLabelSid(integrity_level_);
 
   TOKEN_MANDATORY_LABEL tml;
   tml.Label.Sid = sid.data();
   tml.Label.Attributes = SE_GROUP_INTEGRITY;
-  if (!::SetTokenInformation(new_token, TokenIntegrityLevel,
-                             &tml, sizeof(tml) + sid.GetLength())) {
-    ::CloseHandle(new_token);
+  if (!Platform::Get()->SetTokenInformation(new_token, TokenIntegrityLevel,
+                                            &tml,
+                                            sizeof(tml) + sid.GetLength())) {
+    Platform::Get()->CloseHandle(new_token);
     return WINC_ERROR_LOGON;
   }
 
@@ -116,11 +125,7 @@ ResultCode LogonWithIntegrity::GrantAccess(HANDLE object,
                                            SE_OBJECT_TYPE object_type,
                                            DWORD allowed_access) const {
   // Set the integrity level of the object
-  SID_IDENTIFIER_AUTHORITY authority = SECURITY_MANDATORY_LABEL_AUTHORITY;
-  Sid sid;
-  ResultCode rc = sid.Init(&authority, integrity_level_);
-  if (rc != WINC_OK)
-    return rc;
+  Sid sid = MandatoryLabelSid(integrity_level_);
   vector<BYTE> sacl_buffer(sizeof(ACL) +
                            FIELD_OFFSET(SYSTEM_MANDATORY_LABEL_ACE, SidStart) +
                            sid.GetLength());
@@ -149,16 +154,42 @@ ResultCode LogonWithIntegrity::GrantAccess(HANDLE object,
 
 ResultCode CurrentLogon::Init(DWORD integrity_level) {
   HANDLE token;
-  if (!::OpenProcessToken(::GetCurrentProcess(),
-                          TOKEN_QUERY | TOKEN_DUPLICATE |
-                          TOKEN_ADJUST_DEFAULT | TOKEN_ASSIGN_PRIMARY,
-                          &token))
+  if (!Platform::Get()->OpenProcessToken(TOKEN_QUERY | TOKEN_DUPLICATE |
+                                         TOKEN_ADJUST_DEFAULT |
+                                         TOKEN_ASSIGN_PRIMARY,
+                                         &token))
     return WINC_ERROR_LOGON;
   set_token(token);
   LogonWithIntegrity::Init(integrity_level);
   return WINC_OK;
 }
 
+ResultCode CurrentLogon::GetShared(DWORD integrity_level,
+                                   shared_ptr<CurrentLogon> *out_logon) {
+  ::AcquireSRWLockExclusive(&g_shared_logons_lock);
+  if (!g_shared_logons)
+    g_shared_logons = new unordered_map<DWORD, shared_ptr<CurrentLogon>>;
+  shared_ptr<CurrentLogon> &shared = (*g_shared_logons)[integrity_level];
+  if (!shared) {
+    auto logon = make_shared<CurrentLogon>();
+    ResultCode rc = logon->Init(integrity_level);
+    Sid *sid;
+    if (rc == WINC_OK)
+      rc = logon->GetGroupSid(&sid);
+    if (rc != WINC_OK) {
+      g_shared_logons->erase(integrity_level);
+      ::ReleaseSRWLockExclusive(&g_shared_logons_lock);
+      return rc;
+    }
+    // The user SID is optional, it is looked up now only to fill the cache
+    logon->GetUserSid(&sid);
+    shared = move(logon);
+  }
+  *out_logon = shared;
+  ::ReleaseSRWLockExclusive(&g_shared_logons_lock);
+  return WINC_OK;
+}
+
 ResultCode UserLogon::Init(const std::wstring &username,
                            const std::wstring &password,
                            DWORD integrity_level) {
@@ -75,6 +75,18 @@ typedef enum _PROCESSINFOCLASS {
     MaxProcessInfoClass
 } PROCESSINFOCLASS;
 
+//
+// Information returned for ProcessBasicInformation
+//
+typedef struct _PROCESS_BASIC_INFORMATION {
+    NTSTATUS ExitStatus;
+    PVOID PebBaseAddress;
+    ULONG_PTR AffinityMask;
+    LONG BasePriority;
+    ULONG_PTR UniqueProcessId;
+    ULONG_PTR InheritedFromUniqueProcessId;
+} PROCESS_BASIC_INFORMATION, *PPROCESS_BASIC_INFORMATION;
+
 NTSYSCALLAPI
 NTSTATUS
 NTAPI
@@ -96,6 +108,13 @@ NtSetInformationProcess(
     _In_ ULONG ProcessInformationLength
 );
 
+NTSYSAPI
+ULONG
+NTAPI
+RtlNtStatusToDosError(
+    _In_ NTSTATUS Status
+);
+
 #ifdef __cplusplus
 }
 #endif
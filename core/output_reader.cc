@@ -0,0 +1,106 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/output_reader.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <winc_types.h>
+#include <winc/output.h>
+#include <winc/util.h>
+
+using std::make_shared;
+using std::min;
+using std::vector;
+
+namespace winc {
+
+namespace {
+
+const DWORD kReadSize = 64 * 1024;
+
+}
+
+OutputReader::OutputReader()
+  : limit_(0)
+  , output_(make_shared<CapturedOutput>())
+  {}
+
+OutputReader::~OutputReader() {
+  if (!thread_)
+    return;
+  // A read which starts after the cancellation is not cancelled, so
+  // cancel until the thread exits
+  while (::WaitForSingleObject(thread_.get(), 10) == WAIT_TIMEOUT)
+    ::CancelSynchronousIo(thread_.get());
+}
+
+ResultCode OutputReader::Init(size_t limit, HANDLE *out_write_handle) {
+  SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+  HANDLE read_handle, write_handle;
+  if (!::CreatePipe(&read_handle, &write_handle, &sa, 0))
+    return WINC_ERROR_UTIL;
+  read_handle_.reset(read_handle);
+  write_handle_.reset(write_handle);
+  if (!::SetHandleInformation(read_handle, HANDLE_FLAG_INHERIT, 0))
+    return WINC_ERROR_UTIL;
+  limit_ = limit;
+  *out_write_handle = write_handle;
+  return WINC_OK;
+}
+
+ResultCode OutputReader::Start() {
+  // The pipe ends once the target and its children close their copies
+  write_handle_.reset();
+  HANDLE thread = ::CreateThread(NULL, 0, ReaderThread, this, 0, NULL);
+  if (!thread)
+    return WINC_ERROR_UTIL;
+  thread_.reset(thread);
+  return WINC_OK;
+}
+
+ResultCode OutputReader::Wait(DWORD timeout_ms, bool *timeouted) {
+  DWORD ret = ::WaitForSingleObject(thread_.get(), timeout_ms);
+  if (ret == WAIT_FAILED)
+    return WINC_ERROR_UTIL;
+  if (timeouted)
+    *timeouted = (ret == WAIT_TIMEOUT);
+  return WINC_OK;
+}
+
+DWORD WINAPI OutputReader::ReaderThread(PVOID param) {
+  reinterpret_cast<OutputReader *>(param)->Read();
+  return 0;
+}
+
+void OutputReader::Read() {
+  vector<char> &data = output_->data_;
+  char discarded[4096];
+  // Ends with the broken pipe, or the cancellation by the destructor
+  while (true) {
+    size_t size = data.size();
+    DWORD read;
+    if (size < limit_) {
+      DWORD request = static_cast<DWORD>(min<size_t>(limit_ - size,
+                                                     kReadSize));
+      data.resize(size + request);
+      BOOL ok = ::ReadFile(read_handle_.get(), data.data() + size,
+                           request, &read, NULL);
+      data.resize(size + (ok ? read : 0));
+      if (!ok)
+        break;
+    } else {
+      if (!::ReadFile(read_handle_.get(), discarded, sizeof(discarded),
+                      &read, NULL))
+        break;
+      if (read)
+        output_->truncated_ = true;
+    }
+  }
+}
+
+}
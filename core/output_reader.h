@@ -0,0 +1,58 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_OUTPUT_READER_H_
+#define WINC_CORE_OUTPUT_READER_H_
+
+#include <Windows.h>
+#include <memory>
+
+#include <winc_types.h>
+#include <winc/output.h>
+#include <winc/util.h>
+
+namespace winc {
+
+// Drains a pipe into a captured output on a thread of its own, so that the
+// target never blocks on a full pipe
+class OutputReader {
+public:
+  OutputReader();
+  // Cancels the pending read and waits for the thread
+  ~OutputReader();
+
+  // Creates the pipe, the write handle is inheritable and stays valid
+  // until Start
+  ResultCode Init(size_t limit, HANDLE *out_write_handle);
+
+  // Closes the write handle of the reader, to be called once the target
+  // inherited it, and starts reading
+  ResultCode Start();
+
+  // Waits until every writer closes the pipe
+  ResultCode Wait(DWORD timeout_ms, bool *timeouted);
+
+  const std::shared_ptr<CapturedOutput> &output() const {
+    return output_;
+  }
+
+private:
+  static DWORD WINAPI ReaderThread(PVOID param);
+  void Read();
+
+private:
+  size_t limit_;
+  unique_handle read_handle_;
+  unique_handle write_handle_;
+  unique_handle thread_;
+  std::shared_ptr<CapturedOutput> output_;
+
+private:
+  OutputReader(const OutputReader &) = delete;
+  void operator=(const OutputReader &) = delete;
+};
+
+}
+
+#endif
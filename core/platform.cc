@@ -0,0 +1,199 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/platform.h"
+
+#include <Windows.h>
+#include <Psapi.h>
+
+#include "core/ntnative.h"
+
+namespace winc {
+
+namespace {
+
+class WindowsPlatform : public Platform {
+public:
+  virtual BOOL CloseHandle(HANDLE object) override {
+    return ::CloseHandle(object);
+  }
+
+  virtual BOOL DuplicateHandle(HANDLE object, HANDLE *out_object) override {
+    return ::DuplicateHandle(::GetCurrentProcess(), object,
+                             ::GetCurrentProcess(), out_object, 0, FALSE,
+                             DUPLICATE_SAME_ACCESS);
+  }
+
+  virtual DWORD WaitForSingleObject(HANDLE object,
+                                    DWORD timeout_ms) override {
+    return ::WaitForSingleObject(object, timeout_ms);
+  }
+
+  virtual BOOL CreateUserProcess(HANDLE token,
+                                 const wchar_t *exe_path,
+                                 wchar_t *command_line,
+                                 BOOL inherit_handles,
+                                 DWORD creation_flags,
+                                 const wchar_t *environment,
+                                 const wchar_t *current_directory,
+                                 STARTUPINFOW *startup_info,
+                                 PROCESS_INFORMATION *out_info) override {
+    return ::CreateProcessAsUserW(token, exe_path, command_line, NULL, NULL,
+                                  inherit_handles, creation_flags,
+                                  const_cast<wchar_t *>(environment),
+                                  current_directory, startup_info, out_info);
+  }
+
+  virtual DWORD ResumeThread(HANDLE thread) override {
+    return ::ResumeThread(thread);
+  }
+
+  virtual BOOL TerminateProcess(HANDLE process, UINT exit_code) override {
+    return ::TerminateProcess(process, exit_code);
+  }
+
+  virtual BOOL DisableHardError(HANDLE process) override {
+    ULONG default_hard_error_mode;
+    NTSTATUS status = ::NtQueryInformationProcess(
+        process, ProcessDefaultHardErrorMode, &default_hard_error_mode,
+        sizeof(default_hard_error_mode), NULL);
+    if (!NT_SUCCESS(status))
+      return FALSE;
+    default_hard_error_mode &= ~1;
+    status = ::NtSetInformationProcess(
+        process, ProcessDefaultHardErrorMode, &default_hard_error_mode,
+        sizeof(default_hard_error_mode));
+    return NT_SUCCESS(status);
+  }
+
+  virtual BOOL GetExitCodeProcess(HANDLE process, DWORD *out_code) override {
+    return ::GetExitCodeProcess(process, out_code);
+  }
+
+  virtual BOOL GetProcessTimes(HANDLE process, FILETIME *out_creation_time,
+                               FILETIME *out_exit_time,
+                               FILETIME *out_kernel_time,
+                               FILETIME *out_user_time) override {
+    return ::GetProcessTimes(process, out_creation_time, out_exit_time,
+                             out_kernel_time, out_user_time);
+  }
+
+  virtual BOOL QueryProcessCycleTime(HANDLE process,
+                                     ULONG64 *out_cycle) override {
+    return ::QueryProcessCycleTime(process, out_cycle);
+  }
+
+  virtual BOOL GetProcessMemoryCounters(
+      HANDLE process, PROCESS_MEMORY_COUNTERS *out_counters) override {
+    return ::GetProcessMemoryInfo(process, out_counters,
+                                  sizeof(PROCESS_MEMORY_COUNTERS));
+  }
+
+  virtual HANDLE OpenProcess(DWORD access, DWORD process_id) override {
+    return ::OpenProcess(access, FALSE, process_id);
+  }
+
+  virtual BOOL GetParentProcessId(HANDLE process,
+                                  DWORD *out_parent_id) override {
+    PROCESS_BASIC_INFORMATION info;
+    NTSTATUS status = ::NtQueryInformationProcess(
+        process, ProcessBasicInformation, &info, sizeof(info), NULL);
+    if (!NT_SUCCESS(status)) {
+      ::SetLastError(::RtlNtStatusToDosError(status));
+      return FALSE;
+    }
+    *out_parent_id = static_cast<DWORD>(info.InheritedFromUniqueProcessId);
+    return TRUE;
+  }
+
+  virtual HANDLE CreateJob() override {
+    return ::CreateJobObjectW(NULL, NULL);
+  }
+
+  virtual BOOL AssignProcessToJobObject(HANDLE job, HANDLE process) override {
+    return ::AssignProcessToJobObject(job, process);
+  }
+
+  virtual BOOL QueryInformationJobObject(HANDLE job,
+                                         JOBOBJECTINFOCLASS info_class,
+                                         PVOID info, DWORD size) override {
+    return ::QueryInformationJobObject(job, info_class, info, size, NULL);
+  }
+
+  virtual BOOL SetInformationJobObject(HANDLE job,
+                                       JOBOBJECTINFOCLASS info_class,
+                                       PVOID info, DWORD size) override {
+    return ::SetInformationJobObject(job, info_class, info, size);
+  }
+
+  virtual BOOL TerminateJobObject(HANDLE job, UINT exit_code) override {
+    return ::TerminateJobObject(job, exit_code);
+  }
+
+  virtual BOOL IsProcessInJob(HANDLE process, HANDLE job,
+                              BOOL *out_result) override {
+    return ::IsProcessInJob(process, job, out_result);
+  }
+
+  virtual BOOL OpenProcessToken(DWORD access, HANDLE *out_token) override {
+    return ::OpenProcessToken(::GetCurrentProcess(), access, out_token);
+  }
+
+  virtual BOOL CreateRestrictedToken(HANDLE token, DWORD flags,
+                                     DWORD sids_count,
+                                     SID_AND_ATTRIBUTES *sids,
+                                     HANDLE *out_token) override {
+    return ::CreateRestrictedToken(token, flags, 0, NULL, 0, NULL,
+                                   sids_count, sids, out_token);
+  }
+
+  virtual BOOL GetTokenInformation(HANDLE token,
+                                   TOKEN_INFORMATION_CLASS info_class,
+                                   PVOID info, DWORD size,
+                                   DWORD *out_size) override {
+    return ::GetTokenInformation(token, info_class, info, size, out_size);
+  }
+
+  virtual BOOL SetTokenInformation(HANDLE token,
+                                   TOKEN_INFORMATION_CLASS info_class,
+                                   PVOID info, DWORD size) override {
+    return ::SetTokenInformation(token, info_class, info, size);
+  }
+
+  virtual HANDLE CreateCompletionPort() override {
+    return ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+  }
+
+  virtual BOOL PostQueuedCompletionStatus(HANDLE port, DWORD bytes,
+                                          ULONG_PTR key,
+                                          LPOVERLAPPED overlapped) override {
+    return ::PostQueuedCompletionStatus(port, bytes, key, overlapped);
+  }
+
+  virtual BOOL GetQueuedCompletionStatusEx(HANDLE port,
+                                           OVERLAPPED_ENTRY *entries,
+                                           ULONG count, ULONG *out_count,
+                                           DWORD timeout_ms) override {
+    return ::GetQueuedCompletionStatusEx(port, entries, count, out_count,
+                                         timeout_ms, FALSE);
+  }
+};
+
+WindowsPlatform g_windows_platform;
+Platform *volatile g_platform = &g_windows_platform;
+
+}
+
+Platform *Platform::Get() {
+  return g_platform;
+}
+
+Platform *Platform::Set(Platform *platform) {
+  if (!platform)
+    platform = &g_windows_platform;
+  return reinterpret_cast<Platform *>(::InterlockedExchangePointer(
+      reinterpret_cast<PVOID volatile *>(&g_platform), platform));
+}
+
+}
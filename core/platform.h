@@ -0,0 +1,106 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_PLATFORM_H_
+#define WINC_CORE_PLATFORM_H_
+
+#include <Windows.h>
+#include <Psapi.h>
+
+namespace winc {
+
+// The operating system calls of the library for process creation, job
+// control, tokens and completion ports. The methods follow the conventions
+// of the Windows API they stand for, failures are reported by the return
+// value and the last error.
+//
+// The Windows platform is used unless another platform is installed by
+// Platform::Set, e.g. the in-memory FakePlatform for tests.
+class Platform {
+public:
+  virtual ~Platform() {}
+
+  // Returns the platform in use
+  static Platform *Get();
+
+  // Installs a platform, null restores the Windows platform. Returns the
+  // previous platform. The platform must be installed before any object of
+  // the library is created, and must outlive all of them, including the
+  // event dispatcher thread which runs until the process exits.
+  static Platform *Set(Platform *platform);
+
+  // Handles
+  virtual BOOL CloseHandle(HANDLE object) = 0;
+  // Another handle of the object in the current process, with the same
+  // access
+  virtual BOOL DuplicateHandle(HANDLE object, HANDLE *out_object) = 0;
+  virtual DWORD WaitForSingleObject(HANDLE object, DWORD timeout_ms) = 0;
+
+  // Processes
+  virtual BOOL CreateUserProcess(HANDLE token,
+                                 const wchar_t *exe_path,
+                                 wchar_t *command_line,
+                                 BOOL inherit_handles,
+                                 DWORD creation_flags,
+                                 const wchar_t *environment,
+                                 const wchar_t *current_directory,
+                                 STARTUPINFOW *startup_info,
+                                 PROCESS_INFORMATION *out_info) = 0;
+  virtual DWORD ResumeThread(HANDLE thread) = 0;
+  virtual BOOL TerminateProcess(HANDLE process, UINT exit_code) = 0;
+  // Turn off the hard error dialogs of the process
+  virtual BOOL DisableHardError(HANDLE process) = 0;
+  virtual BOOL GetExitCodeProcess(HANDLE process, DWORD *out_code) = 0;
+  virtual BOOL GetProcessTimes(HANDLE process, FILETIME *out_creation_time,
+                               FILETIME *out_exit_time,
+                               FILETIME *out_kernel_time,
+                               FILETIME *out_user_time) = 0;
+  virtual BOOL QueryProcessCycleTime(HANDLE process, ULONG64 *out_cycle) = 0;
+  virtual BOOL GetProcessMemoryCounters(
+      HANDLE process, PROCESS_MEMORY_COUNTERS *out_counters) = 0;
+  virtual HANDLE OpenProcess(DWORD access, DWORD process_id) = 0;
+  // Process ID of the creator of the process, which may have exited
+  virtual BOOL GetParentProcessId(HANDLE process, DWORD *out_parent_id) = 0;
+
+  // Job objects
+  virtual HANDLE CreateJob() = 0;
+  virtual BOOL AssignProcessToJobObject(HANDLE job, HANDLE process) = 0;
+  virtual BOOL QueryInformationJobObject(HANDLE job,
+                                         JOBOBJECTINFOCLASS info_class,
+                                         PVOID info, DWORD size) = 0;
+  virtual BOOL SetInformationJobObject(HANDLE job,
+                                       JOBOBJECTINFOCLASS info_class,
+                                       PVOID info, DWORD size) = 0;
+  virtual BOOL TerminateJobObject(HANDLE job, UINT exit_code) = 0;
+  virtual BOOL IsProcessInJob(HANDLE process, HANDLE job,
+                              BOOL *out_result) = 0;
+
+  // Tokens
+  virtual BOOL OpenProcessToken(DWORD access, HANDLE *out_token) = 0;
+  virtual BOOL CreateRestrictedToken(HANDLE token, DWORD flags,
+                                     DWORD sids_count,
+                                     SID_AND_ATTRIBUTES *sids,
+                                     HANDLE *out_token) = 0;
+  virtual BOOL GetTokenInformation(HANDLE token,
+                                   TOKEN_INFORMATION_CLASS info_class,
+                                   PVOID info, DWORD size,
+                                   DWORD *out_size) = 0;
+  virtual BOOL SetTokenInformation(HANDLE token,
+                                   TOKEN_INFORMATION_CLASS info_class,
+                                   PVOID info, DWORD size) = 0;
+
+  // Completion ports, with a concurrency of one
+  virtual HANDLE CreateCompletionPort() = 0;
+  virtual BOOL PostQueuedCompletionStatus(HANDLE port, DWORD bytes,
+                                          ULONG_PTR key,
+                                          LPOVERLAPPED overlapped) = 0;
+  virtual BOOL GetQueuedCompletionStatusEx(HANDLE port,
+                                           OVERLAPPED_ENTRY *entries,
+                                           ULONG count, ULONG *out_count,
+                                           DWORD timeout_ms) = 0;
+};
+
+}
+
+#endif
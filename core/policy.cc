@@ -6,25 +6,83 @@
 
 #include <Windows.h>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <vector>
 
 #include <winc/desktop.h>
 #include <winc/logon.h>
+#include <winc/sid.h>
+#include "core/desktop_pool.h"
 #include "core/job_object.h"
+#include "core/job_object_pool.h"
+#include "core/token_cache.h"
 
-using std::make_shared;
+using std::find;
 using std::make_unique;
 using std::remove;
 using std::shared_ptr;
+using std::unique_ptr;
 using std::vector;
 
 namespace winc {
 
+namespace {
+
+// The image of a policy starts with this header, followed by the restricted
+// SIDs in their binary form. All fields are little endian and aligned to
+// their size, so a mapped image is read in place. Fields appended to the
+// header keep the version, the header size tells where the SIDs begin.
+struct PolicyImageHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;
+  // Size of the whole image
+  uint32_t size;
+  uint32_t flags;
+  uint64_t mitigation_policy;
+  uint32_t job_basic_limit;
+  uint32_t job_ui_limit;
+  uint32_t job_pool_size;
+  uint32_t default_active_process_limit;
+  uint64_t default_memory_limit;
+  uint32_t restricted_sid_count;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(PolicyImageHeader) == 56, "layout of the policy image");
+
+const uint32_t kPolicyImageMagic = 0x50434e57;  // WNCP
+const uint16_t kPolicyImageVersion = 1;
+const uint32_t kPolicyImageUseDesktop = 0x1;
+// Revision, sub-authority count and identifier authority of a SID
+const size_t kSidHeaderSize = 8;
+
+}
+
+Policy::Policy()
+  : use_desktop_(false)
+  , job_basic_limit_(0)
+  , job_ui_limit_(0)
+  , mitigation_policy_(0)
+  , job_pool_size_(0)
+  , default_memory_limit_(0)
+  , default_active_process_limit_(0)
+  {}
+
+Policy::~Policy() = default;
+
+void Policy::set_job_pool_size(unsigned int size) {
+  job_pool_size_ = size;
+  job_object_pool_.reset();
+}
+
 ResultCode Policy::GetLogon(shared_ptr<Logon> *out_logon) {
   if (!logon_) {
-    auto logon = make_shared<CurrentLogon>();
-    ResultCode rc = logon->Init(SECURITY_MANDATORY_LOW_RID);
+    shared_ptr<CurrentLogon> logon;
+    ResultCode rc = CurrentLogon::GetShared(SECURITY_MANDATORY_LOW_RID,
+                                            &logon);
     if (rc != WINC_OK)
       return rc;
     logon_ = move(logon);
@@ -40,95 +98,158 @@ void Policy::SetLogon(const shared_ptr<Logon> &logon) {
 }
 
 void Policy::AddRestrictSid(const Sid &sid) {
-  restricted_sids_.push_back(sid);
+  restricted_sids_.push_back(Sid::Intern(sid));
   restricted_token_.reset();
 }
 
 void Policy::RemoveRestrictSid(const Sid &sid) {
   restricted_sids_.erase(remove(restricted_sids_.begin(),
-                                restricted_sids_.end(), sid),
+                                restricted_sids_.end(), Sid::Intern(sid)),
                          restricted_sids_.end());
   restricted_token_.reset();
 }
 
+bool Policy::HasRestrictSid(const Sid &sid) {
+  return find(restricted_sids_.begin(), restricted_sids_.end(),
+              Sid::Intern(sid)) != restricted_sids_.end();
+}
+
+void Policy::Save(vector<uint8_t> *out_image) const {
+  PolicyImageHeader header = {};
+  header.magic = kPolicyImageMagic;
+  header.version = kPolicyImageVersion;
+  header.header_size = sizeof(header);
+  header.flags = use_desktop_ ? kPolicyImageUseDesktop : 0;
+  header.mitigation_policy = mitigation_policy_;
+  header.job_basic_limit = job_basic_limit_;
+  header.job_ui_limit = job_ui_limit_;
+  header.job_pool_size = job_pool_size_;
+  header.default_active_process_limit = default_active_process_limit_;
+  header.default_memory_limit = default_memory_limit_;
+  header.restricted_sid_count =
+    static_cast<uint32_t>(restricted_sids_.size());
+  size_t size = sizeof(header);
+  for (const Sid *sid : restricted_sids_)
+    size += sid->length();
+  header.size = static_cast<uint32_t>(size);
+
+  out_image->resize(size);
+  uint8_t *out = out_image->data();
+  memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+  for (const Sid *sid : restricted_sids_) {
+    memcpy(out, sid->data(), sid->length());
+    out += sid->length();
+  }
+}
+
+ResultCode Policy::Load(const void *image, size_t size) {
+  const uint8_t *begin = static_cast<const uint8_t *>(image);
+  PolicyImageHeader header;
+  if (size < sizeof(header))
+    return WINC_ERROR_POLICY;
+  memcpy(&header, begin, sizeof(header));
+  // A mapped image may be followed by the padding of its last page
+  if (header.magic != kPolicyImageMagic ||
+      header.version != kPolicyImageVersion ||
+      header.header_size < sizeof(header) || header.size > size ||
+      header.header_size > header.size ||
+      header.restricted_sid_count > (header.size - header.header_size) /
+                                    kSidHeaderSize ||
+      header.default_memory_limit > UINTPTR_MAX)
+    return WINC_ERROR_POLICY;
+
+  vector<const Sid *> restricted_sids(header.restricted_sid_count);
+  const uint8_t *p = begin + header.header_size;
+  const uint8_t *end = begin + header.size;
+  for (const Sid *&restricted_sid : restricted_sids) {
+    if (static_cast<size_t>(end - p) < kSidHeaderSize ||
+        p[1] > Sid::kMaxSubAuthorities)
+      return WINC_ERROR_POLICY;
+    size_t length = kSidHeaderSize + p[1] * sizeof(uint32_t);
+    Sid sid;
+    if (static_cast<size_t>(end - p) < length ||
+        sid.Init(reinterpret_cast<PSID>(const_cast<uint8_t *>(p))) !=
+        WINC_OK)
+      return WINC_ERROR_POLICY;
+    restricted_sid = Sid::Intern(sid);
+    p += length;
+  }
+  if (p != end)
+    return WINC_ERROR_POLICY;
+
+  restricted_sids_ = move(restricted_sids);
+  restricted_token_.reset();
+  use_desktop_ = (header.flags & kPolicyImageUseDesktop) != 0;
+  job_basic_limit_ = header.job_basic_limit;
+  job_ui_limit_ = header.job_ui_limit;
+  mitigation_policy_ = header.mitigation_policy;
+  if (job_pool_size_ != header.job_pool_size)
+    set_job_pool_size(header.job_pool_size);
+  default_memory_limit_ = static_cast<uintptr_t>(header.default_memory_limit);
+  default_active_process_limit_ = header.default_active_process_limit;
+  return WINC_OK;
+}
+
 ResultCode Policy::GetRestrictedToken(HANDLE *out_token) {
   if (!restricted_token_) {
     shared_ptr<Logon> logon;
     ResultCode rc = GetLogon(&logon);
     if (rc != WINC_OK)
       return rc;
-    vector<SID_AND_ATTRIBUTES> sids_to_restrict(restricted_sids_.size());
-    for (unsigned int i = 0; i < restricted_sids_.size(); ++i) {
-      sids_to_restrict[i].Sid = restricted_sids_[i].data();
-      sids_to_restrict[i].Attributes = 0;
-    }
-    HANDLE restricted_token;
-    rc = logon->FilterToken(sids_to_restrict.data(),
-                            static_cast<DWORD>(sids_to_restrict.size()),
-                            &restricted_token);
+    rc = TokenCache::Get(logon, restricted_sids_, &restricted_token_);
     if (rc != WINC_OK)
       return rc;
-    restricted_token_.reset(restricted_token);
   }
-  *out_token = restricted_token_.get();
+  *out_token = restricted_token_->get();
   return WINC_OK;
 }
 
-ResultCode Policy::GetDesktop(Desktop **out_desktop) {
+ResultCode Policy::GetDesktop(Desktop **out_desktop,
+                              shared_ptr<AlternateDesktop> *out_lease) {
   if (!use_desktop_) {
     if (!default_desktop_) {
       default_desktop_.reset(new DefaultDesktop);
     }
     *out_desktop = default_desktop_.get();
+    out_lease->reset();
   } else {
     if (!alternate_desktop_) {
       shared_ptr<Logon> logon;
       ResultCode rc = GetLogon(&logon);
       if (rc != WINC_OK)
         return rc;
-      auto d = make_unique<AlternateDesktop>();
-      rc = d->Init(DESKTOP_READOBJECTS | DESKTOP_CREATEWINDOW |
-                   DESKTOP_WRITEOBJECTS | DESKTOP_SWITCHDESKTOP |
-                   READ_CONTROL | WRITE_DAC | WRITE_OWNER);
-      if (rc != WINC_OK)
-        return rc;
-      rc = logon->GrantAccess(d->GetDesktopHandle(), SE_WINDOW_OBJECT,
-                               GENERIC_READ | GENERIC_WRITE | GENERIC_EXECUTE);
+      rc = DesktopPool::Acquire(logon, &alternate_desktop_);
       if (rc != WINC_OK)
         return rc;
-      rc = logon->GrantAccess(d->GetWinstaHandle(), SE_WINDOW_OBJECT,
-                               GENERIC_READ | GENERIC_WRITE | GENERIC_EXECUTE);
-      if (rc != WINC_OK)
-        return rc;
-      alternate_desktop_ = move(d);
     }
     *out_desktop = alternate_desktop_.get();
+    *out_lease = alternate_desktop_;
   }
   return WINC_OK;
 }
 
 ResultCode Policy::MakeJobObject(JobObject **out_job) {
-  JobObject *job = new JobObject;
-  ResultCode rc = job->Init();
-  if (rc != WINC_OK)
-    return rc;
-
-  {
-    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit = {};
-    limit.BasicLimitInformation.LimitFlags = job_basic_limit_;
-    rc = job->SetBasicLimit(limit);
-    if (rc != WINC_OK)
-      return rc;
-  }
-  {
-    JOBOBJECT_BASIC_UI_RESTRICTIONS limit = {};
-    limit.UIRestrictionsClass = job_ui_limit_;
-    rc = job->SetUILimit(limit);
-    if (rc != WINC_OK)
-      return rc;
+  if (job_pool_size_) {
+    if (job_object_pool_ &&
+        !job_object_pool_->Matches(job_basic_limit_, job_ui_limit_))
+      job_object_pool_.reset();
+    if (!job_object_pool_) {
+      auto pool = make_unique<JobObjectPool>();
+      ResultCode rc = pool->Init(job_basic_limit_, job_ui_limit_,
+                                 job_pool_size_);
+      if (rc != WINC_OK)
+        return rc;
+      job_object_pool_ = move(pool);
+    }
+    return job_object_pool_->Acquire(out_job);
   }
 
-  *out_job = job;
+  unique_ptr<JobObject> job(new JobObject);
+  ResultCode rc = job->Init(job_basic_limit_, job_ui_limit_);
+  if (rc != WINC_OK)
+    return rc;
+  *out_job = job.release();
   return WINC_OK;
 }
 
@@ -0,0 +1,100 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/process_table.h"
+
+#include <Windows.h>
+#include <Psapi.h>
+#include <vector>
+
+#include "core/platform.h"
+
+using std::move;
+using std::vector;
+
+namespace winc {
+
+ProcessTable::ProcessTable(HANDLE job)
+  : job_(job) {
+  ::InitializeSRWLock(&lock_);
+}
+
+ProcessTable::~ProcessTable() = default;
+
+void ProcessTable::AddProcess(DWORD process_id) {
+  Platform *platform = Platform::Get();
+  ProcessRecord record = {};
+  record.process_id = process_id;
+  unique_handle process(platform->OpenProcess(
+      PROCESS_QUERY_LIMITED_INFORMATION, process_id));
+  // The process may have exited and its ID been reused by a process out of
+  // the job before it was opened
+  BOOL in_job;
+  if (!process ||
+      !platform->IsProcessInJob(process.get(), job_.get(), &in_job) ||
+      !in_job ||
+      !platform->GetParentProcessId(process.get(),
+                                    &record.parent_process_id)) {
+    record.lost = true;
+    process.reset();
+  } else {
+    ReadProcess(process.get(), &record);
+  }
+
+  ::AcquireSRWLockExclusive(&lock_);
+  index_[process_id] = records_.size();
+  records_.push_back(record);
+  handles_.push_back(move(process));
+  ::ReleaseSRWLockExclusive(&lock_);
+}
+
+void ProcessTable::FinishProcess(DWORD process_id) {
+  ::AcquireSRWLockExclusive(&lock_);
+  auto iter = index_.find(process_id);
+  if (iter != index_.end()) {
+    size_t index = iter->second;
+    ProcessRecord &record = records_[index];
+    if (handles_[index]) {
+      ReadProcess(handles_[index].get(), &record);
+      handles_[index].reset();
+    }
+    record.exited = true;
+    index_.erase(iter);
+  }
+  ::ReleaseSRWLockExclusive(&lock_);
+}
+
+void ProcessTable::GetRecords(vector<ProcessRecord> *out_records) {
+  ::AcquireSRWLockShared(&lock_);
+  *out_records = records_;
+  for (size_t i = 0; i < records_.size(); ++i) {
+    if (handles_[i])
+      ReadProcess(handles_[i].get(), &(*out_records)[i]);
+  }
+  ::ReleaseSRWLockShared(&lock_);
+}
+
+void ProcessTable::ReadProcess(HANDLE process, ProcessRecord *record) {
+  Platform *platform = Platform::Get();
+  ULONG64 creation_time, exit_time, kernel_time, user_time;
+  if (platform->GetProcessTimes(
+      process,
+      reinterpret_cast<LPFILETIME>(&creation_time),
+      reinterpret_cast<LPFILETIME>(&exit_time),
+      reinterpret_cast<LPFILETIME>(&kernel_time),
+      reinterpret_cast<LPFILETIME>(&user_time))) {
+    record->creation_time = creation_time;
+    record->exit_time = exit_time;
+    record->kernel_time = kernel_time;
+    record->user_time = user_time;
+  }
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (platform->GetProcessMemoryCounters(process, &pmc))
+    record->peak_memory = pmc.PeakPagefileUsage;
+  DWORD exit_code;
+  if (platform->GetExitCodeProcess(process, &exit_code))
+    record->exit_code = exit_code;
+}
+
+}
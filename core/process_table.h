@@ -0,0 +1,54 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_PROCESS_TABLE_H_
+#define WINC_CORE_PROCESS_TABLE_H_
+
+#include <Windows.h>
+#include <unordered_map>
+#include <vector>
+
+#include <winc/target.h>
+#include <winc/util.h>
+
+namespace winc {
+
+// The accounting of the processes of a job. A process is opened when its
+// new process event is handled, so that its accounting can still be read
+// at the exit event, and closed right after. Each event is a hash lookup
+// and a few queries of the process, which the event dispatcher makes
+// outside of its lock. Thread safe.
+class ProcessTable {
+public:
+  // Takes the ownership of a handle of the job, so that the table may
+  // outlive the target
+  explicit ProcessTable(HANDLE job);
+  ~ProcessTable();
+
+  void AddProcess(DWORD process_id);
+  void FinishProcess(DWORD process_id);
+  // Copies the records, reading the values of the running processes
+  void GetRecords(std::vector<ProcessRecord> *out_records);
+
+private:
+  // Reads the times, the peak memory and the exit code of the process
+  static void ReadProcess(HANDLE process, ProcessRecord *record);
+
+private:
+  unique_handle job_;
+  SRWLOCK lock_;
+  std::vector<ProcessRecord> records_;
+  // Handles of the running processes, in the order of the records
+  std::vector<unique_handle> handles_;
+  // Index of the last record of each process ID, IDs are reused
+  std::unordered_map<DWORD, size_t> index_;
+
+private:
+  ProcessTable(const ProcessTable &) = delete;
+  void operator=(const ProcessTable &) = delete;
+};
+
+}
+
+#endif
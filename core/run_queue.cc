@@ -0,0 +1,232 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <winc/run_queue.h>
+
+#include <Windows.h>
+#include <cstdint>
+#include <memory>
+
+#include <winc_types.h>
+#include <winc/container.h>
+#include <winc/policy.h>
+#include <winc/target.h>
+#include <winc/util.h>
+
+namespace winc {
+
+RunQueue::RunQueue()
+  : container_(nullptr)
+  , memory_budget_(0)
+  , core_budget_(0)
+  , reserved_memory_(0)
+  , reserved_cores_(0)
+  , waiting_count_(0)
+  , heads_()
+  , tails_() {
+  ::InitializeCriticalSection(&crit_sec_);
+}
+
+RunQueue::~RunQueue() {
+  ::DeleteCriticalSection(&crit_sec_);
+}
+
+ResultCode RunQueue::Init(Container *container, uint64_t memory_budget,
+                          unsigned int core_budget) {
+  container_ = container;
+  memory_budget_ = memory_budget;
+  core_budget_ = core_budget;
+  return WINC_OK;
+}
+
+ResultCode RunQueue::Spawn(const wchar_t *exe_path, Target *target,
+                           SpawnOptions *options, Priority priority) {
+  Policy *policy;
+  ResultCode rc = container_->GetPolicy(&policy);
+  if (rc != WINC_OK)
+    return rc;
+  // Reserve the limit the container applies, which is the default of the
+  // policy unless the spawn has its own
+  uint64_t memory = options && options->memory_limit
+                        ? options->memory_limit
+                        : policy->default_memory_limit();
+  if (memory_budget_ && !memory)
+    return WINC_ERROR_OVER_BUDGET;
+  unsigned int cores = options && options->auto_affinity ? 1 : 0;
+  rc = Acquire(memory, cores, priority);
+  if (rc != WINC_OK)
+    return rc;
+  rc = container_->Spawn(exe_path, target, options);
+  if (rc != WINC_OK) {
+    Release(memory, cores);
+    return rc;
+  }
+  target->AssignReservation(shared_from_this(), memory, cores);
+  return WINC_OK;
+}
+
+ResultCode RunQueue::Acquire(uint64_t memory, unsigned int cores,
+                             Priority priority, DWORD timeout_ms) {
+  if (priority < 0 || priority >= PRIORITY_COUNT)
+    priority = PRIORITY_LOW;
+  if ((memory_budget_ && memory > memory_budget_) ||
+      (core_budget_ && cores > core_budget_))
+    return WINC_ERROR_OVER_BUDGET;
+
+  // Fast path, nobody of the same or higher priority is waiting
+  ::EnterCriticalSection(&crit_sec_);
+  if (!HasWaiter(priority) && Fits(memory, cores)) {
+    reserved_memory_ += memory;
+    reserved_cores_ += cores;
+    ::LeaveCriticalSection(&crit_sec_);
+    return WINC_OK;
+  }
+  if (!timeout_ms) {
+    ::LeaveCriticalSection(&crit_sec_);
+    return WINC_ERROR_TIMEOUT;
+  }
+  ::LeaveCriticalSection(&crit_sec_);
+
+  // Each waiter has its own event, so an admission wakes up exactly the
+  // admitted threads. The event is created before queueing to keep the
+  // lock free of system calls.
+  Waiter waiter = {};
+  waiter.memory = memory;
+  waiter.cores = cores;
+  waiter.event = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+  if (!waiter.event)
+    return WINC_ERROR_UTIL;
+  unique_handle event_holder(waiter.event);
+
+  ::EnterCriticalSection(&crit_sec_);
+  Enqueue(&waiter, priority);
+  // The budget may have been released in between
+  Waiter *admitted = AdmitWaiters();
+  ::LeaveCriticalSection(&crit_sec_);
+  Signal(admitted);
+
+  DWORD ret = ::WaitForSingleObject(waiter.event, timeout_ms);
+  if (ret == WAIT_OBJECT_0)
+    return WINC_OK;
+
+  // Leave the queue unless admitted right after the wait returned
+  ::EnterCriticalSection(&crit_sec_);
+  bool was_admitted = waiter.admitted;
+  if (!was_admitted) {
+    Unlink(&waiter, priority);
+    // Waiters blocked behind this one may fit now
+    admitted = AdmitWaiters();
+  }
+  ::LeaveCriticalSection(&crit_sec_);
+  if (was_admitted) {
+    // The admitting thread is about to signal the event, which must stay
+    // valid until then
+    ::WaitForSingleObject(waiter.event, INFINITE);
+    return WINC_OK;
+  }
+  Signal(admitted);
+  if (ret != WAIT_TIMEOUT)
+    return WINC_ERROR_UTIL;
+  return WINC_ERROR_TIMEOUT;
+}
+
+void RunQueue::Release(uint64_t memory, unsigned int cores) {
+  ::EnterCriticalSection(&crit_sec_);
+  reserved_memory_ -= memory;
+  reserved_cores_ -= cores;
+  Waiter *admitted = AdmitWaiters();
+  ::LeaveCriticalSection(&crit_sec_);
+  Signal(admitted);
+}
+
+uint64_t RunQueue::reserved_memory() {
+  ::EnterCriticalSection(&crit_sec_);
+  uint64_t memory = reserved_memory_;
+  ::LeaveCriticalSection(&crit_sec_);
+  return memory;
+}
+
+unsigned int RunQueue::reserved_cores() {
+  ::EnterCriticalSection(&crit_sec_);
+  unsigned int cores = reserved_cores_;
+  ::LeaveCriticalSection(&crit_sec_);
+  return cores;
+}
+
+unsigned int RunQueue::waiting_count() {
+  ::EnterCriticalSection(&crit_sec_);
+  unsigned int count = waiting_count_;
+  ::LeaveCriticalSection(&crit_sec_);
+  return count;
+}
+
+void RunQueue::Signal(Waiter *admitted) {
+  while (admitted) {
+    // The waiter may return as soon as its event is set
+    Waiter *next = admitted->next;
+    ::SetEvent(admitted->event);
+    admitted = next;
+  }
+}
+
+bool RunQueue::Fits(uint64_t memory, unsigned int cores) const {
+  if (memory_budget_ && reserved_memory_ + memory > memory_budget_)
+    return false;
+  if (core_budget_ && reserved_cores_ + cores > core_budget_)
+    return false;
+  return true;
+}
+
+bool RunQueue::HasWaiter(Priority priority) const {
+  for (int i = 0; i <= priority; ++i) {
+    if (heads_[i])
+      return true;
+  }
+  return false;
+}
+
+void RunQueue::Enqueue(Waiter *waiter, Priority priority) {
+  waiter->prev = tails_[priority];
+  waiter->next = nullptr;
+  if (tails_[priority])
+    tails_[priority]->next = waiter;
+  else
+    heads_[priority] = waiter;
+  tails_[priority] = waiter;
+  ++waiting_count_;
+}
+
+void RunQueue::Unlink(Waiter *waiter, Priority priority) {
+  if (waiter->prev)
+    waiter->prev->next = waiter->next;
+  else
+    heads_[priority] = waiter->next;
+  if (waiter->next)
+    waiter->next->prev = waiter->prev;
+  else
+    tails_[priority] = waiter->prev;
+  --waiting_count_;
+}
+
+RunQueue::Waiter *RunQueue::AdmitWaiters() {
+  Waiter *admitted = nullptr;
+  Waiter **tail = &admitted;
+  for (int i = 0; i < PRIORITY_COUNT; ++i) {
+    Priority priority = static_cast<Priority>(i);
+    while (Waiter *waiter = heads_[priority]) {
+      if (!Fits(waiter->memory, waiter->cores))
+        return admitted;
+      Unlink(waiter, priority);
+      reserved_memory_ += waiter->memory;
+      reserved_cores_ += waiter->cores;
+      waiter->admitted = true;
+      waiter->next = nullptr;
+      *tail = waiter;
+      tail = &waiter->next;
+    }
+  }
+  return admitted;
+}
+
+}
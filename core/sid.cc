@@ -4,33 +4,167 @@
 
 #include <winc/sid.h>
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+using std::lock_guard;
+using std::mutex;
+using std::string;
+using std::unordered_set;
 
 namespace winc {
 
+static_assert(sizeof(Sid) == 68, "layout of the Windows SID structure");
+
+namespace {
+
+const uint64_t kMaxAuthority = (1ULL << 48) - 1;
+
+// Parses a decimal number, or a hexadecimal one with 0x if allowed, up to
+// the next dash or the end of the text
+bool ParseNumber(const char **p, bool allow_hex, uint64_t max,
+                 uint64_t *out_value) {
+  const char *s = *p;
+  unsigned int base = 10;
+  if (allow_hex && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+    base = 16;
+    s += 2;
+  }
+  uint64_t value = 0;
+  const char *begin = s;
+  for (; *s && *s != '-'; ++s) {
+    unsigned int digit;
+    if (*s >= '0' && *s <= '9')
+      digit = *s - '0';
+    else if (base == 16 && *s >= 'a' && *s <= 'f')
+      digit = *s - 'a' + 10;
+    else if (base == 16 && *s >= 'A' && *s <= 'F')
+      digit = *s - 'A' + 10;
+    else
+      return false;
+    if (value > (max - digit) / base)
+      return false;
+    value = value * base + digit;
+  }
+  if (s == begin)
+    return false;
+  *p = s;
+  *out_value = value;
+  return true;
+}
+
+// The interned SIDs, never freed so that the pointers stay valid
+mutex g_intern_mutex;
+unordered_set<Sid> *g_interned_sids;
+
+}
+
+ResultCode Sid::Init(uint64_t authority, const uint32_t *sub_authorities,
+                     unsigned int count) {
+  if (authority > kMaxAuthority || count > kMaxSubAuthorities)
+    return WINC_ERROR_SID;
+  *this = Sid();
+  for (unsigned int i = 0; i < 6; ++i)
+    authority_[i] = AuthorityByte(authority, i);
+  sub_authority_count_ = static_cast<uint8_t>(count);
+  memcpy(sub_authorities_, sub_authorities, count * sizeof(uint32_t));
+  return WINC_OK;
+}
+
+bool Sid::Parse(const string &text, Sid *out_sid) {
+  const char *p = text.c_str();
+  if ((p[0] != 'S' && p[0] != 's') || p[1] != '-' || p[2] != '1' ||
+      p[3] != '-')
+    return false;
+  p += 4;
+  uint64_t authority;
+  if (!ParseNumber(&p, true, kMaxAuthority, &authority))
+    return false;
+  uint32_t sub_authorities[kMaxSubAuthorities];
+  unsigned int count = 0;
+  while (*p) {
+    ++p;
+    uint64_t sub_authority;
+    if (count == kMaxSubAuthorities ||
+        !ParseNumber(&p, false, UINT32_MAX, &sub_authority))
+      return false;
+    sub_authorities[count++] = static_cast<uint32_t>(sub_authority);
+  }
+  // The string cannot contain a null in the middle
+  if (p != text.c_str() + text.size())
+    return false;
+  return out_sid->Init(authority, sub_authorities, count) == WINC_OK;
+}
+
+string Sid::Format() const {
+  char buffer[32];
+  uint64_t value = authority();
+  if (value >> 32) {
+    snprintf(buffer, sizeof(buffer), "S-%u-0x%012" PRIX64, revision_, value);
+  } else {
+    snprintf(buffer, sizeof(buffer), "S-%u-%" PRIu64, revision_, value);
+  }
+  string text = buffer;
+  for (unsigned int i = 0; i < sub_authority_count_; ++i) {
+    snprintf(buffer, sizeof(buffer), "-%" PRIu32, sub_authorities_[i]);
+    text += buffer;
+  }
+  return text;
+}
+
+const Sid *Sid::Intern(const Sid &sid) {
+  lock_guard<mutex> lock(g_intern_mutex);
+  if (!g_interned_sids)
+    g_interned_sids = new unordered_set<Sid>;
+  // The elements of the set keep their addresses as it grows
+  return &*g_interned_sids->insert(sid).first;
+}
+
+size_t Sid::Hash() const {
+  // FNV-1a over the binary form
+  uint64_t hash = 14695981039346656037ULL;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(this);
+  for (size_t i = 0; i < length(); ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<size_t>(hash);
+}
+
+#ifdef _WIN32
+
 ResultCode Sid::Init(PSID_IDENTIFIER_AUTHORITY identifier_authority,
                      DWORD sub_authority) {
-  PSID sid;
-  if (!::AllocateAndInitializeSid(identifier_authority,
-                                  1, sub_authority, 0, 0, 0, 0, 0, 0, 0,
-                                  &sid))
-    return WINC_ERROR_SID;
-  ResultCode rc = Init(sid);
-  ::FreeSid(sid);
-  return rc;
+  uint64_t authority = 0;
+  for (BYTE byte : identifier_authority->Value)
+    authority = authority << 8 | byte;
+  uint32_t sub_authorities[] = {sub_authority};
+  return Init(authority, sub_authorities, 1);
 }
 
 ResultCode Sid::Init(PSID data) {
-  if (!::CopySid(sizeof(data_), data_, data))
+  if (!::IsValidSid(data) || ::GetLengthSid(data) > sizeof(*this))
     return WINC_ERROR_SID;
+  memcpy(this, data, ::GetLengthSid(data));
   return WINC_OK;
 }
 
 ResultCode Sid::Init(WELL_KNOWN_SID_TYPE type) {
-  DWORD size = sizeof(data_);
-  if (!::CreateWellKnownSid(type, NULL, data_, &size))
+  BYTE data[SECURITY_MAX_SID_SIZE];
+  DWORD size = sizeof(data);
+  if (!::CreateWellKnownSid(type, NULL, data, &size))
     return WINC_ERROR_SID;
-  return WINC_OK;
+  return Init(reinterpret_cast<PSID>(data));
 }
 
+#endif
+
 }
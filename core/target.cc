@@ -5,24 +5,61 @@
 #include <winc/target.h>
 
 #include <Windows.h>
-#include <Psapi.h>
 #include <memory>
 #include <utility>
 
+#include <winc/core_allocator.h>
+#include <winc/desktop.h>
+#include <winc/run_queue.h>
+#include "core/desktop_pool.h"
 #include "core/job_object.h"
+#include "core/platform.h"
+#include "core/process_table.h"
 
+using std::make_shared;
 using std::move;
+using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 
 namespace winc {
 
 Target::Target()
   : listening_(false)
+  , leased_core_(nullptr)
+  , reserved_memory_(0)
+  , reserved_cores_(0)
+  , reservation_held_(0)
+  , desktop_held_(0)
+  , next_memory_threshold_(0)
   {}
 
 Target::~Target() {
-  if (listening_)
+  StopListening();
+  // The processes left running still occupy the leased core and commit the
+  // reserved memory, which are only handed out again once they are gone
+  if ((leased_core_ || reservation_held_) && job_object_) {
+    JOBOBJECT_BASIC_ACCOUNTING_INFORMATION info;
+    if (job_object_->GetAccountInfo(&info) != WINC_OK ||
+        info.ActiveProcesses)
+      job_object_->TerminateAndWait(1);
+  }
+  if (desktop_held_) {
+    // Processes left running may still use the desktop, which is closed
+    // instead of returned to the pool then
+    JOBOBJECT_BASIC_ACCOUNTING_INFORMATION info;
+    if (job_object_->GetAccountInfo(&info) != WINC_OK ||
+        info.ActiveProcesses)
+      DesktopPool::Discard(desktop_lease_);
+  }
+  ReleaseResources();
+}
+
+void Target::StopListening() {
+  if (listening_) {
     JobObject::DeassociateCompletionPort(this);
+    listening_ = false;
+  }
 }
 
 void Target::Assign(DWORD process_id, unique_ptr<JobObject> &job_object,
@@ -34,14 +71,98 @@ void Target::Assign(DWORD process_id, unique_ptr<JobObject> &job_object,
   thread_handle_ = move(thread_handle);
 }
 
+void Target::AssignCore(const shared_ptr<CoreAllocator> &core_allocator,
+                        uintptr_t leased_core) {
+  core_allocator_ = core_allocator;
+  leased_core_ = reinterpret_cast<PVOID>(leased_core);
+}
+
+void Target::AssignReservation(const shared_ptr<RunQueue> &run_queue,
+                               uint64_t memory, unsigned int cores) {
+  run_queue_ = run_queue;
+  reserved_memory_ = memory;
+  reserved_cores_ = cores;
+  reservation_held_ = 1;
+}
+
+void Target::AssignDesktop(const shared_ptr<AlternateDesktop> &desktop) {
+  desktop_lease_ = desktop;
+  desktop_held_ = 1;
+}
+
+void Target::ReleaseResources() {
+  uintptr_t leased_core = reinterpret_cast<uintptr_t>(
+      ::InterlockedExchangePointer(&leased_core_, nullptr));
+  if (leased_core)
+    core_allocator_->Release(leased_core);
+  if (::InterlockedExchange(&reservation_held_, 0))
+    run_queue_->Release(reserved_memory_, reserved_cores_);
+  if (::InterlockedExchange(&desktop_held_, 0))
+    desktop_lease_.reset();
+}
+
+void Target::CheckMemoryThresholds() {
+  // Targets attached for testing have no job
+  if (!job_object_)
+    return;
+  while (next_memory_threshold_ < memory_thresholds_.size()) {
+    SIZE_T peak_memory;
+    if (GetJobPeakMemory(&peak_memory) != WINC_OK)
+      return;
+    while (next_memory_threshold_ < memory_thresholds_.size() &&
+           memory_thresholds_[next_memory_threshold_] < peak_memory) {
+      OnMemoryThreshold(static_cast<unsigned int>(next_memory_threshold_),
+                        peak_memory);
+      ++next_memory_threshold_;
+    }
+    bool armed = next_memory_threshold_ < memory_thresholds_.size();
+    if (job_object_->SetMemoryNotificationLimit(
+        armed ? memory_thresholds_[next_memory_threshold_] : 0) != WINC_OK ||
+        !armed)
+      return;
+    // The job may have grown past the threshold before it was armed, in
+    // which case no message is posted for it
+    if (GetJobPeakMemory(&peak_memory) != WINC_OK ||
+        peak_memory <= memory_thresholds_[next_memory_threshold_])
+      return;
+  }
+}
+
+ResultCode Target::SetMemoryThresholds(const SIZE_T *thresholds,
+                                       size_t count) {
+  // The dispatcher reads the thresholds once the target is started
+  if (!thread_handle_)
+    return WINC_ERROR_TARGET;
+  for (size_t i = 1; i < count; ++i) {
+    if (thresholds[i] <= thresholds[i - 1])
+      return WINC_ERROR_TARGET;
+  }
+  if (count && !thresholds[0])
+    return WINC_ERROR_TARGET;
+  memory_thresholds_.assign(thresholds, thresholds + count);
+  next_memory_threshold_ = 0;
+  return WINC_OK;
+}
+
 ResultCode Target::Start(bool listen) {
   if (listen) {
+    if (!process_table_) {
+      HANDLE job;
+      if (!Platform::Get()->DuplicateHandle(job_object_->job_.get(), &job))
+        return WINC_ERROR_TARGET;
+      process_table_ = make_shared<ProcessTable>(job);
+    }
     ResultCode rc = job_object_->AssociateCompletionPort(this);
     if (rc != WINC_OK)
       return rc;
     listening_ = true;
+    if (!memory_thresholds_.empty()) {
+      rc = job_object_->SetMemoryNotificationLimit(memory_thresholds_[0]);
+      if (rc != WINC_OK)
+        return rc;
+    }
   }
-  DWORD ret = ::ResumeThread(thread_handle_.get());
+  DWORD ret = Platform::Get()->ResumeThread(thread_handle_.get());
   if (ret == static_cast<DWORD>(-1)) {
     return WINC_ERROR_TARGET;
   }
@@ -50,11 +171,46 @@ ResultCode Target::Start(bool listen) {
 }
 
 ResultCode Target::WaitForProcess(DWORD timeout_ms, bool *timeouted) {
-  DWORD ret = ::WaitForSingleObject(process_handle_.get(), timeout_ms);
+  DWORD ret = Platform::Get()->WaitForSingleObject(process_handle_.get(),
+                                                   timeout_ms);
   if (ret == WAIT_FAILED)
     return WINC_ERROR_TARGET;
   if (timeouted)
     *timeouted = (ret == WAIT_TIMEOUT);
+  if (ret != WAIT_TIMEOUT &&
+      (leased_core_ || reservation_held_ || desktop_held_)) {
+    // Child processes may still be running on the leased resources
+    JOBOBJECT_BASIC_ACCOUNTING_INFORMATION info;
+    if (job_object_->GetAccountInfo(&info) == WINC_OK &&
+        !info.ActiveProcesses)
+      ReleaseResources();
+  }
+  return WINC_OK;
+}
+
+ResultCode Target::Run(const RunLimits &limits, RunResult *out_result) {
+  ResultCode rc = Start(false);
+  if (rc != WINC_OK) {
+    TerminateJob(1);
+    return rc;
+  }
+  RunResult result = RunResult();
+  rc = WaitForProcess(limits.time_limit_ms ? limits.time_limit_ms : INFINITE,
+                      &result.time_limit_exceeded);
+  if (rc == WINC_OK && result.time_limit_exceeded) {
+    rc = TerminateJob(1);
+    if (rc == WINC_OK)
+      rc = WaitForProcess();
+  }
+  if (rc == WINC_OK)
+    rc = GetProcessExitCode(&result.exit_code);
+  if (rc == WINC_OK)
+    rc = GetJobTime(&result.job_time);
+  if (rc == WINC_OK)
+    rc = GetJobPeakMemory(&result.peak_memory);
+  if (rc != WINC_OK)
+    return rc;
+  *out_result = result;
   return WINC_OK;
 }
 
@@ -74,30 +230,41 @@ ResultCode Target::GetJobTime(ULONG64 *out_time) {
 
 ResultCode Target::GetProcessTime(ULONG64 *out_time) {
   ULONG64 creation_time, exit_time, kernel_time, user_time;
-  if (!::GetProcessTimes(process_handle_.get(),
-                         reinterpret_cast<LPFILETIME>(&creation_time),
-                         reinterpret_cast<LPFILETIME>(&exit_time),
-                         reinterpret_cast<LPFILETIME>(&kernel_time),
-                         reinterpret_cast<LPFILETIME>(&user_time)))
+  if (!Platform::Get()->GetProcessTimes(
+      process_handle_.get(),
+      reinterpret_cast<LPFILETIME>(&creation_time),
+      reinterpret_cast<LPFILETIME>(&exit_time),
+      reinterpret_cast<LPFILETIME>(&kernel_time),
+      reinterpret_cast<LPFILETIME>(&user_time)))
     return WINC_ERROR_TARGET;
   *out_time = kernel_time + user_time;
   return WINC_OK;
 }
 
 ResultCode Target::GetProcessCycle(ULONG64 *out_cycle) {
-  if (!::QueryProcessCycleTime(process_handle_.get(), out_cycle))
+  if (!Platform::Get()->QueryProcessCycleTime(process_handle_.get(),
+                                              out_cycle))
     return WINC_ERROR_TARGET;
   return WINC_OK;
 }
 
 ResultCode Target::GetProcessPeakMemory(SIZE_T *out_size) {
   PROCESS_MEMORY_COUNTERS pmc;
-  if (!::GetProcessMemoryInfo(process_handle_.get(), &pmc, sizeof(pmc)))
+  if (!Platform::Get()->GetProcessMemoryCounters(process_handle_.get(), &pmc))
     return WINC_ERROR_TARGET;
   *out_size = pmc.PeakPagefileUsage;
   return WINC_OK;
 }
 
+ResultCode Target::GetProcessTable(vector<ProcessRecord> *out_table) {
+  if (!process_table_) {
+    out_table->clear();
+    return WINC_OK;
+  }
+  process_table_->GetRecords(out_table);
+  return WINC_OK;
+}
+
 ResultCode Target::GetJobPeakMemory(SIZE_T *out_size) {
   JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit;
   ResultCode rc = job_object_->GetBasicLimit(&limit);
@@ -107,8 +274,17 @@ ResultCode Target::GetJobPeakMemory(SIZE_T *out_size) {
   return WINC_OK;
 }
 
+ResultCode Target::GetJobProcessCount(DWORD *out_count) {
+  JOBOBJECT_BASIC_ACCOUNTING_INFORMATION info;
+  ResultCode rc = job_object_->GetAccountInfo(&info);
+  if (rc != WINC_OK)
+    return WINC_ERROR_TARGET;
+  *out_count = info.TotalProcesses;
+  return WINC_OK;
+}
+
 ResultCode Target::GetProcessExitCode(DWORD *out_code) {
-  if (!::GetExitCodeProcess(process_handle_.get(), out_code))
+  if (!Platform::Get()->GetExitCodeProcess(process_handle_.get(), out_code))
     return WINC_ERROR_TARGET;
   return WINC_OK;
 }
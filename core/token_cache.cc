@@ -0,0 +1,133 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "core/token_cache.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <winc/logon.h>
+#include <winc/sid.h>
+
+using std::hash;
+using std::make_shared;
+using std::move;
+using std::shared_ptr;
+using std::sort;
+using std::unique;
+using std::unordered_map;
+using std::vector;
+
+namespace winc {
+
+namespace {
+
+struct TokenKey {
+  const Logon *logon;
+  DWORD integrity_level;
+  // Interned, sorted by address and without duplicates
+  vector<const Sid *> sids;
+
+  bool operator==(const TokenKey &other) const {
+    return logon == other.logon &&
+           integrity_level == other.integrity_level && sids == other.sids;
+  }
+};
+
+struct TokenKeyHash {
+  size_t operator()(const TokenKey &key) const {
+    size_t value = hash<const Logon *>()(key.logon) ^ key.integrity_level;
+    for (const Sid *sid : key.sids)
+      value = value * 31 + hash<const Sid *>()(sid);
+    return value;
+  }
+};
+
+struct TokenEntry {
+  // Keeps the logon alive, so that its address is not reused while the
+  // entry is in the cache
+  shared_ptr<Logon> logon;
+  shared_ptr<const unique_handle> token;
+};
+
+SRWLOCK g_cache_lock = SRWLOCK_INIT;
+unordered_map<TokenKey, TokenEntry, TokenKeyHash> *g_cache;
+
+// Must be called with the lock held exclusively
+size_t TrimLocked() {
+  if (!g_cache)
+    return 0;
+  for (auto iter = g_cache->begin(); iter != g_cache->end();) {
+    // The cache holds the only reference, no policy can ask for the token
+    if (iter->second.logon.use_count() == 1)
+      iter = g_cache->erase(iter);
+    else
+      ++iter;
+  }
+  return g_cache->size();
+}
+
+}
+
+ResultCode TokenCache::Get(const shared_ptr<Logon> &logon,
+                           const vector<const Sid *> &restricted_sids,
+                           shared_ptr<const unique_handle> *out_token) {
+  TokenKey key;
+  key.logon = logon.get();
+  key.integrity_level = logon->integrity_level();
+  key.sids = restricted_sids;
+  sort(key.sids.begin(), key.sids.end());
+  key.sids.erase(unique(key.sids.begin(), key.sids.end()), key.sids.end());
+
+  ::AcquireSRWLockShared(&g_cache_lock);
+  if (g_cache) {
+    auto iter = g_cache->find(key);
+    if (iter != g_cache->end()) {
+      *out_token = iter->second.token;
+      ::ReleaseSRWLockShared(&g_cache_lock);
+      return WINC_OK;
+    }
+  }
+  ::ReleaseSRWLockShared(&g_cache_lock);
+
+  // Made outside of the lock, a token made concurrently for the same key
+  // is closed in favor of the cached one
+  vector<SID_AND_ATTRIBUTES> sids_to_restrict(key.sids.size());
+  for (size_t i = 0; i < key.sids.size(); ++i) {
+    sids_to_restrict[i].Sid = key.sids[i]->data();
+    sids_to_restrict[i].Attributes = 0;
+  }
+  HANDLE restricted_token;
+  ResultCode rc = logon->FilterToken(
+      sids_to_restrict.data(), static_cast<DWORD>(sids_to_restrict.size()),
+      &restricted_token);
+  if (rc != WINC_OK)
+    return rc;
+  TokenEntry entry;
+  entry.logon = logon;
+  entry.token = make_shared<unique_handle>(restricted_token);
+
+  ::AcquireSRWLockExclusive(&g_cache_lock);
+  if (!g_cache)
+    g_cache = new unordered_map<TokenKey, TokenEntry, TokenKeyHash>;
+  else
+    TrimLocked();
+  auto result = g_cache->emplace(move(key), move(entry));
+  *out_token = result.first->second.token;
+  ::ReleaseSRWLockExclusive(&g_cache_lock);
+  return WINC_OK;
+}
+
+size_t TokenCache::Trim() {
+  ::AcquireSRWLockExclusive(&g_cache_lock);
+  size_t size = TrimLocked();
+  ::ReleaseSRWLockExclusive(&g_cache_lock);
+  return size;
+}
+
+}
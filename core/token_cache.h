@@ -0,0 +1,40 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_TOKEN_CACHE_H_
+#define WINC_CORE_TOKEN_CACHE_H_
+
+#include <Windows.h>
+#include <memory>
+#include <vector>
+
+#include <winc_types.h>
+#include <winc/util.h>
+
+namespace winc {
+
+class Logon;
+class Sid;
+
+// The restricted tokens of the process, shared by all policies with the
+// same logon, set of restricted SIDs and integrity level. A token is made
+// by Logon::FilterToken on the first request and kept while its logon is
+// referenced outside of the cache, so that containers of the shared
+// default logon get the prepared token without any system call.
+class TokenCache {
+public:
+  // Get the restricted token, the SIDs must be interned and may be in any
+  // order. The token is shared and must not be modified.
+  static ResultCode Get(const std::shared_ptr<Logon> &logon,
+                        const std::vector<const Sid *> &restricted_sids,
+                        std::shared_ptr<const unique_handle> *out_token);
+
+  // Closes the tokens whose logon is no longer referenced outside of the
+  // cache, returns the number of tokens kept
+  static size_t Trim();
+};
+
+}
+
+#endif
@@ -2,8 +2,14 @@
 
 #include <cstdlib>
 
+#include "core/platform.h"
+
 namespace winc {
 
+void CloseHandleDeleter::operator()(HANDLE object) const {
+  Platform::Get()->CloseHandle(object);
+}
+
 ProcThreadAttributeList::~ProcThreadAttributeList() {
   if (data_) {
     DeleteProcThreadAttributeList(data_);
@@ -6,9 +6,15 @@
 #define WINC_H_
 
 #include <winc_types.h>
+#include <winc/command_line.h>
 #include <winc/container.h>
+#include <winc/core_allocator.h>
+#include <winc/environment.h>
+#include <winc/executor.h>
 #include <winc/logon.h>
+#include <winc/output.h>
 #include <winc/policy.h>
+#include <winc/run_queue.h>
 #include <winc/sid.h>
 #include <winc/target.h>
 #include <winc/util.h>
@@ -0,0 +1,67 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_COMMAND_LINE_H_
+#define WINC_CORE_COMMAND_LINE_H_
+
+#include <cstddef>
+#include <memory>
+
+namespace winc {
+
+// Joins arguments into a command line which CommandLineToArgvW, and the
+// startup code of the C runtime, split back into the same arguments.
+//
+// The program name is the first argument. It is parsed without escapes, so
+// it is quoted if it has whitespace and any quote in it is dropped, as no
+// path can contain one. The other arguments are quoted if they are empty or
+// have whitespace or quotes, a quote is escaped with a backslash and the
+// backslashes before a quote, or before the closing quote, are doubled.
+//
+// The size is computed in a first pass, so that the command line is written
+// into a single allocation, or into a buffer of the caller. Nothing here
+// depends on the Windows API.
+class CommandLineBuilder {
+public:
+  CommandLineBuilder()
+    : size_(0)
+    {}
+
+  // Number of characters of the command line, including the terminating
+  // null
+  static size_t ComputeSize(const wchar_t *const *argv, size_t argc);
+
+  // Writes the command line into a buffer of at least ComputeSize
+  // characters, returns the number of characters without the terminating
+  // null
+  static size_t Write(const wchar_t *const *argv, size_t argc,
+                      wchar_t *buffer);
+
+  // Builds the command line into the buffer of the builder, replacing the
+  // previous one
+  void Build(const wchar_t *const *argv, size_t argc);
+
+  // The built command line, which is writable as CreateProcess requires,
+  // null if nothing is built
+  wchar_t *command_line() {
+    return buffer_.get();
+  }
+
+  // Number of characters without the terminating null
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  std::unique_ptr<wchar_t[]> buffer_;
+  size_t size_;
+
+private:
+  CommandLineBuilder(const CommandLineBuilder &) = delete;
+  void operator=(const CommandLineBuilder &) = delete;
+};
+
+}
+
+#endif
@@ -7,13 +7,17 @@
 
 #include <Windows.h>
 #include <memory>
+#include <vector>
 
 #include <winc_types.h>
 #include <winc/policy.h>
 
 namespace winc {
 
+class CoreAllocator;
 class Target;
+struct RunLimits;
+struct RunResult;
 
 // The options in this structure are all optional
 struct SpawnOptions {
@@ -23,10 +27,23 @@ struct SpawnOptions {
   // the Windows API requirement
   wchar_t *command_line;
 
+  // The arguments of the command line, the program name first. If set,
+  // the command line is built from them by CommandLineBuilder and
+  // command_line is ignored.
+  const wchar_t *const *argv;
+  size_t argc;
+
   // Current directory for execution
   const wchar_t *current_directory;
 
   uintptr_t processor_affinity;
+
+  // Lease an exclusive physical core from the core allocator of the
+  // container, overrides processor_affinity. The core is released when all
+  // processes of the target exit.
+  bool auto_affinity;
+
+  // Zero takes the default limit of the policy
   uintptr_t memory_limit;
   uint32_t active_process_limit;
 
@@ -36,10 +53,21 @@ struct SpawnOptions {
   HANDLE stdin_handle;
   HANDLE stdout_handle;
   HANDLE stderr_handle;
+
+  // Variables merged into the environment of the policy for this spawn,
+  // or into the environment of the current process if the policy has none.
+  // NAME=VALUE sets a variable and NAME alone removes it.
+  const wchar_t *const *environment_overrides;
+  size_t environment_override_count;
 };
 
+// The spawns and the lazily created state of a container are serialized, so
+// a container may be shared by threads. The policy returned by GetPolicy is
+// not, and must be set up before the spawns.
 class Container {
 public:
+  Container();
+
   ResultCode Spawn(const wchar_t *exe_path, Target *target) {
     return Spawn(exe_path, target, nullptr);
   }
@@ -47,11 +75,40 @@ public:
   ResultCode Spawn(const wchar_t *exe_path, Target *target,
                    SpawnOptions *options);
 
+  // Spawns and runs a target to the exit of its process, see Target::Run
+  ResultCode Run(const wchar_t *exe_path, SpawnOptions *options,
+                 const RunLimits &limits, RunResult *out_result);
+
   // Returns a borrow reference of the mutable policy
   ResultCode GetPolicy(Policy **out_policy);
 
+  // The core allocator defaults to the one shared by the process
+  ResultCode GetCoreAllocator(std::shared_ptr<CoreAllocator> *out_allocator);
+  void SetCoreAllocator(const std::shared_ptr<CoreAllocator> &allocator);
+
+private:
+  ResultCode SpawnLocked(const wchar_t *exe_path, Target *target,
+                         SpawnOptions *options);
+  ResultCode GetPolicyLocked(Policy **out_policy);
+  ResultCode GetCoreAllocatorLocked(
+      std::shared_ptr<CoreAllocator> *out_allocator);
+
 private:
+  // Held across the spawns, which share the lazy state of the policy and
+  // the environment arena
+  SRWLOCK lock_;
   std::unique_ptr<Policy> policy_;
+  std::shared_ptr<CoreAllocator> core_allocator_;
+  // Environment of the current process, compiled on the first spawn with
+  // overrides but without an environment in the policy
+  std::shared_ptr<const EnvironmentBlock> process_environment_;
+  // Scratch space of the environment merged with the overrides, reused by
+  // the spawns
+  std::vector<wchar_t> environment_arena_;
+
+private:
+  Container(const Container &) = delete;
+  void operator=(const Container &) = delete;
 };
 
 }
@@ -0,0 +1,63 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_CORE_ALLOCATOR_H_
+#define WINC_CORE_CORE_ALLOCATOR_H_
+
+#include <Windows.h>
+#include <memory>
+#include <vector>
+
+#include <winc_types.h>
+
+namespace winc {
+
+// Leases exclusive physical cores to targets, so that concurrent timed runs
+// never share a core with each other's hyper-threads. A leased core is
+// returned as the affinity mask of a single logical processor on it, the
+// sibling logical processors are kept idle until the core is released.
+class CoreAllocator {
+public:
+  CoreAllocator();
+  ~CoreAllocator();
+
+  // Discover the processor topology
+  ResultCode Init();
+
+  // Lease a free physical core, cores sharing a L2 cache with fewer leased
+  // cores are preferred
+  ResultCode Lease(uintptr_t *out_affinity);
+  void Release(uintptr_t affinity);
+
+  unsigned int core_count() const {
+    return static_cast<unsigned int>(cores_.size());
+  }
+
+  unsigned int free_core_count();
+
+  // Get the allocator shared by all containers in this process
+  static ResultCode GetShared(std::shared_ptr<CoreAllocator> *out_allocator);
+
+private:
+  struct Core {
+    // Logical processors of the core
+    uintptr_t processor_mask;
+    // Index into the L2 cache group table
+    unsigned int cache_group;
+    bool leased;
+  };
+
+  CRITICAL_SECTION crit_sec_;
+  std::vector<Core> cores_;
+  // Number of leased cores of each L2 cache group
+  std::vector<unsigned int> cache_group_leased_;
+
+private:
+  CoreAllocator(const CoreAllocator &) = delete;
+  void operator=(const CoreAllocator &) = delete;
+};
+
+}
+
+#endif
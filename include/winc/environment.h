@@ -0,0 +1,71 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_ENVIRONMENT_H_
+#define WINC_CORE_ENVIRONMENT_H_
+
+#include <Windows.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <winc_types.h>
+
+namespace winc {
+
+// An immutable environment block in the layout of CreateProcess with
+// CREATE_UNICODE_ENVIRONMENT: NAME=VALUE strings sorted by name without
+// regard to case, each terminated by a null, and a null at the end.
+//
+// Blocks are compiled once and shared. Compiling a block of the same
+// content as a live one returns that block, found by the hash of the
+// content in a table of the process.
+class EnvironmentBlock {
+public:
+  // Compiles NAME=VALUE variables, a later variable overrides an earlier
+  // one of the same name. Fails with WINC_ERROR_ENVIRONMENT on a variable
+  // without a name or an equal sign.
+  static ResultCode Compile(const wchar_t *const *variables, size_t count,
+                            std::shared_ptr<const EnvironmentBlock> *out_block);
+
+  // Compiles the environment of the current process
+  static ResultCode FromCurrentProcess(
+      std::shared_ptr<const EnvironmentBlock> *out_block);
+
+  // Writes the block with the overrides merged in one pass into the arena,
+  // which keeps its capacity between merges. NAME=VALUE sets a variable
+  // and NAME alone removes it, a later override wins over an earlier one.
+  ResultCode Merge(const wchar_t *const *overrides, size_t count,
+                   std::vector<wchar_t> *arena) const;
+
+  const wchar_t *data() const {
+    return data_.data();
+  }
+
+  // In characters, including every null
+  size_t size() const {
+    return data_.size();
+  }
+
+  uint64_t hash() const {
+    return hash_;
+  }
+
+private:
+  EnvironmentBlock()
+    : hash_(0)
+    {}
+
+private:
+  std::vector<wchar_t> data_;
+  uint64_t hash_;
+
+private:
+  EnvironmentBlock(const EnvironmentBlock &) = delete;
+  void operator=(const EnvironmentBlock &) = delete;
+};
+
+}
+
+#endif
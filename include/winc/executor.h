@@ -0,0 +1,115 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_EXECUTOR_H_
+#define WINC_CORE_EXECUTOR_H_
+
+#include <Windows.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <winc_types.h>
+#include <winc/output.h>
+#include <winc/util.h>
+
+namespace winc {
+
+class Container;
+
+struct ExecutorJob {
+  std::wstring exe_path;
+  // The full command line, the executable path is used if empty
+  std::wstring command_line;
+  // Written to the standard input of the target while it runs
+  std::string input;
+
+  uintptr_t processor_affinity;
+  // Lease an exclusive core for the job, see SpawnOptions
+  bool auto_affinity;
+  uintptr_t memory_limit;
+  uint32_t active_process_limit;
+  // Wall time limit in milliseconds, zero for no limit. The job is
+  // terminated when the limit is exceeded.
+  DWORD time_limit_ms;
+  // Capture the standard output up to the given number of bytes, zero for
+  // no capture
+  size_t output_limit;
+};
+
+struct ExecutorResult {
+  // Index of the job in the submitted list
+  size_t index;
+  // Error of the spawn, start and wait cycle, the fields below are only
+  // valid if this is WINC_OK
+  ResultCode rc;
+  bool time_limit_exceeded;
+  DWORD exit_code;
+  // In 100 nanoseconds
+  ULONG64 job_time;
+  SIZE_T peak_memory;
+  // The captured standard output, null if not captured
+  std::shared_ptr<CapturedOutput> output;
+};
+
+// Runs a list of jobs on a fixed set of worker threads. Each worker runs
+// the spawn, start, wait and collect cycle of its jobs, and steals from
+// the other workers when its own deque is drained. Results are streamed
+// in completion order.
+class Executor {
+public:
+  Executor();
+  // Jobs not started yet are cancelled, running jobs are waited for
+  ~Executor();
+
+  // The container must outlive the executor. A zero worker count means
+  // one worker per logical processor.
+  ResultCode Init(Container *container, std::vector<ExecutorJob> jobs,
+                  unsigned int worker_count);
+
+  // Wait for the next completed job, finished is set once all of the
+  // results have been returned. Only one thread may consume the results.
+  ResultCode Next(ExecutorResult *out_result, bool *finished);
+
+  size_t job_count() const {
+    return jobs_.size();
+  }
+
+private:
+  struct Worker {
+    Executor *executor;
+    unsigned int id;
+    CRITICAL_SECTION crit_sec;
+    // Indices of the pending jobs, the owner pops from the back and
+    // thieves steal from the front
+    std::deque<size_t> pending;
+    unique_handle thread;
+  };
+
+  static DWORD WINAPI WorkerThread(PVOID param);
+  bool PopJob(Worker *worker, size_t *out_index);
+  bool StealJob(Worker *thief, size_t *out_index);
+  void RunJob(size_t index, ExecutorResult *result);
+  void PushResult(const ExecutorResult &result);
+
+private:
+  Container *container_;
+  std::vector<ExecutorJob> jobs_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  LONG volatile cancelled_;
+  CRITICAL_SECTION result_crit_sec_;
+  std::deque<ExecutorResult> results_;
+  // Counts the results in the queue
+  unique_handle result_semaphore_;
+  size_t returned_count_;
+
+private:
+  Executor(const Executor &) = delete;
+  void operator=(const Executor &) = delete;
+};
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include <Windows.h>
 #include <Aclapi.h>
+#include <memory>
 #include <string>
 
 #include <winc_types.h>
@@ -33,6 +34,10 @@ public:
                                  DWORD allowed_access) const {
     return WINC_OK;
   }
+  // Integrity level set on the filtered tokens, zero if unchanged
+  virtual DWORD integrity_level() const {
+    return 0;
+  }
 
 protected:
   void set_token(HANDLE token) {
@@ -68,6 +73,10 @@ public:
                                  HANDLE *out_token) const override;
   virtual ResultCode GrantAccess(HANDLE object, SE_OBJECT_TYPE object_type,
                                  DWORD allowed_access) const override;
+  virtual DWORD integrity_level() const override {
+    return integrity_level_;
+  }
+
 private:
   DWORD integrity_level_;
 };
@@ -75,6 +84,13 @@ private:
 class CurrentLogon : public LogonWithIntegrity {
 public:
   ResultCode Init(DWORD integrity_level);
+
+  // Get the logon of the current user shared by the whole process, made on
+  // the first call for each integrity level and never released, so that
+  // the token of the process is opened once. Its SIDs are looked up before
+  // it is shared, so it can be used from any thread.
+  static ResultCode GetShared(DWORD integrity_level,
+                              std::shared_ptr<CurrentLogon> *out_logon);
 };
 
 class UserLogon : public LogonWithIntegrity {
@@ -0,0 +1,44 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_OUTPUT_H_
+#define WINC_CORE_OUTPUT_H_
+
+#include <Windows.h>
+#include <vector>
+
+namespace winc {
+
+class OutputReader;
+
+// A standard stream of a target captured into memory
+class CapturedOutput {
+public:
+  CapturedOutput()
+    : truncated_(false)
+    {}
+
+  const char *data() const {
+    return data_.data();
+  }
+
+  size_t size() const {
+    return data_.size();
+  }
+
+  // Set if the stream exceeded the capture limit, the output beyond the
+  // limit is discarded
+  bool truncated() const {
+    return truncated_;
+  }
+
+private:
+  friend class OutputReader;
+  std::vector<char> data_;
+  bool truncated_;
+};
+
+}
+
+#endif
@@ -6,10 +6,12 @@
 #define WINC_CORE_POLICY_H_
 
 #include <Windows.h>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include <winc/desktop.h>
+#include <winc/environment.h>
 #include <winc/logon.h>
 #include <winc/util.h>
 
@@ -17,24 +19,24 @@ namespace winc {
 
 class Container;
 class JobObject;
+class JobObjectPool;
 class Sid;
 
 class Policy {
 public:
-  Policy()
-    : use_desktop_(false)
-    , job_basic_limit_(0)
-    , job_ui_limit_(0)
-    {}
+  Policy();
+  ~Policy();
 
 public:
   ResultCode GetLogon(std::shared_ptr<Logon> *out_logon);
   void SetLogon(const std::shared_ptr<Logon> &logon);
   void AddRestrictSid(const Sid &sid);
   void RemoveRestrictSid(const Sid &sid);
+  bool HasRestrictSid(const Sid &sid);
 
 public:
-  const std::vector<Sid> &restricted_sids() {
+  // The SIDs are interned, so they compare by pointer
+  const std::vector<const Sid *> &restricted_sids() {
     return restricted_sids_;
   }
 
@@ -62,24 +64,94 @@ public:
     job_ui_limit_ = ui_limit;
   }
 
+  // Process mitigation policy flags (PROCESS_CREATION_MITIGATION_POLICY_*)
+  // applied at process creation. The kernel checks these flags on the
+  // system call path, e.g. the win32k system call disable policy rejects
+  // all USER and GDI system calls of the target.
+  DWORD64 mitigation_policy() {
+    return mitigation_policy_;
+  }
+
+  void set_mitigation_policy(DWORD64 policy) {
+    mitigation_policy_ = policy;
+  }
+
+  // Number of pre-configured job objects kept ready for spawning,
+  // zero disables the pool
+  unsigned int job_pool_size() {
+    return job_pool_size_;
+  }
+
+  void set_job_pool_size(unsigned int size);
+
+  // Environment of the targets, compiled once by EnvironmentBlock::Compile
+  // and passed to every spawn as is. Null inherits the environment of the
+  // current process.
+  const std::shared_ptr<const EnvironmentBlock> &environment() {
+    return environment_;
+  }
+
+  void set_environment(
+      const std::shared_ptr<const EnvironmentBlock> &environment) {
+    environment_ = environment;
+  }
+
+  // Limits of the spawns which do not set their own in SpawnOptions, zero
+  // for no limit
+  uintptr_t default_memory_limit() {
+    return default_memory_limit_;
+  }
+
+  void set_default_memory_limit(uintptr_t memory_limit) {
+    default_memory_limit_ = memory_limit;
+  }
+
+  uint32_t default_active_process_limit() {
+    return default_active_process_limit_;
+  }
+
+  void set_default_active_process_limit(uint32_t active_process_limit) {
+    default_active_process_limit_ = active_process_limit;
+  }
+
+  // Writes the policy as a compact versioned binary image, which can be
+  // shipped to other processes and loaded by Load. The logon and the
+  // environment are not part of the image.
+  void Save(std::vector<uint8_t> *out_image) const;
+
+  // Replaces the settings of the policy with the ones of an image written
+  // by Save. The image is validated and read in place, so it may be e.g. a
+  // read-only mapping of a file shared by the worker processes. The policy
+  // is unchanged if the image is invalid.
+  ResultCode Load(const void *image, size_t size);
+
 private:
   friend class Container;
-  // Get a restricted token, returns borrow reference
+  // Get a restricted token from the token cache, returns borrow reference
   ResultCode GetRestrictedToken(HANDLE *out_token);
-  // Get a desktop, returns borrow reference
-  ResultCode GetDesktop(Desktop **out_desktop);
+  // Get a desktop, returns borrow reference. The lease of an alternate
+  // desktop is returned too, null for the default desktop.
+  ResultCode GetDesktop(Desktop **out_desktop,
+                        std::shared_ptr<AlternateDesktop> *out_lease);
   // Make a job object, returns new reference
   ResultCode MakeJobObject(JobObject **out_job);
 
 private:
-  unique_handle restricted_token_;
+  std::shared_ptr<const unique_handle> restricted_token_;
   bool use_desktop_;
   DWORD job_basic_limit_;
   DWORD job_ui_limit_;
+  DWORD64 mitigation_policy_;
+  unsigned int job_pool_size_;
+  uintptr_t default_memory_limit_;
+  uint32_t default_active_process_limit_;
+  std::unique_ptr<JobObjectPool> job_object_pool_;
   std::unique_ptr<DefaultDesktop> default_desktop_;
-  std::unique_ptr<AlternateDesktop> alternate_desktop_;
+  // Leased from the desktop pool, returned when released
+  std::shared_ptr<AlternateDesktop> alternate_desktop_;
   std::shared_ptr<Logon> logon_;
-  std::vector<Sid> restricted_sids_;
+  std::vector<const Sid *> restricted_sids_;
+  std::shared_ptr<const EnvironmentBlock> environment_;
 };
 
 }
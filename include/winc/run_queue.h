@@ -0,0 +1,117 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_CORE_RUN_QUEUE_H_
+#define WINC_CORE_RUN_QUEUE_H_
+
+#include <Windows.h>
+#include <cstdint>
+#include <memory>
+
+#include <winc_types.h>
+
+namespace winc {
+
+class Container;
+class Target;
+struct SpawnOptions;
+
+// Admission control on top of a container. A spawn is admitted only while
+// the sum of the reserved memory limits and leased cores of the running
+// targets stays within the host budgets, otherwise the caller waits in its
+// priority class. Waiters are admitted in priority order and FIFO within a
+// class, a waiter that does not fit blocks the waiters behind it so that
+// large requests are not starved.
+//
+// The run queue must be owned by a std::shared_ptr, since the spawned
+// targets keep it alive until their reservations are released.
+class RunQueue : public std::enable_shared_from_this<RunQueue> {
+public:
+  enum Priority {
+    PRIORITY_HIGH = 0,
+    PRIORITY_NORMAL = 1,
+    PRIORITY_LOW = 2,
+    PRIORITY_COUNT = 3,
+  };
+
+  RunQueue();
+  ~RunQueue();
+
+  // A zero budget is unbounded. The container must outlive the run queue.
+  ResultCode Init(Container *container, uint64_t memory_budget,
+                  unsigned int core_budget);
+
+  // Wait for admission and spawn the target. The target reserves its
+  // memory limit, or the default memory limit of the policy if it has
+  // none, and one core if auto affinity is requested, until all of its
+  // processes exit. With a memory budget, a spawn without any memory limit
+  // fails with WINC_ERROR_OVER_BUDGET.
+  ResultCode Spawn(const wchar_t *exe_path, Target *target,
+                   SpawnOptions *options, Priority priority);
+
+  // Reserve budget directly, for callers which manage the lifetime of the
+  // reservation by themselves
+  ResultCode Acquire(uint64_t memory, unsigned int cores, Priority priority) {
+    return Acquire(memory, cores, priority, INFINITE);
+  }
+
+  // Fails with WINC_ERROR_TIMEOUT if not admitted within the timeout, in
+  // which case nothing is reserved and nothing must be released
+  ResultCode Acquire(uint64_t memory, unsigned int cores, Priority priority,
+                     DWORD timeout_ms);
+  void Release(uint64_t memory, unsigned int cores);
+
+  uint64_t memory_budget() const {
+    return memory_budget_;
+  }
+
+  unsigned int core_budget() const {
+    return core_budget_;
+  }
+
+  uint64_t reserved_memory();
+  unsigned int reserved_cores();
+  unsigned int waiting_count();
+
+private:
+  // Lives on the stack of the waiting thread, linked into the queue of its
+  // priority class
+  struct Waiter {
+    Waiter *prev;
+    Waiter *next;
+    uint64_t memory;
+    unsigned int cores;
+    HANDLE event;
+    bool admitted;
+  };
+
+  // The following methods must be called with the lock held
+  bool Fits(uint64_t memory, unsigned int cores) const;
+  bool HasWaiter(Priority priority) const;
+  void Enqueue(Waiter *waiter, Priority priority);
+  void Unlink(Waiter *waiter, Priority priority);
+  // Admit waiters from the queue heads, the admitted waiters are linked
+  // through next and must be signaled after the lock is released
+  Waiter *AdmitWaiters();
+  static void Signal(Waiter *admitted);
+
+private:
+  Container *container_;
+  uint64_t memory_budget_;
+  unsigned int core_budget_;
+  CRITICAL_SECTION crit_sec_;
+  uint64_t reserved_memory_;
+  unsigned int reserved_cores_;
+  unsigned int waiting_count_;
+  Waiter *heads_[PRIORITY_COUNT];
+  Waiter *tails_[PRIORITY_COUNT];
+
+private:
+  RunQueue(const RunQueue &) = delete;
+  void operator=(const RunQueue &) = delete;
+};
+
+}
+
+#endif
@@ -5,14 +5,72 @@
 #ifndef WINC_CORE_SID_H_
 #define WINC_CORE_SID_H_
 
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
 
 #include <winc_types.h>
 
 namespace winc {
 
+// A security identifier as a value, in the binary layout of the Windows SID
+// structure: the revision, the number of sub-authorities, the 48-bit
+// identifier authority in big endian and the sub-authorities. Only the
+// used sub-authorities take part in the comparison and the hash, so the
+// type is portable and needs no Windows API call to compare.
 class Sid {
 public:
+  static const unsigned int kMaxSubAuthorities = 15;
+
+  constexpr Sid()
+    : revision_(1)
+    , sub_authority_count_(0)
+    , authority_{0, 0, 0, 0, 0, 0}
+    , sub_authorities_{}
+    {}
+
+  constexpr Sid(uint64_t authority, uint32_t sub_authority)
+    : revision_(1)
+    , sub_authority_count_(1)
+    , authority_{AuthorityByte(authority, 0), AuthorityByte(authority, 1),
+                 AuthorityByte(authority, 2), AuthorityByte(authority, 3),
+                 AuthorityByte(authority, 4), AuthorityByte(authority, 5)}
+    , sub_authorities_{sub_authority}
+    {}
+
+  constexpr Sid(uint64_t authority, uint32_t sub_authority0,
+                uint32_t sub_authority1)
+    : revision_(1)
+    , sub_authority_count_(2)
+    , authority_{AuthorityByte(authority, 0), AuthorityByte(authority, 1),
+                 AuthorityByte(authority, 2), AuthorityByte(authority, 3),
+                 AuthorityByte(authority, 4), AuthorityByte(authority, 5)}
+    , sub_authorities_{sub_authority0, sub_authority1}
+    {}
+
+  // Create SID from the identifier authority and the sub-authorities, fails
+  // with more than kMaxSubAuthorities
+  ResultCode Init(uint64_t authority, const uint32_t *sub_authorities,
+                  unsigned int count);
+
+  // Parses the string form, e.g. S-1-5-32-545. The authority is in decimal
+  // or, as written by Format beyond 32 bits, in hexadecimal with 0x.
+  static bool Parse(const std::string &text, Sid *out_sid);
+
+  // The string form of the SID, as ConvertSidToStringSid writes it
+  std::string Format() const;
+
+  // Returns the interned copy of the SID, which lives until the process
+  // exits. Equal SIDs are interned at the same address, so interned SIDs
+  // compare by pointer. Thread safe.
+  static const Sid *Intern(const Sid &sid);
+
+#ifdef _WIN32
   // Create SID with one sub-authority
   ResultCode Init(PSID_IDENTIFIER_AUTHORITY identifier_authority,
                   DWORD sub_authority);
@@ -26,16 +84,40 @@ public:
   // Access raw data of the SID, which should not be modified
   // Return non-const pointer for compatibility with the Windows API
   PSID data() const {
-    return reinterpret_cast<PSID>(const_cast<BYTE *>(data_));
+    return reinterpret_cast<PSID>(const_cast<Sid *>(this));
   }
 
   // Get the length of the SID
   DWORD GetLength() const {
-    return ::GetLengthSid(data());
+    return static_cast<DWORD>(length());
+  }
+#endif
+
+  uint64_t authority() const {
+    uint64_t authority = 0;
+    for (uint8_t byte : authority_)
+      authority = authority << 8 | byte;
+    return authority;
+  }
+
+  constexpr unsigned int sub_authority_count() const {
+    return sub_authority_count_;
+  }
+
+  constexpr uint32_t sub_authority(unsigned int index) const {
+    return sub_authorities_[index];
   }
 
+  // Number of bytes of the binary form
+  constexpr size_t length() const {
+    return kHeaderSize + sub_authority_count_ * sizeof(uint32_t);
+  }
+
+  size_t Hash() const;
+
   bool operator==(const Sid &other) const {
-    return ::EqualSid(data(), other.data()) != 0;
+    return sub_authority_count_ == other.sub_authority_count_ &&
+           !memcmp(this, &other, length());
   }
 
   bool operator!=(const Sid &other) const {
@@ -43,7 +125,43 @@ public:
   }
 
 private:
-  BYTE data_[SECURITY_MAX_SID_SIZE];
+  static const size_t kHeaderSize = 8;
+
+  static constexpr uint8_t AuthorityByte(uint64_t authority,
+                                         unsigned int index) {
+    return static_cast<uint8_t>(authority >> (40 - index * 8));
+  }
+
+private:
+  uint8_t revision_;
+  uint8_t sub_authority_count_;
+  uint8_t authority_[6];
+  uint32_t sub_authorities_[kMaxSubAuthorities];
+};
+
+// Well-known SIDs
+constexpr Sid kNullSid(0, 0);
+constexpr Sid kWorldSid(1, 0);
+constexpr Sid kInteractiveSid(5, 4);
+constexpr Sid kAuthenticatedUserSid(5, 11);
+constexpr Sid kRestrictedCodeSid(5, 12);
+constexpr Sid kLocalSystemSid(5, 18);
+constexpr Sid kBuiltinUsersSid(5, 32, 545);
+
+// The mandatory label of an integrity level, e.g. SECURITY_MANDATORY_LOW_RID
+constexpr Sid MandatoryLabelSid(uint32_t integrity_level) {
+  return Sid(16, integrity_level);
+}
+
+}
+
+namespace std {
+
+template <>
+struct hash<winc::Sid> {
+  size_t operator()(const winc::Sid &sid) const {
+    return sid.Hash();
+  }
 };
 
 }
@@ -7,24 +7,87 @@
 
 #include <Windows.h>
 #include <memory>
+#include <vector>
 
 #include <winc_types.h>
+#include <winc/output.h>
 #include <winc/util.h>
 
 namespace winc {
 
+class AlternateDesktop;
 class Container;
+class CoreAllocator;
 class JobObject;
+class ProcessTable;
+class RunQueue;
+
+struct RunLimits {
+  // Wall time limit in milliseconds, zero for no limit. The job is
+  // terminated when the limit is exceeded.
+  DWORD time_limit_ms;
+
+  // Capture the standard output and error into memory, up to the given
+  // number of bytes, zero for no capture. Only used by Container::Run,
+  // which overrides the handles of the spawn options for the captured
+  // streams.
+  size_t stdout_capture_limit;
+  size_t stderr_capture_limit;
+};
+
+struct RunResult {
+  bool time_limit_exceeded;
+  DWORD exit_code;
+  // In 100 nanoseconds
+  ULONG64 job_time;
+  SIZE_T peak_memory;
+
+  // The captured streams, null if not captured
+  std::shared_ptr<CapturedOutput> stdout_output;
+  std::shared_ptr<CapturedOutput> stderr_output;
+};
+
+// Accounting of a process of the job. The times are in 100 nanoseconds,
+// the creation and exit times since January 1, 1601 (UTC).
+struct ProcessRecord {
+  DWORD process_id;
+  DWORD parent_process_id;
+  ULONG64 creation_time;
+  ULONG64 exit_time;
+  ULONG64 user_time;
+  ULONG64 kernel_time;
+  SIZE_T peak_memory;
+  DWORD exit_code;
+  bool exited;
+  // Set if the process could not be opened, e.g. it exited before its
+  // event was handled, so only the process ID is known
+  bool lost;
+};
 
 class Target {
 public:
   Target();
+  // Terminates the processes left in the job if the target holds a leased
+  // core or a run queue reservation, which are released once they exit
   virtual ~Target();
 
 private:
   friend class Container;
   void Assign(DWORD process_id, std::unique_ptr<JobObject> &job_object,
               unique_handle &process_handle, unique_handle &thread_handle);
+  void AssignCore(const std::shared_ptr<CoreAllocator> &core_allocator,
+                  uintptr_t leased_core);
+  friend class RunQueue;
+  void AssignReservation(const std::shared_ptr<RunQueue> &run_queue,
+                         uint64_t memory, unsigned int cores);
+  void AssignDesktop(const std::shared_ptr<AlternateDesktop> &desktop);
+  // Return the leased core to the allocator, the reservation to the run
+  // queue and the desktop to the pool, may be called from both the event
+  // dispatcher and the owner thread
+  void ReleaseResources();
+  // Deliver the memory thresholds exceeded by the job and arm the next one,
+  // called by the event dispatcher on the notification limit message
+  void CheckMemoryThresholds();
 
 public:
   DWORD process_id() {
@@ -42,21 +105,49 @@ public:
   }
 
   ResultCode WaitForProcess(DWORD timeout_ms, bool *timeouted);
+
+  // Starts the spawned target, waits for the process within the limits and
+  // collects the statistics of the job. No event is delivered, so the job
+  // is not associated with the completion port.
+  ResultCode Run(const RunLimits &limits, RunResult *out_result);
+
   ResultCode TerminateJob(UINT exit_code);
   ResultCode GetJobTime(ULONG64 *out_time);
   ResultCode GetProcessTime(ULONG64 *out_time);
   ResultCode GetProcessCycle(ULONG64 *out_cycle);
   ResultCode GetJobPeakMemory(SIZE_T *out_size);
+  // Number of processes ever associated with the job
+  ResultCode GetJobProcessCount(DWORD *out_count);
   ResultCode GetProcessPeakMemory(SIZE_T *out_size);
   ResultCode GetProcessExitCode(DWORD *out_code);
 
+  // Accounting of every process of the job, in the order of creation. The
+  // table is collected from the job events, so it is only filled for a
+  // target started with listen, and a record is complete once the event of
+  // its exit is delivered. The values of running processes are the current
+  // ones.
+  ResultCode GetProcessTable(std::vector<ProcessRecord> *out_table);
+
+  // Memory thresholds of the job in bytes, strictly ascending. Each one is
+  // delivered once by OnMemoryThreshold, with its index as the level, when
+  // the peak committed memory of the job exceeds it. Only the next threshold
+  // is armed as the notification limit of the job, so nothing is polled.
+  // Must be set before the target is started with listen.
+  ResultCode SetMemoryThresholds(const SIZE_T *thresholds, size_t count);
+
 protected:
+  // Stops the delivery of the events, waiting for the one being delivered.
+  // A derived target whose hooks use its own members calls it first in its
+  // destructor, as ~Target runs after they are destroyed.
+  void StopListening();
+
   friend class JobObject;
   virtual void OnActiveProcessLimit() {}
   virtual void OnExitAll() {}
   virtual void OnNewProcess(DWORD process_id) {}
   virtual void OnExitProcess(DWORD process_id) {}
   virtual void OnMemoryLimit(DWORD process_id) {}
+  virtual void OnMemoryThreshold(unsigned int level, SIZE_T bytes) {}
 
 private:
   bool listening_;
@@ -64,6 +155,26 @@ private:
   std::unique_ptr<JobObject> job_object_;
   unique_handle process_handle_;
   unique_handle thread_handle_;
+  std::shared_ptr<CoreAllocator> core_allocator_;
+  // Affinity mask of the leased core, null if no core is leased
+  PVOID volatile leased_core_;
+  std::shared_ptr<RunQueue> run_queue_;
+  uint64_t reserved_memory_;
+  unsigned int reserved_cores_;
+  // Nonzero while the run queue reservation is held
+  LONG volatile reservation_held_;
+  // Lease of the alternate desktop of the processes, held until they all
+  // exit so that the pool does not hand the desktop to another container
+  std::shared_ptr<AlternateDesktop> desktop_lease_;
+  // Nonzero while the desktop lease is held
+  LONG volatile desktop_held_;
+  // Created by Start with listen. The event dispatcher keeps a reference
+  // while it records a process outside of its lock.
+  std::shared_ptr<ProcessTable> process_table_;
+  std::vector<SIZE_T> memory_thresholds_;
+  // Index of the armed threshold, only used by the event dispatcher once
+  // the target is started
+  size_t next_memory_threshold_;
 
 private:
   Target(const Target &) = delete;
@@ -13,10 +13,9 @@
 
 namespace winc {
 
+// Closes the handle through the platform in use
 struct CloseHandleDeleter {
-  void operator()(HANDLE object) const {
-    ::CloseHandle(object);
-  }
+  void operator()(HANDLE object) const;
 };
 
 typedef std::unique_ptr<std::remove_pointer<HANDLE>::type,
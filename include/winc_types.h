@@ -19,6 +19,11 @@ enum ResultCode {
   WINC_ERROR_UTIL = 7,
   WINC_ERROR_COMPLETION_PORT = 8,
   WINC_PRIVILEGE_NOT_HELD = 9,
+  WINC_ERROR_NO_FREE_CORE = 10,
+  WINC_ERROR_OVER_BUDGET = 11,
+  WINC_ERROR_ENVIRONMENT = 12,
+  WINC_ERROR_POLICY = 13,
+  WINC_ERROR_TIMEOUT = 14,
 };
 
 }
@@ -25,11 +25,16 @@ setup(
                 'advapi32',
                 'ntdll',
                 'user32',
-                'psapi'
+                'psapi',
+                'ws2_32'
             ],
-            sources = glob('core/*.cc') +
+            # The fake platform is only linked into its tests
+            sources = [f for f in glob('core/*.cc')
+                       if not f.endswith('fake_platform.cc')] +
                       glob('bindings/binding_python/*.cc')
         )
     ],
+    package_dir = {'': 'bindings/binding_python'},
+    py_modules = ['winc_aio'],
     long_description = read_readme()
 )
@@ -0,0 +1,30 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_TESTS_BENCH_COMMON_CLOCK_H_
+#define WINC_TESTS_BENCH_COMMON_CLOCK_H_
+
+#include <Windows.h>
+#include <cstdint>
+
+namespace winc {
+
+namespace bench {
+
+// Monotonic time in microseconds
+inline uint64_t NowMicros() {
+  static LARGE_INTEGER frequency = {};
+  if (!frequency.QuadPart)
+    ::QueryPerformanceFrequency(&frequency);
+  LARGE_INTEGER counter;
+  ::QueryPerformanceCounter(&counter);
+  return static_cast<uint64_t>(counter.QuadPart / frequency.QuadPart * 1000000 +
+      counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart);
+}
+
+}
+
+}
+
+#endif
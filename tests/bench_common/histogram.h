@@ -0,0 +1,135 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_TESTS_BENCH_COMMON_HISTOGRAM_H_
+#define WINC_TESTS_BENCH_COMMON_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace winc {
+
+namespace bench {
+
+// A high dynamic range histogram of non-negative integer values. Values are
+// grouped into power of two buckets, each split into 64 linear sub-buckets,
+// so that every recorded value is kept with a relative error below 1/64
+// from 1 up to 2^40, in a fixed amount of memory.
+class Histogram {
+public:
+  Histogram()
+    : counts_(kBucketCount * kSubBucketHalfCount + kSubBucketHalfCount)
+    , total_count_(0)
+    , min_(UINT64_MAX)
+    , max_(0)
+    , sum_(0)
+    {}
+
+  void Record(uint64_t value) {
+    if (value > kMaxValue)
+      value = kMaxValue;
+    ++counts_[IndexOf(value)];
+    ++total_count_;
+    if (value < min_)
+      min_ = value;
+    if (value > max_)
+      max_ = value;
+    sum_ += value;
+  }
+
+  void Merge(const Histogram &other) {
+    for (size_t i = 0; i < counts_.size(); ++i)
+      counts_[i] += other.counts_[i];
+    total_count_ += other.total_count_;
+    if (other.min_ < min_)
+      min_ = other.min_;
+    if (other.max_ > max_)
+      max_ = other.max_;
+    sum_ += other.sum_;
+  }
+
+  // The highest value below which the given percentage of the recorded
+  // values fall, reported as the upper bound of its sub-bucket
+  uint64_t Percentile(double percentile) const {
+    if (!total_count_)
+      return 0;
+    uint64_t rank = static_cast<uint64_t>(
+        percentile / 100.0 * static_cast<double>(total_count_) + 0.5);
+    if (rank < 1)
+      rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        uint64_t value = HighestEquivalentValue(i);
+        return value < max_ ? value : max_;
+      }
+    }
+    return max_;
+  }
+
+  uint64_t count() const {
+    return total_count_;
+  }
+
+  uint64_t min() const {
+    return total_count_ ? min_ : 0;
+  }
+
+  uint64_t max() const {
+    return max_;
+  }
+
+  double mean() const {
+    return total_count_ ? static_cast<double>(sum_) / total_count_ : 0.0;
+  }
+
+private:
+  static const int kSubBucketBits = 7;
+  static const uint64_t kSubBucketCount = 1ull << kSubBucketBits;
+  static const uint64_t kSubBucketHalfCount = kSubBucketCount / 2;
+  static const int kBucketCount = 40 - kSubBucketBits + 1;
+  static const uint64_t kMaxValue = (1ull << 40) - 1;
+
+  static int HighestBit(uint64_t value) {
+    int bit = -1;
+    while (value) {
+      value >>= 1;
+      ++bit;
+    }
+    return bit;
+  }
+
+  // Values below kSubBucketCount map to themselves, a larger value is
+  // shifted right until it has kSubBucketBits significant bits
+  static size_t IndexOf(uint64_t value) {
+    if (value < kSubBucketCount)
+      return static_cast<size_t>(value);
+    int shift = HighestBit(value) - kSubBucketBits + 1;
+    return static_cast<size_t>(shift * kSubBucketHalfCount +
+                               (value >> shift));
+  }
+
+  static uint64_t HighestEquivalentValue(size_t index) {
+    if (index < kSubBucketCount)
+      return index;
+    uint64_t shift = (index - kSubBucketHalfCount) / kSubBucketHalfCount;
+    uint64_t sub_bucket = index - shift * kSubBucketHalfCount;
+    return ((sub_bucket + 1) << shift) - 1;
+  }
+
+private:
+  std::vector<uint64_t> counts_;
+  uint64_t total_count_;
+  uint64_t min_;
+  uint64_t max_;
+  uint64_t sum_;
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,264 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_TESTS_BENCH_COMMON_REPORT_H_
+#define WINC_TESTS_BENCH_COMMON_REPORT_H_
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tests/bench_common/histogram.h"
+
+namespace winc {
+
+namespace bench {
+
+// One measured metric. Latencies carry percentiles, throughputs and other
+// values carry a single value.
+struct Metric {
+  std::string name;
+  std::string unit;
+  bool higher_is_better;
+  uint64_t count;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+  double value;
+};
+
+inline Metric LatencyMetric(const char *name, const char *unit,
+                            const Histogram &histogram) {
+  Metric m = {};
+  m.name = name;
+  m.unit = unit;
+  m.count = histogram.count();
+  m.p50 = static_cast<double>(histogram.Percentile(50.0));
+  m.p90 = static_cast<double>(histogram.Percentile(90.0));
+  m.p99 = static_cast<double>(histogram.Percentile(99.0));
+  m.max = static_cast<double>(histogram.max());
+  m.value = m.p50;
+  return m;
+}
+
+// A single value where lower is better
+inline Metric ValueMetric(const char *name, const char *unit,
+                          uint64_t count, double value) {
+  Metric m = {};
+  m.name = name;
+  m.unit = unit;
+  m.count = count;
+  m.value = value;
+  return m;
+}
+
+inline Metric ThroughputMetric(const char *name, const char *unit,
+                               uint64_t count, double value) {
+  Metric m = {};
+  m.name = name;
+  m.unit = unit;
+  m.higher_is_better = true;
+  m.count = count;
+  m.value = value;
+  return m;
+}
+
+// Writes the metrics as a JSON document, one metric object per line, so
+// that the file is also easy to diff and to read back with ReadReport
+inline bool WriteReport(FILE *fp, const char *benchmark,
+                        const std::vector<Metric> &metrics) {
+  fprintf(fp, "{\"benchmark\": \"%s\", \"metrics\": [\n", benchmark);
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    const Metric &m = metrics[i];
+    fprintf(fp, "  {\"name\": \"%s\", \"unit\": \"%s\", "
+                "\"higher_is_better\": %s, \"count\": %" PRIu64 ", "
+                "\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+                "\"max\": %.1f, \"value\": %.1f}%s\n",
+            m.name.c_str(), m.unit.c_str(),
+            m.higher_is_better ? "true" : "false", m.count,
+            m.p50, m.p90, m.p99, m.max, m.value,
+            i + 1 < metrics.size() ? "," : "");
+  }
+  fprintf(fp, "]}\n");
+  return !ferror(fp);
+}
+
+namespace internal {
+
+inline bool FindString(const char *line, const char *key, std::string *out) {
+  std::string pattern = std::string("\"") + key + "\": \"";
+  const char *p = strstr(line, pattern.c_str());
+  if (!p)
+    return false;
+  p += pattern.size();
+  const char *end = strchr(p, '"');
+  if (!end)
+    return false;
+  out->assign(p, end);
+  return true;
+}
+
+inline double FindNumber(const char *line, const char *key) {
+  std::string pattern = std::string("\"") + key + "\": ";
+  const char *p = strstr(line, pattern.c_str());
+  if (!p)
+    return 0.0;
+  return strtod(p + pattern.size(), NULL);
+}
+
+}
+
+// Reads a report written by WriteReport
+inline bool ReadReport(const char *path, std::vector<Metric> *out_metrics) {
+  FILE *fp;
+  if (fopen_s(&fp, path, "r"))
+    return false;
+  char line[1024];
+  while (fgets(line, sizeof(line), fp)) {
+    Metric m = {};
+    if (!internal::FindString(line, "name", &m.name))
+      continue;
+    internal::FindString(line, "unit", &m.unit);
+    m.higher_is_better = strstr(line, "\"higher_is_better\": true") != NULL;
+    m.count = static_cast<uint64_t>(internal::FindNumber(line, "count"));
+    m.p50 = internal::FindNumber(line, "p50");
+    m.p90 = internal::FindNumber(line, "p90");
+    m.p99 = internal::FindNumber(line, "p99");
+    m.max = internal::FindNumber(line, "max");
+    m.value = internal::FindNumber(line, "value");
+    out_metrics->push_back(m);
+  }
+  fclose(fp);
+  return true;
+}
+
+// Compares the p50 and p99 of latencies and the value of other metrics with
+// the baseline, and prints every change beyond the tolerance in percent.
+// Returns the number of regressions.
+inline int CompareReport(const std::vector<Metric> &baseline,
+                         const std::vector<Metric> &current,
+                         double tolerance) {
+  int regressions = 0;
+  for (const Metric &c : current) {
+    const Metric *b = nullptr;
+    for (const Metric &candidate : baseline) {
+      if (candidate.name == c.name) {
+        b = &candidate;
+        break;
+      }
+    }
+    if (!b) {
+      fprintf(stderr, "%-32s  no baseline\n", c.name.c_str());
+      continue;
+    }
+    struct {
+      const char *field;
+      double base;
+      double now;
+    } checks[] = {
+      {"p50", b->p50, c.p50},
+      {"p99", b->p99, c.p99},
+      {"value", b->value, c.value},
+    };
+    for (const auto &check : checks) {
+      bool is_value = strcmp(check.field, "value") == 0;
+      if (c.higher_is_better && !is_value)
+        continue;
+      // The value of a latency repeats its p50
+      if (!c.higher_is_better && is_value && b->p99 > 0.0)
+        continue;
+      if (check.base <= 0.0)
+        continue;
+      double change = (check.now - check.base) / check.base * 100.0;
+      bool regressed = c.higher_is_better ? change < -tolerance
+                                          : change > tolerance;
+      fprintf(stderr, "%-32s  %-5s  %12.1f -> %12.1f %s  %+7.1f%%%s\n",
+              c.name.c_str(), check.field, check.base, check.now,
+              c.unit.c_str(), change, regressed ? "  REGRESSION" : "");
+      if (regressed)
+        ++regressions;
+    }
+  }
+  return regressions;
+}
+
+// Command line options shared by the benchmark programs
+struct ReportOptions {
+  // --json <path>, the report goes to stdout if not given
+  const char *json_path;
+  // --compare <baseline.json>
+  const char *baseline_path;
+  // --tolerance <percent>
+  double tolerance;
+};
+
+inline ReportOptions DefaultReportOptions() {
+  ReportOptions options = {nullptr, nullptr, 10.0};
+  return options;
+}
+
+// Consumes the option at argv[*index] if it is a report option
+inline bool ParseReportOption(int argc, char **argv, int *index,
+                              ReportOptions *options) {
+  const char *arg = argv[*index];
+  if (*index + 1 >= argc)
+    return false;
+  if (!strcmp(arg, "--json")) {
+    options->json_path = argv[++*index];
+  } else if (!strcmp(arg, "--compare")) {
+    options->baseline_path = argv[++*index];
+  } else if (!strcmp(arg, "--tolerance")) {
+    options->tolerance = atof(argv[++*index]);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Writes the report to the given path, or to stdout if it is null, and
+// compares it with the baseline if given. Returns the exit code of the
+// benchmark program.
+inline int FinishReport(const char *benchmark,
+                        const std::vector<Metric> &metrics,
+                        const ReportOptions &options) {
+  const char *json_path = options.json_path;
+  const char *baseline_path = options.baseline_path;
+  double tolerance = options.tolerance;
+  FILE *fp = stdout;
+  if (json_path && fopen_s(&fp, json_path, "w")) {
+    fprintf(stderr, "Cannot open %s\n", json_path);
+    return 1;
+  }
+  bool written = WriteReport(fp, benchmark, metrics);
+  if (json_path)
+    fclose(fp);
+  if (!written) {
+    fprintf(stderr, "Cannot write report\n");
+    return 1;
+  }
+  if (!baseline_path)
+    return 0;
+  std::vector<Metric> baseline;
+  if (!ReadReport(baseline_path, &baseline)) {
+    fprintf(stderr, "Cannot read baseline %s\n", baseline_path);
+    return 1;
+  }
+  int regressions = CompareReport(baseline, metrics, tolerance);
+  if (regressions) {
+    fprintf(stderr, "%d regression(s) beyond %.1f%%\n",
+            regressions, tolerance);
+    return 2;
+  }
+  return 0;
+}
+
+}
+
+}
+
+#endif
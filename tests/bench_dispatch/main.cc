@@ -0,0 +1,159 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Event dispatch benchmark. Synthetic job messages are posted straight to
+// the completion port of the dispatcher, so that the registry lookup,
+// locking and callback path are measured without spawning. The number of
+// attached targets grows by ten times from 1 to the maximum.
+//
+// usage: bench_dispatch [--events N] [--iterations N] [--warmup N]
+//                       [--max-targets N] [--json PATH]
+//                       [--compare BASELINE] [--tolerance PERCENT]
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <winc.h>
+#include "core/job_object.h"
+#include "tests/bench_common/clock.h"
+#include "tests/bench_common/histogram.h"
+#include "tests/bench_common/report.h"
+
+using namespace winc;
+using namespace winc::bench;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+struct Options {
+  unsigned int events;
+  unsigned int iterations;
+  unsigned int warmup;
+  unsigned int max_targets;
+  ReportOptions report;
+};
+
+// Written by the dispatcher thread only
+LONG volatile g_received = 0;
+uint64_t volatile g_receive_time = 0;
+
+class BenchTarget : public Target {
+protected:
+  virtual void OnNewProcess(DWORD process_id) override {
+    g_receive_time = NowMicros();
+    g_received = g_received + 1;
+  }
+};
+
+// Spread the events over the targets, so that consecutive lookups do not
+// hit the same bucket
+const unsigned int STRIDE = 7919;
+
+void Fail(const char *what, ResultCode rc) {
+  fprintf(stderr, "%s error %d\n", what, rc);
+  exit(1);
+}
+
+void Post(Target *target) {
+  ResultCode rc = JobObject::PostMessageForTesting(
+      target, JOB_OBJECT_MSG_NEW_PROCESS, 0);
+  if (rc != WINC_OK)
+    Fail("Post", rc);
+}
+
+double MeasureThroughput(const vector<unique_ptr<BenchTarget>> &targets,
+                         unsigned int events) {
+  LONG expected = g_received + static_cast<LONG>(events);
+  uint64_t begin = NowMicros();
+  for (unsigned int i = 0; i < events; ++i)
+    Post(targets[(i * STRIDE) % targets.size()].get());
+  while (g_received != expected)
+    ::SwitchToThread();
+  uint64_t elapsed = NowMicros() - begin;
+  return events * 1000000.0 / (elapsed ? elapsed : 1);
+}
+
+void MeasureLatency(const vector<unique_ptr<BenchTarget>> &targets,
+                    unsigned int warmup, unsigned int iterations,
+                    Histogram *histogram) {
+  for (unsigned int i = 0; i < warmup + iterations; ++i) {
+    LONG expected = g_received + 1;
+    uint64_t begin = NowMicros();
+    Post(targets[(i * STRIDE) % targets.size()].get());
+    while (g_received != expected);
+    if (i >= warmup)
+      histogram->Record(g_receive_time - begin);
+  }
+}
+
+void ParseOptions(int argc, char **argv, Options *options) {
+  options->events = 200000;
+  options->iterations = 20000;
+  options->warmup = 1000;
+  options->max_targets = 100000;
+  options->report = DefaultReportOptions();
+  for (int i = 1; i < argc; ++i) {
+    if (ParseReportOption(argc, argv, &i, &options->report))
+      continue;
+    if (i + 1 < argc && !strcmp(argv[i], "--events")) {
+      options->events = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--iterations")) {
+      options->iterations = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--warmup")) {
+      options->warmup = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--max-targets")) {
+      options->max_targets = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+  if (!options->events || !options->iterations || !options->max_targets) {
+    fprintf(stderr, "Counts must be positive\n");
+    exit(1);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  ParseOptions(argc, argv, &options);
+
+  vector<Metric> metrics;
+  for (unsigned int count = 1; ; count *= 10) {
+    if (count > options.max_targets)
+      count = options.max_targets;
+    vector<unique_ptr<BenchTarget>> targets;
+    for (unsigned int i = 0; i < count; ++i) {
+      targets.emplace_back(new BenchTarget);
+      ResultCode rc = JobObject::AttachTargetForTesting(targets.back().get());
+      if (rc != WINC_OK)
+        Fail("Attach", rc);
+    }
+
+    char name[64];
+    double rate = MeasureThroughput(targets, options.events);
+    sprintf_s(name, "events_%u_targets", count);
+    metrics.push_back(ThroughputMetric(name, "event/s", options.events, rate));
+
+    Histogram latency;
+    MeasureLatency(targets, options.warmup, options.iterations, &latency);
+    sprintf_s(name, "latency_%u_targets", count);
+    metrics.push_back(LatencyMetric(name, "us", latency));
+
+    fprintf(stderr, "%8u targets  %12.0f event/s  p50 %4.0f  p99 %4.0f  "
+                    "max %6.0f us\n",
+            count, rate, metrics.back().p50, metrics.back().p99,
+            metrics.back().max);
+    if (count == options.max_targets)
+      break;
+  }
+  return FinishReport("dispatch", metrics, options.report);
+}
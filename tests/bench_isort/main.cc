@@ -0,0 +1,255 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Timing stability benchmark on payload_isort. Runs the payload K times in
+// each configuration and reports the coefficient of variation of the job
+// time, the process cycles and the wall time. Configurations whose
+// variation exceeds the threshold are flagged, and the exit code is 3.
+//
+// Configurations:
+//   isolated       nothing else runs
+//   loaded         busy threads sweep a buffer on every processor
+//   loaded_pinned  as loaded, the target leases an exclusive core
+//
+// usage: bench_isort [--runs K] [--warmup N] [--load-threads N]
+//                    [--threshold PERCENT] [--json PATH]
+//                    [--compare BASELINE] [--tolerance PERCENT]
+
+#include <Windows.h>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <winc.h>
+#include "tests/bench_common/clock.h"
+#include "tests/bench_common/report.h"
+
+using namespace winc;
+using namespace winc::bench;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+struct Options {
+  unsigned int runs;
+  unsigned int warmup;
+  unsigned int load_threads;
+  double threshold;
+  ReportOptions report;
+};
+
+struct Configuration {
+  const char *name;
+  bool load;
+  bool pinned;
+};
+
+const Configuration configurations[] = {
+  {"isolated", false, false},
+  {"loaded", true, false},
+  {"loaded_pinned", true, true},
+};
+
+// Mean and coefficient of variation in percent
+struct Stats {
+  double mean;
+  double cv;
+};
+
+Stats ComputeStats(const vector<double> &samples) {
+  double sum = 0.0;
+  for (double sample : samples)
+    sum += sample;
+  double mean = sum / samples.size();
+  double square_sum = 0.0;
+  for (double sample : samples)
+    square_sum += (sample - mean) * (sample - mean);
+  double stddev = samples.size() > 1 ?
+      sqrt(square_sum / (samples.size() - 1)) : 0.0;
+  Stats stats = {mean, mean > 0.0 ? stddev / mean * 100.0 : 0.0};
+  return stats;
+}
+
+void Fail(const char *what, ResultCode rc) {
+  fprintf(stderr, "%s error %d\n", what, rc);
+  exit(1);
+}
+
+wchar_t g_exe_path[MAX_PATH];
+LONG volatile g_stop_load = 0;
+
+// Keeps a processor and the memory bus busy
+DWORD WINAPI LoadThread(PVOID param) {
+  const size_t SIZE = 32 * 1024 * 1024;
+  unique_ptr<char[]> buffer(new char[SIZE]);
+  memset(buffer.get(), 0, SIZE);
+  unsigned int x = 0;
+  while (!g_stop_load) {
+    for (size_t i = 0; i < SIZE; i += 64) {
+      x = x * 1103515245 + 12345;
+      buffer[i] = static_cast<char>(x);
+    }
+  }
+  return x;
+}
+
+struct Sample {
+  double job_time;
+  double cycles;
+  double wall_time;
+};
+
+Sample RunOnce(Container &c, HANDLE null_handle, bool pinned) {
+  SpawnOptions options = {};
+  options.stdout_handle = null_handle;
+  options.auto_affinity = pinned;
+  Target t;
+  uint64_t begin = NowMicros();
+  ResultCode rc = c.Spawn(g_exe_path, &t, &options);
+  if (rc != WINC_OK)
+    Fail("Spawn", rc);
+  rc = t.Start();
+  if (rc != WINC_OK)
+    Fail("Start", rc);
+  rc = t.WaitForProcess();
+  if (rc != WINC_OK)
+    Fail("Wait", rc);
+  uint64_t end = NowMicros();
+
+  ULONG64 job_time, cycles;
+  rc = t.GetJobTime(&job_time);
+  if (rc != WINC_OK)
+    Fail("Job time", rc);
+  rc = t.GetProcessCycle(&cycles);
+  if (rc != WINC_OK)
+    Fail("Process cycle", rc);
+  DWORD exit_code;
+  rc = t.GetProcessExitCode(&exit_code);
+  if (rc != WINC_OK || exit_code != 0)
+    Fail("Exit code", rc);
+  // The job time is in 100 nanoseconds
+  Sample sample = {job_time / 10.0, static_cast<double>(cycles),
+                   static_cast<double>(end - begin)};
+  return sample;
+}
+
+void ParseOptions(int argc, char **argv, Options *options) {
+  SYSTEM_INFO si;
+  ::GetSystemInfo(&si);
+  options->runs = 20;
+  options->warmup = 2;
+  options->load_threads = si.dwNumberOfProcessors;
+  options->threshold = 2.0;
+  options->report = DefaultReportOptions();
+  for (int i = 1; i < argc; ++i) {
+    if (ParseReportOption(argc, argv, &i, &options->report))
+      continue;
+    if (i + 1 < argc && !strcmp(argv[i], "--runs")) {
+      options->runs = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--warmup")) {
+      options->warmup = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--load-threads")) {
+      options->load_threads = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--threshold")) {
+      options->threshold = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+  if (options->runs < 2) {
+    fprintf(stderr, "At least two runs are required\n");
+    exit(1);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  ParseOptions(argc, argv, &options);
+
+  ::GetModuleFileNameW(NULL, g_exe_path, MAX_PATH);
+  wchar_t *slash = g_exe_path + wcslen(g_exe_path);
+  while (*--slash != L'\\');
+  *++slash = L'\0';
+  wcscat_s(g_exe_path, L"payload_isort.exe");
+
+  // The payload prints its own measurements, which are not needed here
+  SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+  HANDLE null_handle = ::CreateFileW(L"NUL", GENERIC_WRITE,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                     &sa, OPEN_EXISTING, 0, NULL);
+  if (null_handle == INVALID_HANDLE_VALUE)
+    Fail("Open NUL", WINC_ERROR_UTIL);
+  unique_handle null_holder(null_handle);
+
+  Container c;
+  vector<Metric> metrics;
+  bool flagged = false;
+  for (const Configuration &config : configurations) {
+    vector<unique_handle> load_threads;
+    if (config.load) {
+      g_stop_load = 0;
+      for (unsigned int i = 0; i < options.load_threads; ++i) {
+        HANDLE thread = ::CreateThread(NULL, 0, LoadThread, NULL, 0, NULL);
+        if (!thread)
+          Fail("Thread", WINC_ERROR_UTIL);
+        load_threads.emplace_back(thread);
+      }
+    }
+
+    vector<double> job_times, cycles, wall_times;
+    for (unsigned int i = 0; i < options.warmup + options.runs; ++i) {
+      Sample sample = RunOnce(c, null_handle, config.pinned);
+      if (i < options.warmup)
+        continue;
+      job_times.push_back(sample.job_time);
+      cycles.push_back(sample.cycles);
+      wall_times.push_back(sample.wall_time);
+    }
+
+    if (config.load) {
+      ::InterlockedExchange(&g_stop_load, 1);
+      for (unique_handle &thread : load_threads)
+        ::WaitForSingleObject(thread.get(), INFINITE);
+    }
+
+    struct {
+      const char *measure;
+      const char *unit;
+      Stats stats;
+    } results[] = {
+      {"job_time", "us", ComputeStats(job_times)},
+      {"process_cycle", "cycles", ComputeStats(cycles)},
+      {"wall_time", "us", ComputeStats(wall_times)},
+    };
+    for (const auto &result : results) {
+      bool unstable = result.stats.cv > options.threshold;
+      flagged = flagged || unstable;
+      fprintf(stderr, "%-14s %-14s mean %14.0f %-6s  cv %6.2f%%%s\n",
+              config.name, result.measure, result.stats.mean, result.unit,
+              result.stats.cv, unstable ? "  UNSTABLE" : "");
+      char name[64];
+      sprintf_s(name, "%s_%s_cv", config.name, result.measure);
+      metrics.push_back(ValueMetric(name, "%", options.runs,
+                                    result.stats.cv));
+      sprintf_s(name, "%s_%s_mean", config.name, result.measure);
+      metrics.push_back(ValueMetric(name, result.unit, options.runs,
+                                    result.stats.mean));
+    }
+  }
+
+  int exit_code = FinishReport("isort", metrics, options.report);
+  if (!exit_code && flagged) {
+    fprintf(stderr, "Variation exceeds %.2f%% in some configurations\n",
+            options.threshold);
+    exit_code = 3;
+  }
+  return exit_code;
+}
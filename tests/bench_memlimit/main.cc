@@ -0,0 +1,298 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Memory limit benchmark on payload_memalloc. For every allocation pattern
+// the payload runs under the memory limit until an allocation fails, and
+// the target is killed as soon as OnMemoryLimit is delivered. Measures
+//   notify    from the failed allocation to OnMemoryLimit
+//   kill      from OnMemoryLimit to the exit of all processes
+//   overshoot of GetJobPeakMemory over the limit
+//
+// usage: bench_memlimit [--runs N] [--warmup N] [--limit MB] [--rate MB/S]
+//                       [--active-process-limit N] [--timeout MS]
+//                       [--json PATH] [--compare BASELINE]
+//                       [--tolerance PERCENT]
+
+#include <Windows.h>
+#include <cinttypes>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <winc.h>
+#include "tests/bench_common/clock.h"
+#include "tests/bench_common/histogram.h"
+#include "tests/bench_common/report.h"
+
+using namespace winc;
+using namespace winc::bench;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct Options {
+  unsigned int runs;
+  unsigned int warmup;
+  uintptr_t limit;
+  unsigned int rate;
+  uint32_t active_process_limit;
+  DWORD timeout_ms;
+  ReportOptions report;
+};
+
+const char *patterns[] = {"touch", "large", "small", "spawn"};
+
+class BenchTarget : public Target {
+public:
+  BenchTarget()
+    : exit_all_event_(NULL), memory_limit_time_(0), exit_all_time_(0)
+    {}
+
+  virtual ~BenchTarget() override {
+    StopListening();
+    if (exit_all_event_)
+      ::CloseHandle(exit_all_event_);
+  }
+
+  ResultCode Init() {
+    HANDLE e = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!e)
+      return WINC_ERROR_TARGET;
+    exit_all_event_ = e;
+    return WINC_OK;
+  }
+
+  ResultCode Wait(DWORD timeout_ms, bool *timeouted) {
+    DWORD result = ::WaitForSingleObject(exit_all_event_, timeout_ms);
+    if (result == WAIT_FAILED)
+      return WINC_ERROR_TARGET;
+    *timeouted = result == WAIT_TIMEOUT;
+    return WINC_OK;
+  }
+
+  uint64_t memory_limit_time() {
+    return memory_limit_time_;
+  }
+
+  uint64_t exit_all_time() {
+    return exit_all_time_;
+  }
+
+protected:
+  virtual void OnExitAll() override {
+    exit_all_time_ = NowMicros();
+    ::SetEvent(exit_all_event_);
+  }
+
+  // Only the first notification is timed, the job keeps refusing
+  // allocations until it is terminated
+  virtual void OnMemoryLimit(DWORD process_id) override {
+    if (memory_limit_time_)
+      return;
+    memory_limit_time_ = NowMicros();
+    TerminateJob(1);
+  }
+
+private:
+  HANDLE exit_all_event_;
+  uint64_t volatile memory_limit_time_;
+  uint64_t volatile exit_all_time_;
+};
+
+void Fail(const char *what, ResultCode rc) {
+  fprintf(stderr, "%s error %d\n", what, rc);
+  exit(1);
+}
+
+wchar_t g_exe_path[MAX_PATH];
+
+bool ReadAll(HANDLE file, string *out) {
+  char buffer[256];
+  for (;;) {
+    DWORD read;
+    if (!::ReadFile(file, buffer, sizeof(buffer), &read, NULL))
+      return ::GetLastError() == ERROR_BROKEN_PIPE;
+    if (!read)
+      return true;
+    out->append(buffer, read);
+  }
+}
+
+// Returns the earliest failure time reported by the payload processes, or
+// zero if none is reported
+uint64_t ParseFailureTime(const string &output) {
+  uint64_t earliest = 0;
+  const char *p = output.c_str();
+  while ((p = strstr(p, "limit ")) != NULL) {
+    p += 6;
+    uint64_t time = strtoull(p, NULL, 10);
+    if (time && (!earliest || time < earliest))
+      earliest = time;
+  }
+  return earliest;
+}
+
+struct Sample {
+  uint64_t notify_us;
+  uint64_t kill_us;
+  int64_t overshoot;
+};
+
+// Returns false if the limit did not fire in time
+bool RunOnce(Container &c, const char *pattern, const Options &options,
+             Sample *sample) {
+  SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+  HANDLE read_handle, write_handle;
+  if (!::CreatePipe(&read_handle, &write_handle, &sa, 0))
+    Fail("Pipe", WINC_ERROR_UTIL);
+  unique_handle stdout_read(read_handle), stdout_write(write_handle);
+  if (!::SetHandleInformation(read_handle, HANDLE_FLAG_INHERIT, 0))
+    Fail("Pipe", WINC_ERROR_UTIL);
+
+  wchar_t command_line[64];
+  swprintf_s(command_line, L"payload_memalloc.exe %S %u",
+             pattern, options.rate);
+  SpawnOptions spawn_options = {};
+  spawn_options.command_line = command_line;
+  spawn_options.memory_limit = options.limit;
+  spawn_options.active_process_limit = options.active_process_limit;
+  spawn_options.stdout_handle = write_handle;
+  BenchTarget t;
+  ResultCode rc = t.Init();
+  if (rc != WINC_OK)
+    Fail("Target", rc);
+  rc = c.Spawn(g_exe_path, &t, &spawn_options);
+  if (rc != WINC_OK)
+    Fail("Spawn", rc);
+  stdout_write.reset();
+  rc = t.Start(true);
+  if (rc != WINC_OK)
+    Fail("Start", rc);
+
+  bool timeouted;
+  rc = t.Wait(options.timeout_ms, &timeouted);
+  if (rc != WINC_OK)
+    Fail("Wait", rc);
+  if (timeouted) {
+    t.TerminateJob(1);
+    t.WaitForProcess();
+    return false;
+  }
+  string output;
+  if (!ReadAll(stdout_read.get(), &output))
+    Fail("Read", WINC_ERROR_UTIL);
+  SIZE_T peak_memory;
+  rc = t.GetJobPeakMemory(&peak_memory);
+  if (rc != WINC_OK)
+    Fail("Peak memory", rc);
+
+  uint64_t failure_time = ParseFailureTime(output);
+  uint64_t memory_limit_time = t.memory_limit_time();
+  if (!failure_time || !memory_limit_time)
+    return false;
+  // The notification may overtake the write of the payload
+  sample->notify_us = memory_limit_time > failure_time ?
+      memory_limit_time - failure_time : 0;
+  sample->kill_us = t.exit_all_time() - memory_limit_time;
+  sample->overshoot = static_cast<int64_t>(peak_memory) -
+      static_cast<int64_t>(options.limit);
+  return true;
+}
+
+void ParseOptions(int argc, char **argv, Options *options) {
+  options->runs = 20;
+  options->warmup = 2;
+  options->limit = 64 * 1024 * 1024;
+  options->rate = 0;
+  options->active_process_limit = 8;
+  options->timeout_ms = 30000;
+  options->report = DefaultReportOptions();
+  for (int i = 1; i < argc; ++i) {
+    if (ParseReportOption(argc, argv, &i, &options->report))
+      continue;
+    if (i + 1 < argc && !strcmp(argv[i], "--runs")) {
+      options->runs = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--warmup")) {
+      options->warmup = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--limit")) {
+      options->limit = static_cast<uintptr_t>(atoi(argv[++i])) * 1024 * 1024;
+    } else if (i + 1 < argc && !strcmp(argv[i], "--rate")) {
+      options->rate = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--active-process-limit")) {
+      options->active_process_limit = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--timeout")) {
+      options->timeout_ms = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+  if (!options->runs || !options->limit) {
+    fprintf(stderr, "Runs and limit must be positive\n");
+    exit(1);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  ParseOptions(argc, argv, &options);
+
+  ::GetModuleFileNameW(NULL, g_exe_path, MAX_PATH);
+  wchar_t *slash = g_exe_path + wcslen(g_exe_path);
+  while (*--slash != L'\\');
+  *++slash = L'\0';
+  wcscat_s(g_exe_path, L"payload_memalloc.exe");
+
+  Container c;
+  vector<Metric> metrics;
+  for (const char *pattern : patterns) {
+    Histogram notify, kill, overshoot;
+    int64_t min_overshoot = INT64_MAX, max_overshoot = INT64_MIN;
+    unsigned int missed = 0;
+    for (unsigned int i = 0; i < options.warmup + options.runs; ++i) {
+      Sample sample;
+      if (!RunOnce(c, pattern, options, &sample)) {
+        ++missed;
+        continue;
+      }
+      if (i < options.warmup)
+        continue;
+      notify.Record(sample.notify_us);
+      kill.Record(sample.kill_us);
+      // The histogram holds the overshoot in kilobytes, a peak below the
+      // limit counts as none
+      overshoot.Record(sample.overshoot > 0 ? sample.overshoot / 1024 : 0);
+      if (sample.overshoot < min_overshoot)
+        min_overshoot = sample.overshoot;
+      if (sample.overshoot > max_overshoot)
+        max_overshoot = sample.overshoot;
+    }
+    if (!notify.count()) {
+      fprintf(stderr, "%-6s the limit never fired\n", pattern);
+      continue;
+    }
+
+    char name[64];
+    sprintf_s(name, "%s_notify", pattern);
+    metrics.push_back(LatencyMetric(name, "us", notify));
+    sprintf_s(name, "%s_kill", pattern);
+    metrics.push_back(LatencyMetric(name, "us", kill));
+    sprintf_s(name, "%s_overshoot", pattern);
+    metrics.push_back(LatencyMetric(name, "KB", overshoot));
+
+    fprintf(stderr, "%-6s notify p50 %6" PRIu64 " p99 %6" PRIu64 " us  "
+                    "kill p50 %6" PRIu64 " p99 %6" PRIu64 " us  "
+                    "peak - limit %+" PRId64 " .. %+" PRId64 " KB  "
+                    "missed %u\n",
+            pattern, notify.Percentile(50.0), notify.Percentile(99.0),
+            kill.Percentile(50.0), kill.Percentile(99.0),
+            min_overshoot / 1024, max_overshoot / 1024, missed);
+  }
+  return FinishReport("memlimit", metrics, options.report);
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Overhead of the library itself, measured on the fake platform so that no
+// operating system cost is included. Measures Container::Spawn with
+// Target::Start, and the event path from a process exit to OnExitAll.
+//
+// usage: bench_overhead [--iterations N] [--warmup N] [--json PATH]
+//                       [--compare BASELINE] [--tolerance PERCENT]
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <winc.h>
+#include "core/fake_platform.h"
+#include "tests/bench_common/clock.h"
+#include "tests/bench_common/histogram.h"
+#include "tests/bench_common/report.h"
+
+using namespace winc;
+using namespace winc::bench;
+using std::vector;
+
+namespace {
+
+struct Options {
+  unsigned int iterations;
+  unsigned int warmup;
+  ReportOptions report;
+};
+
+class BenchTarget : public Target {
+public:
+  BenchTarget()
+    : exit_all_time_(0)
+    {}
+
+  uint64_t exit_all_time() {
+    return exit_all_time_;
+  }
+
+protected:
+  virtual void OnExitAll() override {
+    exit_all_time_ = NowMicros();
+  }
+
+private:
+  uint64_t volatile exit_all_time_;
+};
+
+void Fail(const char *what, ResultCode rc) {
+  fprintf(stderr, "%s error %d\n", what, rc);
+  exit(1);
+}
+
+void ParseOptions(int argc, char **argv, Options *options) {
+  options->iterations = 100000;
+  options->warmup = 1000;
+  options->report = DefaultReportOptions();
+  for (int i = 1; i < argc; ++i) {
+    if (ParseReportOption(argc, argv, &i, &options->report))
+      continue;
+    if (i + 1 < argc && !strcmp(argv[i], "--iterations")) {
+      options->iterations = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--warmup")) {
+      options->warmup = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+  if (!options->iterations) {
+    fprintf(stderr, "Iterations must be positive\n");
+    exit(1);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  ParseOptions(argc, argv, &options);
+
+  // The event dispatcher uses the platform until the process exits
+  FakePlatform &fake = *new FakePlatform;
+  Platform::Set(&fake);
+  vector<Metric> metrics;
+  {
+    Container c;
+    SpawnOptions spawn_options = {};
+    spawn_options.memory_limit = 64 * 1024 * 1024;
+    Histogram spawn, exit_event;
+    for (unsigned int i = 0; i < options.warmup + options.iterations; ++i) {
+      BenchTarget t;
+      uint64_t begin = NowMicros();
+      ResultCode rc = c.Spawn(L"fake.exe", &t, &spawn_options);
+      if (rc != WINC_OK)
+        Fail("Spawn", rc);
+      rc = t.Start(true);
+      if (rc != WINC_OK)
+        Fail("Start", rc);
+      uint64_t started = NowMicros();
+      fake.SimulateExit(t.process_id(), 0);
+      while (!t.exit_all_time());
+      if (i >= options.warmup) {
+        spawn.Record(started - begin);
+        exit_event.Record(t.exit_all_time() - started);
+      }
+    }
+    metrics.push_back(LatencyMetric("spawn_start", "us", spawn));
+    metrics.push_back(LatencyMetric("exit_to_exit_all", "us", exit_event));
+  }
+
+  for (const Metric &m : metrics)
+    fprintf(stderr, "%-20s p50 %6.0f  p90 %6.0f  p99 %6.0f  max %6.0f %s\n",
+            m.name.c_str(), m.p50, m.p90, m.p99, m.max, m.unit.c_str());
+  return FinishReport("overhead", metrics, options.report);
+}
@@ -0,0 +1,307 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Spawn benchmark on payload_aplusb. Measures the spawn-to-start and
+// start-to-exit latency, the round trip through stdin and stdout, and the
+// spawn throughput from 1 to N threads.
+//
+// usage: bench_spawn [--iterations N] [--warmup N] [--threads N]
+//                    [--duration MS] [--json PATH] [--compare BASELINE]
+//                    [--tolerance PERCENT]
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <winc.h>
+#include "tests/bench_common/clock.h"
+#include "tests/bench_common/histogram.h"
+#include "tests/bench_common/report.h"
+
+using namespace winc;
+using namespace winc::bench;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct Options {
+  unsigned int iterations;
+  unsigned int warmup;
+  unsigned int threads;
+  DWORD duration_ms;
+  ReportOptions report;
+};
+
+wchar_t g_exe_path[MAX_PATH];
+
+// Standard I/O pipes of one run, the child ends are inheritable
+struct Pipes {
+  unique_handle stdin_read;
+  unique_handle stdin_write;
+  unique_handle stdout_read;
+  unique_handle stdout_write;
+
+  bool Init() {
+    SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+    HANDLE read_handle, write_handle;
+    if (!::CreatePipe(&read_handle, &write_handle, &sa, 0))
+      return false;
+    stdin_read.reset(read_handle);
+    stdin_write.reset(write_handle);
+    if (!::CreatePipe(&read_handle, &write_handle, &sa, 0))
+      return false;
+    stdout_read.reset(read_handle);
+    stdout_write.reset(write_handle);
+    return ::SetHandleInformation(stdin_write.get(), HANDLE_FLAG_INHERIT, 0) &&
+           ::SetHandleInformation(stdout_read.get(), HANDLE_FLAG_INHERIT, 0);
+  }
+};
+
+bool WriteAll(HANDLE file, const char *data, DWORD size) {
+  while (size) {
+    DWORD written;
+    if (!::WriteFile(file, data, size, &written, NULL))
+      return false;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+bool ReadAll(HANDLE file, string *out) {
+  char buffer[64];
+  for (;;) {
+    DWORD read;
+    if (!::ReadFile(file, buffer, sizeof(buffer), &read, NULL))
+      return ::GetLastError() == ERROR_BROKEN_PIPE;
+    if (!read)
+      return true;
+    out->append(buffer, read);
+  }
+}
+
+void Fail(const char *what, ResultCode rc) {
+  fprintf(stderr, "%s error %d\n", what, rc);
+  exit(1);
+}
+
+// Spawns with the input already in the pipe, so that the payload runs
+// without waiting for the benchmark
+void RunPrefilled(Container &c, uint64_t *spawn_to_start,
+                  uint64_t *start_to_exit) {
+  Pipes pipes;
+  if (!pipes.Init())
+    Fail("Pipe", WINC_ERROR_UTIL);
+  if (!WriteAll(pipes.stdin_write.get(), "1 2\n", 4))
+    Fail("Write", WINC_ERROR_UTIL);
+  pipes.stdin_write.reset();
+
+  SpawnOptions options = {};
+  options.stdin_handle = pipes.stdin_read.get();
+  options.stdout_handle = pipes.stdout_write.get();
+  Target t;
+  uint64_t begin = NowMicros();
+  ResultCode rc = c.Spawn(g_exe_path, &t, &options);
+  if (rc != WINC_OK)
+    Fail("Spawn", rc);
+  rc = t.Start();
+  if (rc != WINC_OK)
+    Fail("Start", rc);
+  uint64_t started = NowMicros();
+  rc = t.WaitForProcess();
+  if (rc != WINC_OK)
+    Fail("Wait", rc);
+  uint64_t exited = NowMicros();
+  *spawn_to_start = started - begin;
+  *start_to_exit = exited - started;
+}
+
+// Feeds the input after the start and waits for the answer
+uint64_t RunRoundTrip(Container &c, int a, int b) {
+  uint64_t begin = NowMicros();
+  Pipes pipes;
+  if (!pipes.Init())
+    Fail("Pipe", WINC_ERROR_UTIL);
+  SpawnOptions options = {};
+  options.stdin_handle = pipes.stdin_read.get();
+  options.stdout_handle = pipes.stdout_write.get();
+  Target t;
+  ResultCode rc = c.Spawn(g_exe_path, &t, &options);
+  if (rc != WINC_OK)
+    Fail("Spawn", rc);
+  pipes.stdin_read.reset();
+  pipes.stdout_write.reset();
+  rc = t.Start();
+  if (rc != WINC_OK)
+    Fail("Start", rc);
+  char input[32];
+  int length = sprintf_s(input, "%d %d\n", a, b);
+  if (!WriteAll(pipes.stdin_write.get(), input, length))
+    Fail("Write", WINC_ERROR_UTIL);
+  pipes.stdin_write.reset();
+  string output;
+  if (!ReadAll(pipes.stdout_read.get(), &output))
+    Fail("Read", WINC_ERROR_UTIL);
+  rc = t.WaitForProcess();
+  if (rc != WINC_OK)
+    Fail("Wait", rc);
+  uint64_t end = NowMicros();
+  if (atoi(output.c_str()) != a + b) {
+    fprintf(stderr, "Math error!\n");
+    exit(1);
+  }
+  return end - begin;
+}
+
+struct ThroughputWorker {
+  DWORD duration_ms;
+  LONG volatile *ready;
+  HANDLE go;
+  unsigned int spawned;
+};
+
+DWORD WINAPI ThroughputThread(PVOID param) {
+  ThroughputWorker *worker = reinterpret_cast<ThroughputWorker *>(param);
+  // A container per thread, as the spawns of a container are serialized
+  Container c;
+  uint64_t spawn_to_start, start_to_exit;
+  RunPrefilled(c, &spawn_to_start, &start_to_exit);
+  ::InterlockedIncrement(worker->ready);
+  ::WaitForSingleObject(worker->go, INFINITE);
+  uint64_t end = NowMicros() + worker->duration_ms * 1000ull;
+  while (NowMicros() < end) {
+    RunPrefilled(c, &spawn_to_start, &start_to_exit);
+    ++worker->spawned;
+  }
+  return 0;
+}
+
+double MeasureThroughput(unsigned int thread_count, DWORD duration_ms,
+                         uint64_t *out_spawned) {
+  LONG volatile ready = 0;
+  HANDLE go = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+  if (!go)
+    Fail("Event", WINC_ERROR_UTIL);
+  unique_handle go_holder(go);
+  vector<ThroughputWorker> workers(thread_count);
+  vector<unique_handle> threads;
+  for (ThroughputWorker &worker : workers) {
+    worker.duration_ms = duration_ms;
+    worker.ready = &ready;
+    worker.go = go;
+    worker.spawned = 0;
+    HANDLE thread = ::CreateThread(NULL, 0, ThroughputThread, &worker,
+                                   0, NULL);
+    if (!thread)
+      Fail("Thread", WINC_ERROR_UTIL);
+    threads.emplace_back(thread);
+  }
+  while (static_cast<unsigned int>(ready) < thread_count)
+    ::Sleep(1);
+  uint64_t begin = NowMicros();
+  ::SetEvent(go);
+  for (unique_handle &thread : threads)
+    ::WaitForSingleObject(thread.get(), INFINITE);
+  uint64_t elapsed = NowMicros() - begin;
+  uint64_t spawned = 0;
+  for (const ThroughputWorker &worker : workers)
+    spawned += worker.spawned;
+  *out_spawned = spawned;
+  return spawned * 1000000.0 / elapsed;
+}
+
+void ParseOptions(int argc, char **argv, Options *options) {
+  SYSTEM_INFO si;
+  ::GetSystemInfo(&si);
+  options->iterations = 500;
+  options->warmup = 20;
+  options->threads = si.dwNumberOfProcessors;
+  options->duration_ms = 2000;
+  options->report = DefaultReportOptions();
+  for (int i = 1; i < argc; ++i) {
+    if (ParseReportOption(argc, argv, &i, &options->report))
+      continue;
+    if (i + 1 < argc && !strcmp(argv[i], "--iterations")) {
+      options->iterations = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--warmup")) {
+      options->warmup = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--threads")) {
+      options->threads = atoi(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "--duration")) {
+      options->duration_ms = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+  if (!options->iterations || !options->threads) {
+    fprintf(stderr, "Iterations and threads must be positive\n");
+    exit(1);
+  }
+}
+
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  ParseOptions(argc, argv, &options);
+
+  ::GetModuleFileNameW(NULL, g_exe_path, MAX_PATH);
+  wchar_t *slash = g_exe_path + wcslen(g_exe_path);
+  while (*--slash != L'\\');
+  *++slash = L'\0';
+  wcscat_s(g_exe_path, L"payload_aplusb.exe");
+
+  Container c;
+  vector<Metric> metrics;
+
+  // The warmup runs are discarded, they pay for the lazy initialization
+  // of the policy and warm the file cache
+  Histogram spawn_to_start, start_to_exit;
+  for (unsigned int i = 0; i < options.warmup + options.iterations; ++i) {
+    uint64_t spawn_us, exit_us;
+    RunPrefilled(c, &spawn_us, &exit_us);
+    if (i >= options.warmup) {
+      spawn_to_start.Record(spawn_us);
+      start_to_exit.Record(exit_us);
+    }
+  }
+  metrics.push_back(LatencyMetric("spawn_to_start", "us", spawn_to_start));
+  metrics.push_back(LatencyMetric("start_to_exit", "us", start_to_exit));
+
+  Histogram round_trip;
+  for (unsigned int i = 0; i < options.warmup + options.iterations; ++i) {
+    uint64_t us = RunRoundTrip(c, rand(), rand());
+    if (i >= options.warmup)
+      round_trip.Record(us);
+  }
+  metrics.push_back(LatencyMetric("round_trip", "us", round_trip));
+
+  for (unsigned int threads = 1; ; threads *= 2) {
+    if (threads > options.threads)
+      threads = options.threads;
+    uint64_t spawned;
+    double rate = MeasureThroughput(threads, options.duration_ms, &spawned);
+    char name[64];
+    sprintf_s(name, "throughput_%u_threads", threads);
+    metrics.push_back(ThroughputMetric(name, "spawn/s", spawned, rate));
+    if (threads == options.threads)
+      break;
+  }
+
+  for (const Metric &m : metrics) {
+    if (m.higher_is_better)
+      fprintf(stderr, "%-24s %10.1f %s\n", m.name.c_str(), m.value,
+              m.unit.c_str());
+    else
+      fprintf(stderr, "%-24s p50 %8.0f  p90 %8.0f  p99 %8.0f  max %8.0f %s\n",
+              m.name.c_str(), m.p50, m.p90, m.p99, m.max, m.unit.c_str());
+  }
+  return FinishReport("spawn", metrics, options.report);
+}
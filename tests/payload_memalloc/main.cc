@@ -0,0 +1,138 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This program allocates memory until an allocation fails, at the given
+// rate in megabytes per second or as fast as possible if the rate is zero.
+// The time of the first failure is written to stdout in microseconds of
+// the performance counter, and then the program waits to be killed.
+//
+// usage: payload_memalloc touch|large|small|spawn [rate]
+//
+//   touch  commits and touches one page at a time
+//   large  mallocs and touches blocks of 1 MB
+//   small  mallocs and touches blocks of 64 bytes
+//   spawn  starts copies of itself in touch mode until the active process
+//          limit is reached, and then allocates in touch mode as well
+
+#include <Windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+unsigned long long NowMicros() {
+  LARGE_INTEGER frequency, counter;
+  ::QueryPerformanceFrequency(&frequency);
+  ::QueryPerformanceCounter(&counter);
+  return counter.QuadPart / frequency.QuadPart * 1000000 +
+      counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+
+// Allocation may be impossible by now, so the stack buffer and WriteFile
+// are used instead of printf
+void ReportFailure() {
+  char line[64];
+  int length = sprintf_s(line, "limit %llu\n", NowMicros());
+  DWORD written;
+  ::WriteFile(::GetStdHandle(STD_OUTPUT_HANDLE), line, length, &written, NULL);
+  ::Sleep(INFINITE);
+}
+
+class Pacer {
+public:
+  explicit Pacer(unsigned int rate)
+    : rate_(rate), begin_(NowMicros()), allocated_(0)
+    {}
+
+  // Sleeps until the given amount of bytes is due
+  void Allocated(size_t size) {
+    allocated_ += size;
+    if (!rate_)
+      return;
+    unsigned long long due = begin_ + allocated_ / rate_;
+    unsigned long long now = NowMicros();
+    if (due > now + 1000)
+      ::Sleep(static_cast<DWORD>((due - now) / 1000));
+  }
+
+private:
+  // Bytes per microsecond equals megabytes per second
+  unsigned long long rate_;
+  unsigned long long begin_;
+  unsigned long long allocated_;
+};
+
+void Touch(unsigned int rate) {
+  SYSTEM_INFO si;
+  ::GetSystemInfo(&si);
+  Pacer pacer(rate);
+  for (;;) {
+    // Reserve in large regions, so that the commit is the only thing that
+    // can fail in the loop below
+    const size_t REGION = 256 * 1024 * 1024;
+    char *region = reinterpret_cast<char *>(
+        ::VirtualAlloc(NULL, REGION, MEM_RESERVE, PAGE_NOACCESS));
+    if (!region)
+      ReportFailure();
+    for (size_t offset = 0; offset < REGION; offset += si.dwPageSize) {
+      char *page = reinterpret_cast<char *>(::VirtualAlloc(
+          region + offset, si.dwPageSize, MEM_COMMIT, PAGE_READWRITE));
+      if (!page)
+        ReportFailure();
+      *page = 1;
+      pacer.Allocated(si.dwPageSize);
+    }
+  }
+}
+
+void Malloc(size_t size, unsigned int rate) {
+  Pacer pacer(rate);
+  for (;;) {
+    char *block = reinterpret_cast<char *>(malloc(size));
+    if (!block)
+      ReportFailure();
+    memset(block, 1, size);
+    pacer.Allocated(size);
+  }
+}
+
+void Spawn(unsigned int rate) {
+  wchar_t exe_path[MAX_PATH];
+  ::GetModuleFileNameW(NULL, exe_path, MAX_PATH);
+  wchar_t command_line[MAX_PATH + 32];
+  swprintf_s(command_line, L"\"%s\" touch %u", exe_path, rate);
+  STARTUPINFOW si = {sizeof(si)};
+  si.dwFlags = STARTF_USESTDHANDLES;
+  si.hStdInput = ::GetStdHandle(STD_INPUT_HANDLE);
+  si.hStdOutput = ::GetStdHandle(STD_OUTPUT_HANDLE);
+  si.hStdError = ::GetStdHandle(STD_ERROR_HANDLE);
+  // The job refuses new processes beyond the active process limit
+  for (int i = 0; i < 64; ++i) {
+    PROCESS_INFORMATION pi;
+    if (!::CreateProcessW(exe_path, command_line, NULL, NULL, TRUE, 0,
+                          NULL, NULL, &si, &pi))
+      break;
+    ::CloseHandle(pi.hThread);
+    ::CloseHandle(pi.hProcess);
+  }
+  Touch(rate);
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2)
+    return 1;
+  unsigned int rate = argc > 2 ? atoi(argv[2]) : 0;
+  if (!strcmp(argv[1], "touch"))
+    Touch(rate);
+  else if (!strcmp(argv[1], "large"))
+    Malloc(1024 * 1024, rate);
+  else if (!strcmp(argv[1], "small"))
+    Malloc(64, rate);
+  else if (!strcmp(argv[1], "spawn"))
+    Spawn(rate);
+  return 1;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This program issues N cheap system calls of each kind, so that the cost of
+// the system call path under different mitigation policies can be compared.
+
+#include <Windows.h>
+#include <cinttypes>
+#include <cstdio>
+
+const int N = 1000000;
+
+int main() {
+  LARGE_INTEGER frequency, start, end;
+  ::QueryPerformanceFrequency(&frequency);
+  ::QueryPerformanceCounter(&start);
+  for (int i = 0; i < N; ++i) {
+    // NtYieldExecution
+    ::SwitchToThread();
+  }
+  for (int i = 0; i < N; ++i) {
+    // NtQueryInformationProcess
+    ULONG64 creation_time, exit_time, kernel_time, user_time;
+    ::GetProcessTimes(::GetCurrentProcess(),
+                      reinterpret_cast<LPFILETIME>(&creation_time),
+                      reinterpret_cast<LPFILETIME>(&exit_time),
+                      reinterpret_cast<LPFILETIME>(&kernel_time),
+                      reinterpret_cast<LPFILETIME>(&user_time));
+  }
+  ::QueryPerformanceCounter(&end);
+  printf("Time = %" PRIu64 " us\n",
+         static_cast<uint64_t>((end.QuadPart - start.QuadPart) * 1000000 /
+                               frequency.QuadPart));
+}
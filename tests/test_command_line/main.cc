@@ -0,0 +1,170 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Round trips random argument lists through CommandLineBuilder and a
+// reference parser of the CommandLineToArgvW rules. Nothing here depends on
+// the Windows API, so the test also builds on Linux together with
+// core/command_line.cc alone.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <winc/command_line.h>
+
+using namespace winc;
+using std::mt19937;
+using std::uniform_int_distribution;
+using std::vector;
+using std::wstring;
+
+namespace {
+
+const unsigned int kIterations = 100000;
+
+void Check(bool condition, const char *message) {
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", message);
+    exit(1);
+  }
+}
+
+bool IsSpace(wchar_t c) {
+  return c == L' ' || c == L'\t';
+}
+
+// Splits a command line as CommandLineToArgvW does
+vector<wstring> ParseCommandLine(const wchar_t *p) {
+  vector<wstring> args;
+  // The program name has no escapes
+  wstring name;
+  if (*p == L'"') {
+    for (++p; *p && *p != L'"'; ++p)
+      name += *p;
+    if (*p)
+      ++p;
+  } else {
+    for (; *p && !IsSpace(*p); ++p)
+      name += *p;
+  }
+  args.push_back(name);
+
+  for (;;) {
+    while (IsSpace(*p))
+      ++p;
+    if (!*p)
+      break;
+    wstring arg;
+    bool quoted = false;
+    while (*p && (quoted || !IsSpace(*p))) {
+      size_t backslashes = 0;
+      for (; *p == L'\\'; ++p)
+        ++backslashes;
+      if (*p == L'"') {
+        arg.append(backslashes / 2, L'\\');
+        if (backslashes % 2) {
+          arg += L'"';
+          ++p;
+        } else if (quoted && p[1] == L'"') {
+          arg += L'"';
+          p += 2;
+        } else {
+          quoted = !quoted;
+          ++p;
+        }
+      } else {
+        arg.append(backslashes, L'\\');
+        if (*p && (quoted || !IsSpace(*p)))
+          arg += *p++;
+      }
+    }
+    args.push_back(arg);
+  }
+  return args;
+}
+
+void CheckRoundTrip(const vector<wstring> &args) {
+  vector<const wchar_t *> argv;
+  for (const wstring &arg : args)
+    argv.push_back(arg.c_str());
+  size_t size = CommandLineBuilder::ComputeSize(argv.data(), argv.size());
+  // Guard characters catch a write beyond the computed size
+  vector<wchar_t> buffer(size + 1, L'#');
+  size_t written = CommandLineBuilder::Write(argv.data(), argv.size(),
+                                             buffer.data());
+  Check(written + 1 == size, "computed size");
+  Check(buffer[written] == L'\0' && buffer[size] == L'#', "buffer bounds");
+
+  CommandLineBuilder builder;
+  builder.Build(argv.data(), argv.size());
+  Check(builder.size() == written &&
+        !wcscmp(builder.command_line(), buffer.data()),
+        "built command line");
+  if (ParseCommandLine(buffer.data()) != args) {
+    fwprintf(stderr, L"FAILED: round trip of [%ls]\n", buffer.data());
+    exit(1);
+  }
+}
+
+void TestKnownCases() {
+  struct Case {
+    vector<wstring> args;
+    const wchar_t *command_line;
+  };
+  const Case cases[] = {
+    {{L"a.exe"}, L"a.exe"},
+    {{L"C:\\Program Files\\a.exe", L"x"}, L"\"C:\\Program Files\\a.exe\" x"},
+    {{L"a", L""}, L"a \"\""},
+    {{L"a", L"b c"}, L"a \"b c\""},
+    {{L"a", L"say \"hi\""}, L"a \"say \\\"hi\\\"\""},
+    {{L"a", L"C:\\dir\\"}, L"a C:\\dir\\"},
+    {{L"a", L"C:\\my dir\\"}, L"a \"C:\\my dir\\\\\""},
+    {{L"a", L"\\\\\""}, L"a \"\\\\\\\\\\\"\""},
+    {{L"a", L"tab\there"}, L"a \"tab\there\""},
+  };
+  for (const Case &c : cases) {
+    vector<const wchar_t *> argv;
+    for (const wstring &arg : c.args)
+      argv.push_back(arg.c_str());
+    CommandLineBuilder builder;
+    builder.Build(argv.data(), argv.size());
+    Check(!wcscmp(builder.command_line(), c.command_line),
+          "known command line");
+    CheckRoundTrip(c.args);
+  }
+}
+
+void TestRandomCases() {
+  // Rich in the characters which need quoting or escaping
+  const wchar_t kAlphabet[] = L"ab \t\"\\\n\v\x4e2d";
+  const size_t kAlphabetSize = sizeof(kAlphabet) / sizeof(kAlphabet[0]) - 1;
+  mt19937 random(20151);
+  uniform_int_distribution<size_t> arg_count(1, 6);
+  uniform_int_distribution<size_t> arg_size(0, 8);
+  uniform_int_distribution<size_t> arg_char(0, kAlphabetSize - 1);
+  for (unsigned int i = 0; i < kIterations; ++i) {
+    vector<wstring> args(arg_count(random));
+    for (size_t index = 0; index < args.size(); ++index) {
+      for (size_t size = arg_size(random); size; --size) {
+        wchar_t c = kAlphabet[arg_char(random)];
+        // The program name cannot have quotes
+        if (!index && c == L'"')
+          continue;
+        args[index] += c;
+      }
+    }
+    CheckRoundTrip(args);
+  }
+}
+
+}
+
+int main() {
+  TestKnownCases();
+  TestRandomCases();
+  fprintf(stderr, "OK\n");
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Runs a batch of payload_aplusb jobs on the executor and checks that every
+// job completes exactly once.
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <vector>
+
+#include <winc.h>
+
+using namespace winc;
+using std::vector;
+
+namespace {
+
+const int N = 64;
+const unsigned int WORKERS = 4;
+
+}
+
+int main() {
+  wchar_t exe_path[MAX_PATH];
+  ::GetModuleFileNameW(NULL, exe_path, MAX_PATH);
+  wchar_t *slash = exe_path + wcslen(exe_path);
+  while (*--slash != L'\\');
+  *++slash = L'\0';
+  wcscat_s(exe_path, L"payload_aplusb.exe");
+
+  vector<ExecutorJob> jobs(N);
+  for (ExecutorJob &job : jobs) {
+    job.exe_path = exe_path;
+    job.input = "1 2\n";
+    job.memory_limit = 64 * 1024 * 1024;
+    job.time_limit_ms = 5000;
+  }
+  // Far beyond the buffer of the pipe, most of it is never read
+  jobs[0].input.append(16 * 1024 * 1024, ' ');
+
+  Container c;
+  Executor e;
+  LARGE_INTEGER frequency, start, end;
+  ::QueryPerformanceFrequency(&frequency);
+  ::QueryPerformanceCounter(&start);
+  ResultCode rc = e.Init(&c, jobs, WORKERS);
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Init error %d\n", rc);
+    exit(1);
+  }
+
+  vector<bool> completed(N);
+  for (;;) {
+    ExecutorResult result;
+    bool finished;
+    rc = e.Next(&result, &finished);
+    if (rc != WINC_OK) {
+      fprintf(stderr, "Next error %d\n", rc);
+      exit(1);
+    }
+    if (finished)
+      break;
+    if (result.rc != WINC_OK) {
+      fprintf(stderr, "Job %u error %d\n",
+              static_cast<unsigned int>(result.index), result.rc);
+      exit(1);
+    }
+    if (completed[result.index] || result.exit_code != 0 ||
+        result.time_limit_exceeded) {
+      fprintf(stderr, "Job %u completed wrongly\n",
+              static_cast<unsigned int>(result.index));
+      exit(1);
+    }
+    completed[result.index] = true;
+  }
+  ::QueryPerformanceCounter(&end);
+  for (int i = 0; i < N; ++i) {
+    if (!completed[i]) {
+      fprintf(stderr, "Job %d not completed\n", i);
+      exit(1);
+    }
+  }
+  fprintf(stderr, "%d jobs on %u workers in %" PRIu64 " ms\n", N, WORKERS,
+    static_cast<uint64_t>((end.QuadPart - start.QuadPart) * 1000 /
+                          frequency.QuadPart));
+}
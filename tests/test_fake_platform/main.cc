@@ -0,0 +1,502 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Drives the container on the fake platform. Checks the order of the job
+// events, the accounting of a target and of its processes, termination, the
+// fused run, the environment blocks, the memory thresholds, the run queue
+// reservation, the token cache, the policy image and that no handle is
+// leaked, without spawning any real process.
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <memory>
+#include <vector>
+
+#include <winc.h>
+#include "core/fake_platform.h"
+#include "core/token_cache.h"
+
+using namespace winc;
+using std::make_shared;
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+
+const SIZE_T MB = 1024 * 1024;
+
+enum EventType {
+  EVENT_ACTIVE_PROCESS_LIMIT,
+  EVENT_EXIT_ALL,
+  EVENT_NEW_PROCESS,
+  EVENT_EXIT_PROCESS,
+  EVENT_MEMORY_LIMIT,
+  EVENT_MEMORY_THRESHOLD,
+};
+
+struct Event {
+  EventType type;
+  // The level of a memory threshold event
+  DWORD process_id;
+  SIZE_T bytes;
+};
+
+class RecordingTarget : public Target {
+public:
+  RecordingTarget()
+    : exit_all_event_(::CreateEventW(NULL, TRUE, FALSE, NULL)) {
+    ::InitializeCriticalSection(&crit_sec_);
+  }
+
+  virtual ~RecordingTarget() override {
+    StopListening();
+    ::CloseHandle(exit_all_event_);
+    ::DeleteCriticalSection(&crit_sec_);
+  }
+
+  bool WaitForExitAll() {
+    return ::WaitForSingleObject(exit_all_event_, 5000) == WAIT_OBJECT_0;
+  }
+
+  // Waits until the given number of events are delivered
+  bool WaitForEvents(size_t count) {
+    for (int i = 0; i < 5000; ++i) {
+      if (events().size() >= count)
+        return true;
+      ::Sleep(1);
+    }
+    return false;
+  }
+
+  vector<Event> events() {
+    ::EnterCriticalSection(&crit_sec_);
+    vector<Event> events = events_;
+    ::LeaveCriticalSection(&crit_sec_);
+    return events;
+  }
+
+protected:
+  virtual void OnActiveProcessLimit() override {
+    Record(EVENT_ACTIVE_PROCESS_LIMIT, 0);
+  }
+
+  virtual void OnExitAll() override {
+    Record(EVENT_EXIT_ALL, 0);
+    ::SetEvent(exit_all_event_);
+  }
+
+  virtual void OnNewProcess(DWORD process_id) override {
+    Record(EVENT_NEW_PROCESS, process_id);
+  }
+
+  virtual void OnExitProcess(DWORD process_id) override {
+    Record(EVENT_EXIT_PROCESS, process_id);
+  }
+
+  virtual void OnMemoryLimit(DWORD process_id) override {
+    Record(EVENT_MEMORY_LIMIT, process_id);
+  }
+
+  virtual void OnMemoryThreshold(unsigned int level, SIZE_T bytes) override {
+    Record(EVENT_MEMORY_THRESHOLD, level, bytes);
+  }
+
+private:
+  void Record(EventType type, DWORD process_id, SIZE_T bytes = 0) {
+    Event event = {type, process_id, bytes};
+    ::EnterCriticalSection(&crit_sec_);
+    events_.push_back(event);
+    ::LeaveCriticalSection(&crit_sec_);
+  }
+
+private:
+  HANDLE exit_all_event_;
+  CRITICAL_SECTION crit_sec_;
+  vector<Event> events_;
+};
+
+void Check(bool condition, const char *message) {
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", message);
+    exit(1);
+  }
+}
+
+void CheckRc(ResultCode rc, const char *what) {
+  if (rc != WINC_OK) {
+    fprintf(stderr, "%s error %d\n", what, rc);
+    exit(1);
+  }
+}
+
+void TestEventOrder(FakePlatform &fake, Container &c) {
+  RecordingTarget t;
+  SpawnOptions o = {};
+  o.memory_limit = 10 * MB;
+  o.active_process_limit = 2;
+  CheckRc(c.Spawn(L"fake.exe", &t, &o), "Spawn");
+  CheckRc(t.Start(true), "Start");
+  DWORD pid = fake.last_process_id();
+  Check(pid == t.process_id(), "process id of the target");
+
+  DWORD child, refused_child;
+  Check(fake.SimulateRun(pid, 100000, 50000, 12345) != FALSE, "run");
+  Check(fake.SimulateAllocation(pid, 4 * MB) != FALSE, "allocate");
+  Check(fake.SimulateChild(pid, &child) != FALSE, "first child");
+  Check(!fake.SimulateChild(pid, &refused_child),
+        "second child beyond the active process limit");
+  Check(!fake.SimulateAllocation(child, 7 * MB),
+        "allocation beyond the job memory limit");
+  Check(fake.SimulateExit(child, 0) != FALSE, "child exit");
+  Check(fake.SimulateExit(pid, 3) != FALSE, "exit");
+  Check(t.WaitForExitAll(), "exit all delivered");
+
+  const Event expected[] = {
+    {EVENT_NEW_PROCESS, pid},
+    {EVENT_NEW_PROCESS, child},
+    {EVENT_ACTIVE_PROCESS_LIMIT, 0},
+    {EVENT_MEMORY_LIMIT, child},
+    {EVENT_EXIT_PROCESS, child},
+    {EVENT_EXIT_PROCESS, pid},
+    {EVENT_EXIT_ALL, 0},
+  };
+  vector<Event> events = t.events();
+  Check(events.size() == ARRAYSIZE(expected), "number of events");
+  for (size_t i = 0; i < events.size(); ++i) {
+    Check(events[i].type == expected[i].type &&
+          events[i].process_id == expected[i].process_id,
+          "order of events");
+  }
+
+  bool timeouted;
+  CheckRc(t.WaitForProcess(0, &timeouted), "Wait");
+  Check(!timeouted, "process exited");
+  DWORD exit_code;
+  ULONG64 job_time, cycle;
+  SIZE_T peak_memory;
+  DWORD process_count;
+  CheckRc(t.GetProcessExitCode(&exit_code), "Exit code");
+  CheckRc(t.GetJobTime(&job_time), "Job time");
+  CheckRc(t.GetProcessCycle(&cycle), "Process cycle");
+  CheckRc(t.GetJobPeakMemory(&peak_memory), "Peak memory");
+  CheckRc(t.GetJobProcessCount(&process_count), "Process count");
+  Check(exit_code == 3, "exit code");
+  Check(job_time == 150000, "job time");
+  Check(cycle == 12345, "process cycle");
+  Check(peak_memory == 4 * MB, "job peak memory");
+  Check(process_count == 2, "processes of the job");
+}
+
+void TestTerminate(FakePlatform &fake, Container &c) {
+  Target t;
+  CheckRc(c.Spawn(L"fake.exe", &t), "Spawn");
+  CheckRc(t.Start(), "Start");
+  bool timeouted;
+  CheckRc(t.WaitForProcess(10, &timeouted), "Wait");
+  Check(timeouted, "process is running");
+  CheckRc(t.TerminateJob(9), "Terminate");
+  CheckRc(t.WaitForProcess(), "Wait");
+  DWORD exit_code;
+  CheckRc(t.GetProcessExitCode(&exit_code), "Exit code");
+  Check(exit_code == 9, "exit code of the terminated job");
+}
+
+void TestRun(FakePlatform &fake, Container &c) {
+  // Nothing runs in the fake process, so it exceeds any time limit
+  RunLimits limits = {};
+  limits.time_limit_ms = 10;
+  RunResult result;
+  CheckRc(c.Run(L"fake.exe", nullptr, limits, &result), "Run");
+  Check(result.time_limit_exceeded, "time limit exceeded");
+  Check(result.exit_code == 1, "exit code of the terminated job");
+  Check(result.job_time == 0, "job time");
+  Check(!result.stdout_output && !result.stderr_output, "nothing captured");
+
+  // The fake process does not keep the inherited pipe, so the captured
+  // stream ends empty right after the spawn
+  limits.stdout_capture_limit = 1024;
+  CheckRc(c.Run(L"fake.exe", nullptr, limits, &result), "Run with capture");
+  Check(result.stdout_output && !result.stderr_output, "stdout captured");
+  Check(result.stdout_output->size() == 0 &&
+        !result.stdout_output->truncated(), "empty capture");
+}
+
+void TestEnvironment(FakePlatform &fake, Container &c) {
+  Policy *p;
+  CheckRc(c.GetPolicy(&p), "Policy");
+  const wchar_t *variables[] = {L"PATH=C:\\bin", L"b=2", L"A=1", L"a=3"};
+  shared_ptr<const EnvironmentBlock> environment, same_environment;
+  CheckRc(EnvironmentBlock::Compile(variables, ARRAYSIZE(variables),
+                                    &environment), "Compile");
+  CheckRc(EnvironmentBlock::Compile(variables, ARRAYSIZE(variables),
+                                    &same_environment), "Compile again");
+  Check(environment == same_environment, "block shared by content");
+  const wchar_t missing_equal[] = L"A";
+  const wchar_t *invalid[] = {missing_equal};
+  Check(EnvironmentBlock::Compile(invalid, 1, &same_environment) ==
+        WINC_ERROR_ENVIRONMENT, "variable without value");
+
+  // Sorted without regard to case, the later variable wins
+  const wchar_t expected[] = L"a=3\0b=2\0PATH=C:\\bin\0";
+  p->set_environment(environment);
+  Target t;
+  CheckRc(c.Spawn(L"fake.exe", &t), "Spawn");
+  Check(fake.last_environment() ==
+        vector<wchar_t>(expected, expected + ARRAYSIZE(expected)),
+        "environment of the policy");
+
+  const wchar_t *overrides[] = {L"b", L"TMP=C:\\tmp", L"a=4"};
+  const wchar_t merged[] = L"a=4\0PATH=C:\\bin\0TMP=C:\\tmp\0";
+  SpawnOptions o = {};
+  o.environment_overrides = overrides;
+  o.environment_override_count = ARRAYSIZE(overrides);
+  Target merged_target;
+  CheckRc(c.Spawn(L"fake.exe", &merged_target, &o), "Spawn with overrides");
+  Check(fake.last_environment() ==
+        vector<wchar_t>(merged, merged + ARRAYSIZE(merged)),
+        "environment with overrides");
+  p->set_environment(nullptr);
+}
+
+void TestProcessTable(FakePlatform &fake, Container &c) {
+  RecordingTarget t;
+  CheckRc(c.Spawn(L"fake.exe", &t), "Spawn");
+  CheckRc(t.Start(true), "Start");
+  DWORD pid = t.process_id();
+  DWORD child;
+  // The processes are opened when their events are handled
+  Check(t.WaitForEvents(1), "new process");
+  Check(fake.SimulateChild(pid, &child) != FALSE, "child");
+  Check(t.WaitForEvents(2), "new child");
+  Check(fake.SimulateRun(pid, 100, 50, 0) != FALSE, "run");
+  Check(fake.SimulateRun(child, 300, 200, 0) != FALSE, "child run");
+  Check(fake.SimulateAllocation(child, 3 * MB) != FALSE, "child allocate");
+  Check(fake.SimulateExit(child, 7) != FALSE, "child exit");
+  Check(t.WaitForEvents(3), "child exit delivered");
+
+  vector<ProcessRecord> table;
+  CheckRc(t.GetProcessTable(&table), "Process table");
+  Check(table.size() == 2, "processes in the table");
+  Check(table[0].process_id == pid &&
+        table[0].parent_process_id == ::GetCurrentProcessId() &&
+        !table[0].exited && !table[0].lost, "record of the running process");
+  Check(table[0].user_time == 100 && table[0].kernel_time == 50,
+        "current values of the running process");
+  Check(table[1].process_id == child && table[1].parent_process_id == pid &&
+        table[1].exited && table[1].exit_code == 7, "record of the child");
+  Check(table[1].user_time == 300 && table[1].kernel_time == 200 &&
+        table[1].peak_memory == 3 * MB, "accounting of the child");
+  Check(table[1].creation_time > table[0].creation_time &&
+        table[1].exit_time >= table[1].creation_time, "lifetime");
+
+  Check(fake.SimulateExit(pid, 0) != FALSE, "exit");
+  Check(t.WaitForExitAll(), "exit all delivered");
+  CheckRc(t.GetProcessTable(&table), "Process table");
+  Check(table.size() == 2 && table[0].exited && table[0].exit_code == 0,
+        "record of the exited process");
+}
+
+void TestMemoryThresholds(FakePlatform &fake, Container &c) {
+  RecordingTarget t;
+  SpawnOptions o = {};
+  o.memory_limit = 16 * MB;
+  CheckRc(c.Spawn(L"fake.exe", &t, &o), "Spawn");
+  // The levels of a caller asking for 50%, 75% and 90% of the limit
+  const SIZE_T thresholds[] = {8 * MB, 12 * MB, 14 * MB + 4 * MB / 10};
+  const SIZE_T descending[] = {12 * MB, 8 * MB};
+  Check(t.SetMemoryThresholds(descending, ARRAYSIZE(descending)) ==
+        WINC_ERROR_TARGET, "thresholds must ascend");
+  CheckRc(t.SetMemoryThresholds(thresholds, ARRAYSIZE(thresholds)),
+          "Thresholds");
+  CheckRc(t.Start(true), "Start");
+  Check(t.SetMemoryThresholds(thresholds, ARRAYSIZE(thresholds)) ==
+        WINC_ERROR_TARGET, "thresholds of a started target");
+  DWORD pid = t.process_id();
+  Check(t.WaitForEvents(1), "new process");
+
+  // Below the first level, then past it, then past both of the others at
+  // once, then growing further after the last one is delivered
+  Check(fake.SimulateAllocation(pid, 6 * MB) != FALSE, "allocate");
+  Check(fake.SimulateAllocation(pid, 3 * MB) != FALSE, "allocate 50%");
+  Check(t.WaitForEvents(2), "first level");
+  Check(fake.SimulateAllocation(pid, -2 * static_cast<SSIZE_T>(MB)) != FALSE,
+        "decommit");
+  Check(fake.SimulateAllocation(pid, 8 * MB) != FALSE, "allocate 90%");
+  Check(t.WaitForEvents(4), "other levels");
+  Check(fake.SimulateAllocation(pid, MB) != FALSE, "allocate more");
+  Check(fake.SimulateExit(pid, 0) != FALSE, "exit");
+  Check(t.WaitForExitAll(), "exit all delivered");
+
+  const Event expected[] = {
+    {EVENT_NEW_PROCESS, pid, 0},
+    {EVENT_MEMORY_THRESHOLD, 0, 9 * MB},
+    {EVENT_MEMORY_THRESHOLD, 1, 15 * MB},
+    {EVENT_MEMORY_THRESHOLD, 2, 15 * MB},
+    {EVENT_EXIT_PROCESS, pid, 0},
+    {EVENT_EXIT_ALL, 0, 0},
+  };
+  vector<Event> events = t.events();
+  Check(events.size() == ARRAYSIZE(expected), "number of events");
+  for (size_t i = 0; i < events.size(); ++i) {
+    Check(events[i].type == expected[i].type &&
+          events[i].process_id == expected[i].process_id &&
+          events[i].bytes == expected[i].bytes,
+          "memory threshold events");
+  }
+}
+
+void TestReservation(FakePlatform &fake, Container &c) {
+  auto queue = make_shared<RunQueue>();
+  CheckRc(queue->Init(&c, 64 * MB, 0), "Init");
+  DWORD child_id;
+  {
+    Target t;
+    SpawnOptions o = {};
+    o.memory_limit = 16 * MB;
+    CheckRc(queue->Spawn(L"fake.exe", &t, &o, RunQueue::PRIORITY_NORMAL),
+            "Spawn");
+    CheckRc(t.Start(), "Start");
+    Check(fake.SimulateChild(t.process_id(), &child_id) &&
+          fake.SimulateExit(t.process_id(), 0), "Child");
+    CheckRc(t.WaitForProcess(), "Wait");
+    Check(queue->reserved_memory() == 16 * MB,
+          "running child holds the reservation");
+  }
+  Check(queue->reserved_memory() == 0, "destroyed target releases");
+
+  // Closing the job would kill the child with exit code 0, the target
+  // terminates it before releasing the reservation instead
+  HANDLE child = fake.OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION,
+                                  child_id);
+  DWORD exit_code;
+  Check(child && fake.GetExitCodeProcess(child, &exit_code), "Child exit");
+  fake.CloseHandle(child);
+  Check(exit_code == 1, "child terminated before the release");
+}
+
+void TestTokenCache(FakePlatform &fake) {
+  // Another container of the same policy gets the prepared token of the
+  // shared logon, no token is opened or restricted
+  unsigned int handle_count = fake.handle_count();
+  auto logon = make_shared<CurrentLogon>();
+  {
+    Container other;
+    {
+      Target t;
+      CheckRc(other.Spawn(L"fake.exe", &t), "Spawn in another container");
+    }
+    Check(fake.handle_count() == handle_count, "token shared by policy");
+
+    // The token of another SID set is cached too
+    Policy *p;
+    CheckRc(other.GetPolicy(&p), "Policy");
+    p->AddRestrictSid(kInteractiveSid);
+    {
+      Target t;
+      CheckRc(other.Spawn(L"fake.exe", &t), "Spawn with another SID");
+    }
+    Check(fake.handle_count() == handle_count + 1, "token of another SID");
+    p->RemoveRestrictSid(kInteractiveSid);
+
+    // A logon of its own, with its process token
+    CheckRc(logon->Init(SECURITY_MANDATORY_LOW_RID), "Logon");
+    p->SetLogon(logon);
+    {
+      Target t;
+      CheckRc(other.Spawn(L"fake.exe", &t), "Spawn with another logon");
+    }
+    Check(fake.handle_count() == handle_count + 3, "token of another logon");
+  }
+  TokenCache::Trim();
+  Check(fake.handle_count() == handle_count + 3, "token of a logon in use");
+  logon.reset();
+  TokenCache::Trim();
+  Check(fake.handle_count() == handle_count + 1, "token of a released logon");
+}
+
+void TestPolicyImage(FakePlatform &fake) {
+  Container source, c;
+  Policy *p, *loaded;
+  CheckRc(source.GetPolicy(&p), "Policy");
+  CheckRc(c.GetPolicy(&loaded), "Policy");
+  p->AddRestrictSid(kInteractiveSid);
+  p->set_use_desktop(true);
+  p->set_job_ui_limit(JOB_OBJECT_UILIMIT_HANDLES);
+  p->set_mitigation_policy(1);
+  p->set_default_memory_limit(10 * MB);
+  p->set_default_active_process_limit(1);
+  vector<uint8_t> image;
+  p->Save(&image);
+
+  // Followed by the padding of a mapped page
+  vector<uint8_t> mapped(image);
+  mapped.resize(4096);
+  CheckRc(loaded->Load(mapped.data(), mapped.size()), "Load");
+  Check(loaded->restricted_sids() == p->restricted_sids(), "restricted SIDs");
+  Check(loaded->use_desktop() &&
+        loaded->job_basic_limit() == p->job_basic_limit() &&
+        loaded->job_ui_limit() == JOB_OBJECT_UILIMIT_HANDLES &&
+        loaded->mitigation_policy() == 1 &&
+        loaded->default_memory_limit() == 10 * MB &&
+        loaded->default_active_process_limit() == 1, "loaded settings");
+
+  // Truncated, corrupted or of another version, the policy is unchanged
+  for (size_t size = 0; size < image.size(); ++size)
+    Check(loaded->Load(image.data(), size) == WINC_ERROR_POLICY,
+          "truncated image");
+  // The magic, the version, the header size, the size and the sub-authority
+  // count of the SID before the last
+  const size_t corrupted_offsets[] = {0, 4, 6, 8, image.size() - 23};
+  for (size_t offset : corrupted_offsets) {
+    vector<uint8_t> corrupted(image);
+    corrupted[offset] ^= 0x40;
+    Check(loaded->Load(corrupted.data(), corrupted.size()) ==
+          WINC_ERROR_POLICY, "corrupted image");
+  }
+  Check(loaded->default_memory_limit() == 10 * MB, "policy unchanged");
+
+  // The default limits apply to a spawn without its own
+  loaded->set_use_desktop(false);
+  loaded->set_mitigation_policy(0);
+  Target t;
+  CheckRc(c.Spawn(L"fake.exe", &t), "Spawn");
+  CheckRc(t.Start(), "Start");
+  DWORD child;
+  Check(!fake.SimulateChild(t.process_id(), &child),
+        "default active process limit");
+  Check(!fake.SimulateAllocation(t.process_id(), 11 * MB),
+        "default memory limit");
+  CheckRc(t.TerminateJob(0), "Terminate");
+  CheckRc(t.WaitForProcess(), "Wait");
+}
+
+}
+
+int main() {
+  // The event dispatcher uses the platform until the process exits
+  FakePlatform &fake = *new FakePlatform;
+  Platform::Set(&fake);
+  {
+    Container c;
+    TestEventOrder(fake, c);
+
+    // The policy keeps its tokens, everything else is closed with the
+    // target
+    unsigned int handle_count = fake.handle_count();
+    TestTerminate(fake, c);
+    TestRun(fake, c);
+    TestEnvironment(fake, c);
+    TestProcessTable(fake, c);
+    TestMemoryThresholds(fake, c);
+    Check(fake.handle_count() == handle_count, "no handle leaked");
+    Check(fake.process_count() == 10, "number of processes");
+    TestReservation(fake, c);
+    TestTokenCache(fake);
+    TestPolicyImage(fake);
+  }
+  fprintf(stderr, "OK\n");
+}
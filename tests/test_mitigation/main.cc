@@ -0,0 +1,93 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Runs payload_syscall under several mitigation policies and prints the
+// average job time and wall time of each, to measure the overhead of the
+// system call filtering.
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+
+#include <winc.h>
+
+using namespace winc;
+
+namespace {
+
+const int K = 10;
+
+struct MitigationCase {
+  const char *name;
+  DWORD64 mitigation_policy;
+};
+
+const MitigationCase cases[] = {
+  {"none", 0},
+  {"win32k", PROCESS_CREATION_MITIGATION_POLICY_WIN32K_SYSTEM_CALL_DISABLE_ALWAYS_ON},
+  {"win32k+extension+handle",
+   PROCESS_CREATION_MITIGATION_POLICY_WIN32K_SYSTEM_CALL_DISABLE_ALWAYS_ON |
+   PROCESS_CREATION_MITIGATION_POLICY_EXTENSION_POINT_DISABLE_ALWAYS_ON |
+   PROCESS_CREATION_MITIGATION_POLICY_STRICT_HANDLE_CHECKS_ALWAYS_ON},
+};
+
+}
+
+int main() {
+  wchar_t exe_path[MAX_PATH];
+  ::GetModuleFileNameW(NULL, exe_path, MAX_PATH);
+  wchar_t *slash = exe_path + wcslen(exe_path);
+  while (*--slash != L'\\');
+  *++slash = L'\0';
+  wcscat_s(exe_path, L"payload_syscall.exe");
+
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  for (const MitigationCase &mc : cases) {
+    Container c;
+    Policy *p;
+    ResultCode rc = c.GetPolicy(&p);
+    if (rc != WINC_OK) {
+      fprintf(stderr, "Policy error %d\n", rc);
+      exit(1);
+    }
+    p->set_mitigation_policy(mc.mitigation_policy);
+
+    ULONG64 total_time = 0;
+    LONGLONG total_wall = 0;
+    for (int i = 0; i < K; ++i) {
+      LARGE_INTEGER start, end;
+      ::QueryPerformanceCounter(&start);
+      Target t;
+      rc = c.Spawn(exe_path, &t);
+      if (rc != WINC_OK) {
+        fprintf(stderr, "Spawn error %d\n", rc);
+        exit(1);
+      }
+      rc = t.Start();
+      if (rc != WINC_OK) {
+        fprintf(stderr, "Start error %d\n", rc);
+        exit(1);
+      }
+      t.WaitForProcess();
+      ::QueryPerformanceCounter(&end);
+
+      DWORD exit_code;
+      ULONG64 time;
+      t.GetProcessExitCode(&exit_code);
+      t.GetJobTime(&time);
+      if (exit_code != 0) {
+        fprintf(stderr, "Payload exited with %08" PRIX32 "\n", exit_code);
+        exit(1);
+      }
+      total_time += time;
+      total_wall += end.QuadPart - start.QuadPart;
+    }
+    fprintf(stderr, "%-24s  TIME %" PRIu64 " us  WALL %" PRIu64 " us\n",
+      mc.name, total_time / K / 10,
+      static_cast<uint64_t>(total_wall * 1000000 / frequency.QuadPart / K));
+  }
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks the admission order of the run queue, that a spawned target
+// returns its reservation when all of its processes exit, and that threads
+// may spawn through the queue on a shared container.
+
+#include <Windows.h>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <memory>
+
+#include <winc.h>
+
+using namespace winc;
+using std::make_shared;
+using std::shared_ptr;
+
+namespace {
+
+const uint64_t MB = 1024 * 1024;
+
+struct Request {
+  RunQueue *queue;
+  uint64_t memory;
+  RunQueue::Priority priority;
+  HANDLE admitted;
+};
+
+DWORD WINAPI AcquireThread(PVOID param) {
+  Request *request = reinterpret_cast<Request *>(param);
+  ResultCode rc = request->queue->Acquire(request->memory, 0,
+                                          request->priority);
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Acquire error %d\n", rc);
+    exit(1);
+  }
+  ::SetEvent(request->admitted);
+  return 0;
+}
+
+const unsigned int kSpawnThreadCount = 8;
+
+struct SpawnRequest {
+  RunQueue *queue;
+  const wchar_t *exe_path;
+  unsigned int index;
+};
+
+// Spawns with an environment override, which the container merges in its
+// shared arena
+DWORD WINAPI SpawnThread(PVOID param) {
+  SpawnRequest *request = reinterpret_cast<SpawnRequest *>(param);
+  wchar_t variable[32];
+  swprintf_s(variable, L"WINC_TEST_SPAWN=%u", request->index);
+  const wchar_t *overrides[] = {variable};
+  for (int i = 0; i < 4; ++i) {
+    Target t;
+    SpawnOptions o = {};
+    o.memory_limit = 16 * MB;
+    o.environment_overrides = overrides;
+    o.environment_override_count = 1;
+    ResultCode rc = request->queue->Spawn(request->exe_path, &t, &o,
+                                          RunQueue::PRIORITY_NORMAL);
+    if (rc == WINC_OK)
+      rc = t.Start();
+    if (rc == WINC_OK)
+      rc = t.WaitForProcess();
+    if (rc != WINC_OK) {
+      fprintf(stderr, "Concurrent spawn error %d\n", rc);
+      exit(1);
+    }
+  }
+  return 0;
+}
+
+void Check(bool condition, const char *message) {
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", message);
+    exit(1);
+  }
+}
+
+bool IsAdmitted(Request *request) {
+  return ::WaitForSingleObject(request->admitted, 200) == WAIT_OBJECT_0;
+}
+
+void StartRequest(Request *request, RunQueue *queue, uint64_t memory,
+                  RunQueue::Priority priority) {
+  request->queue = queue;
+  request->memory = memory;
+  request->priority = priority;
+  request->admitted = ::CreateEventW(NULL, TRUE, FALSE, NULL);
+  unsigned int waiting = queue->waiting_count();
+  HANDLE thread = ::CreateThread(NULL, 0, AcquireThread, request, 0, NULL);
+  if (!request->admitted || !thread) {
+    fprintf(stderr, "CreateThread error\n");
+    exit(1);
+  }
+  ::CloseHandle(thread);
+  // Let the thread reach the queue before the next request
+  while (queue->waiting_count() == waiting && !IsAdmitted(request));
+}
+
+}
+
+int main() {
+  Container c;
+  auto queue = make_shared<RunQueue>();
+  ResultCode rc = queue->Init(&c, 100 * MB, 0);
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Init error %d\n", rc);
+    exit(1);
+  }
+
+  Check(queue->Acquire(200 * MB, 0, RunQueue::PRIORITY_NORMAL)
+          == WINC_ERROR_OVER_BUDGET, "request over budget");
+  Check(queue->Acquire(60 * MB, 0, RunQueue::PRIORITY_NORMAL) == WINC_OK,
+        "fast path admission");
+
+  Request low, normal, high;
+  StartRequest(&low, queue.get(), 60 * MB, RunQueue::PRIORITY_LOW);
+  Check(!IsAdmitted(&low), "low priority waits for budget");
+  StartRequest(&normal, queue.get(), 30 * MB, RunQueue::PRIORITY_NORMAL);
+  Check(IsAdmitted(&normal), "normal priority passes blocked low priority");
+  StartRequest(&high, queue.get(), 20 * MB, RunQueue::PRIORITY_HIGH);
+  Check(!IsAdmitted(&high), "high priority waits for budget");
+
+  // 60 + 30 reserved, releasing 60 admits the high priority request first,
+  // and the low priority request still does not fit
+  queue->Release(60 * MB, 0);
+  Check(IsAdmitted(&high), "high priority admitted on release");
+  Check(!IsAdmitted(&low), "low priority still waits");
+  queue->Release(30 * MB, 0);
+  Check(IsAdmitted(&low), "low priority admitted on release");
+  Check(queue->reserved_memory() == 80 * MB, "reserved memory");
+  queue->Release(20 * MB, 0);
+  queue->Release(60 * MB, 0);
+
+  rc = queue->Acquire(100 * MB, 0, RunQueue::PRIORITY_NORMAL, 0);
+  Check(rc == WINC_OK, "whole budget admitted");
+  rc = queue->Acquire(MB, 0, RunQueue::PRIORITY_HIGH, 0);
+  Check(rc == WINC_ERROR_TIMEOUT, "no wait when budget is exhausted");
+  rc = queue->Acquire(MB, 0, RunQueue::PRIORITY_HIGH, 100);
+  Check(rc == WINC_ERROR_TIMEOUT, "timeout when budget is exhausted");
+  Check(queue->waiting_count() == 0, "timeouted waiter leaves the queue");
+  Check(queue->reserved_memory() == 100 * MB, "nothing reserved on timeout");
+  queue->Release(100 * MB, 0);
+
+  wchar_t exe_path[MAX_PATH];
+  ::GetModuleFileNameW(NULL, exe_path, MAX_PATH);
+  wchar_t *slash = exe_path + wcslen(exe_path);
+  while (*--slash != L'\\');
+  *++slash = L'\0';
+  wcscat_s(exe_path, L"payload_syscall.exe");
+
+  Target t;
+  SpawnOptions o = {};
+  o.memory_limit = 64 * MB;
+  rc = queue->Spawn(exe_path, &t, &o, RunQueue::PRIORITY_NORMAL);
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Spawn error %d\n", rc);
+    exit(1);
+  }
+  Check(queue->reserved_memory() == 64 * MB, "spawn reserves memory limit");
+  rc = t.Start();
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Start error %d\n", rc);
+    exit(1);
+  }
+  t.WaitForProcess();
+  Check(queue->reserved_memory() == 0, "exit releases the reservation");
+
+  // Without a limit of its own, the spawn reserves the default of the policy
+  Target unlimited;
+  o.memory_limit = 0;
+  Check(queue->Spawn(exe_path, &unlimited, &o, RunQueue::PRIORITY_NORMAL) ==
+        WINC_ERROR_OVER_BUDGET, "spawn without memory limit");
+  Policy *p;
+  rc = c.GetPolicy(&p);
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Policy error %d\n", rc);
+    exit(1);
+  }
+  p->set_default_memory_limit(32 * MB);
+  Target defaulted;
+  rc = queue->Spawn(exe_path, &defaulted, &o, RunQueue::PRIORITY_NORMAL);
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Spawn error %d\n", rc);
+    exit(1);
+  }
+  Check(queue->reserved_memory() == 32 * MB,
+        "spawn reserves the default memory limit");
+  rc = defaulted.Start();
+  if (rc != WINC_OK) {
+    fprintf(stderr, "Start error %d\n", rc);
+    exit(1);
+  }
+  defaulted.WaitForProcess();
+  Check(queue->reserved_memory() == 0, "exit releases the default");
+
+  // More threads than the budget admits at once, so some of them wait
+  SpawnRequest requests[kSpawnThreadCount];
+  HANDLE threads[kSpawnThreadCount];
+  for (unsigned int i = 0; i < kSpawnThreadCount; ++i) {
+    requests[i].queue = queue.get();
+    requests[i].exe_path = exe_path;
+    requests[i].index = i;
+    threads[i] = ::CreateThread(NULL, 0, SpawnThread, &requests[i], 0, NULL);
+    if (!threads[i]) {
+      fprintf(stderr, "CreateThread error\n");
+      exit(1);
+    }
+  }
+  ::WaitForMultipleObjects(kSpawnThreadCount, threads, TRUE, INFINITE);
+  for (unsigned int i = 0; i < kSpawnThreadCount; ++i)
+    ::CloseHandle(threads[i]);
+  Check(queue->reserved_memory() == 0, "concurrent spawns release");
+  fprintf(stderr, "OK\n");
+}
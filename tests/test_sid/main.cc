@@ -0,0 +1,133 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks the string form, the well-known SIDs, hashing and interning of the
+// Sid value type. Nothing here depends on the Windows API, so the test also
+// builds on Linux together with core/sid.cc alone.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+
+#include <winc/sid.h>
+
+using namespace winc;
+using std::mt19937;
+using std::string;
+using std::uniform_int_distribution;
+using std::unordered_set;
+
+namespace {
+
+const unsigned int kIterations = 100000;
+
+void Check(bool condition, const char *message) {
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", message);
+    exit(1);
+  }
+}
+
+void TestWellKnown() {
+  static_assert(kBuiltinUsersSid.sub_authority(1) == 545 &&
+                kBuiltinUsersSid.length() == 16,
+                "well-known SIDs are constant expressions");
+  const struct {
+    const Sid &sid;
+    const char *text;
+  } cases[] = {
+    {kNullSid, "S-1-0-0"},
+    {kWorldSid, "S-1-1-0"},
+    {kInteractiveSid, "S-1-5-4"},
+    {kAuthenticatedUserSid, "S-1-5-11"},
+    {kRestrictedCodeSid, "S-1-5-12"},
+    {kLocalSystemSid, "S-1-5-18"},
+    {kBuiltinUsersSid, "S-1-5-32-545"},
+  };
+  for (const auto &c : cases) {
+    Check(c.sid.Format() == c.text, "format of a well-known SID");
+    Sid parsed;
+    Check(Sid::Parse(c.text, &parsed), "parse of a well-known SID");
+    Check(parsed == c.sid, "parsed well-known SID");
+  }
+  Check(MandatoryLabelSid(0x1000).Format() == "S-1-16-4096",
+        "low mandatory label");
+}
+
+void TestParse() {
+  const char *invalid[] = {
+    "", "S", "S-", "S-1", "S-1-", "S-2-5", "X-1-5", "S-1-5-", "S-1--5",
+    "S-1-5-x", "S-1-0x", "S-1-5-0x20", "S-1-281474976710656",
+    "S-1-5-4294967296", "S-1-5-1-2-3-4-5-6-7-8-9-10-11-12-13-14-15-16",
+  };
+  Sid sid;
+  for (const char *text : invalid)
+    Check(!Sid::Parse(text, &sid), "invalid string rejected");
+  Check(!Sid::Parse(string("S-1-5\0-32", 9), &sid), "embedded null");
+
+  Check(Sid::Parse("s-1-5-4294967295", &sid) && sid.sub_authority(0) ==
+        4294967295u, "largest sub-authority");
+  Check(Sid::Parse("S-1-0x0000000000AB-7", &sid) && sid.authority() == 0xAB,
+        "hexadecimal authority");
+  Check(sid.Format() == "S-1-171-7", "small authority in decimal");
+  Check(Sid::Parse("S-1-281474976710655", &sid) &&
+        sid.Format() == "S-1-0xFFFFFFFFFFFF", "large authority in hexadecimal");
+}
+
+void TestRoundTrip() {
+  mt19937 random(20150605);
+  uniform_int_distribution<uint32_t> sub_authority;
+  uniform_int_distribution<unsigned int> count(0, Sid::kMaxSubAuthorities);
+  uniform_int_distribution<uint64_t> authority(0, (1ULL << 48) - 1);
+  uniform_int_distribution<unsigned int> small(0, 20);
+  for (unsigned int i = 0; i < kIterations; ++i) {
+    uint32_t sub_authorities[Sid::kMaxSubAuthorities];
+    unsigned int n = count(random);
+    for (unsigned int j = 0; j < n; ++j)
+      sub_authorities[j] = sub_authority(random);
+    // Mostly authorities which fit in 32 bits, as the real ones do
+    uint64_t a = i % 4 ? small(random) : authority(random);
+    Sid sid;
+    Check(sid.Init(a, sub_authorities, n) == WINC_OK, "init");
+    Sid parsed;
+    Check(Sid::Parse(sid.Format(), &parsed), "parse of the formatted SID");
+    Check(parsed == sid && parsed.Hash() == sid.Hash(), "round trip");
+  }
+  Sid sid;
+  uint32_t sub_authorities[Sid::kMaxSubAuthorities + 1] = {};
+  Check(sid.Init(5, sub_authorities, Sid::kMaxSubAuthorities + 1) ==
+        WINC_ERROR_SID, "too many sub-authorities");
+}
+
+void TestIntern() {
+  Sid users;
+  Check(Sid::Parse("S-1-5-32-545", &users), "parse");
+  const Sid *interned = Sid::Intern(users);
+  Check(interned == Sid::Intern(kBuiltinUsersSid), "equal SIDs interned once");
+  Check(interned != Sid::Intern(kWorldSid), "different SIDs interned apart");
+  Check(*interned == users, "interned copy");
+
+  // The unused sub-authorities take no part in the comparison
+  uint32_t sub_authorities[] = {32, 545, 1};
+  Sid longer;
+  Check(longer.Init(5, sub_authorities, 3) == WINC_OK, "init");
+  Check(longer != users, "prefix is not equal");
+  Check(longer.Init(5, sub_authorities, 2) == WINC_OK && longer == users &&
+        longer.Hash() == users.Hash(), "equal after init");
+
+  unordered_set<Sid> set = {kWorldSid, kBuiltinUsersSid, users};
+  Check(set.size() == 2, "hash set of SIDs");
+}
+
+}
+
+int main() {
+  TestWellKnown();
+  TestParse();
+  TestRoundTrip();
+  TestIntern();
+  fprintf(stderr, "OK\n");
+}
@@ -0,0 +1,316 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winc/batch.h"
+
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <winc.h>
+
+#include "winc/cli_util.h"
+#include "winc/json.h"
+
+using std::move;
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace winc {
+
+namespace cli {
+
+namespace {
+
+// The output beyond this is not kept, unless the case sets its own limit
+const size_t kDefaultOutputLimit = 64 * 1024 * 1024;
+
+struct Case {
+  JsonValue id;
+  // Empty if no output is expected
+  wstring expected_path;
+};
+
+// Splits the lines of a buffer, without the trailing whitespace
+class LineReader {
+public:
+  LineReader(const char *data, size_t size)
+    : p_(data)
+    , end_(data + size)
+    {}
+
+  // Returns false at the end of the buffer
+  bool Next(const char **out_line, size_t *out_size) {
+    if (p_ == end_)
+      return false;
+    const char *begin = p_;
+    const char *eol = reinterpret_cast<const char *>(
+        memchr(p_, '\n', end_ - p_));
+    const char *line_end = eol ? eol : end_;
+    p_ = eol ? eol + 1 : end_;
+    while (line_end != begin &&
+           (line_end[-1] == ' ' || line_end[-1] == '\t' ||
+            line_end[-1] == '\r'))
+      --line_end;
+    *out_line = begin;
+    *out_size = line_end - begin;
+    return true;
+  }
+
+  // Returns true if the remaining lines are empty
+  bool AtBlankEnd() {
+    const char *line;
+    size_t size;
+    while (Next(&line, &size)) {
+      if (size)
+        return false;
+    }
+    return true;
+  }
+
+private:
+  const char *p_;
+  const char *end_;
+};
+
+void Fail(const wchar_t *manifest_path, size_t line_number,
+          const wchar_t *message) {
+  fwprintf(stderr, L"%ws:%u: %ws\n", manifest_path,
+           static_cast<unsigned int>(line_number), message);
+}
+
+// Parses one line of the manifest into a job and its case
+bool ParseCase(const JsonValue &message, size_t line_number,
+               const SpawnOptions &defaults, const wchar_t *manifest_path,
+               ExecutorJob *out_job, Case *out_case) {
+  if (message.type() != JsonValue::TYPE_OBJECT) {
+    Fail(manifest_path, line_number, L"object expected");
+    return false;
+  }
+  const JsonValue *id = message.Find("id");
+  if (id) {
+    out_case->id = *id;
+  } else {
+    string id_text = std::to_string(line_number);
+    ParseJson(id_text.data(), id_text.size(), &out_case->id);
+  }
+
+  wstring exe;
+  bool present;
+  if (!GetStringMember(message, "exe", &exe, &present) || !present) {
+    Fail(manifest_path, line_number, L"exe expected");
+    return false;
+  }
+  wchar_t exe_path[MAX_PATH];
+  if (!FindApplication(exe.c_str(), exe_path)) {
+    Fail(manifest_path, line_number, L"application path not found");
+    return false;
+  }
+  out_job->exe_path = exe_path;
+  CommandLineBuilder command_line;
+  if (!GetCommandLineMember(message, "args", exe, &command_line)) {
+    Fail(manifest_path, line_number, L"args must be an array of strings");
+    return false;
+  }
+  out_job->command_line = command_line.command_line();
+
+  wstring stdin_path;
+  if (!GetStringMember(message, "stdin", &stdin_path, &present)) {
+    Fail(manifest_path, line_number, L"stdin must be a string");
+    return false;
+  }
+  if (present && !ReadWholeFile(stdin_path.c_str(), &out_job->input)) {
+    Fail(manifest_path, line_number, L"cannot read the stdin file");
+    return false;
+  }
+  if (!GetStringMember(message, "expected", &out_case->expected_path,
+                       &present)) {
+    Fail(manifest_path, line_number, L"expected must be a string");
+    return false;
+  }
+
+  uint64_t memory_limit = defaults.memory_limit;
+  uint64_t active_process_limit = defaults.active_process_limit;
+  uint64_t processor_affinity = defaults.processor_affinity;
+  uint64_t time_limit = 0;
+  uint64_t output_limit = present ? kDefaultOutputLimit : 0;
+  if (!GetUint64Member(message, "memory_limit", &memory_limit) ||
+      !GetUint64Member(message, "active_process_limit",
+                       &active_process_limit) ||
+      !GetUint64Member(message, "processor_affinity",
+                       &processor_affinity) ||
+      !GetUint64Member(message, "time_limit", &time_limit) ||
+      !GetUint64Member(message, "output_limit", &output_limit) ||
+      active_process_limit > UINT32_MAX || time_limit >= INFINITE ||
+      (present && !output_limit)) {
+    Fail(manifest_path, line_number, L"invalid limit");
+    return false;
+  }
+  out_job->memory_limit = static_cast<uintptr_t>(memory_limit);
+  out_job->active_process_limit = static_cast<uint32_t>(active_process_limit);
+  out_job->processor_affinity = static_cast<uintptr_t>(processor_affinity);
+  // An affinity of the case overrides the exclusive core of the CLI
+  out_job->auto_affinity = defaults.auto_affinity &&
+                           !message.Find("processor_affinity");
+  out_job->time_limit_ms = static_cast<DWORD>(time_limit);
+  // Only the output compared with the expected one is captured
+  if (present)
+    out_job->output_limit = static_cast<size_t>(output_limit);
+  return true;
+}
+
+bool LoadManifest(const wchar_t *manifest_path, const SpawnOptions &defaults,
+                  vector<ExecutorJob> *out_jobs, vector<Case> *out_cases) {
+  string manifest;
+  if (!ReadWholeFile(manifest_path, &manifest)) {
+    fwprintf(stderr, L"Cannot read the manifest: %ws\n", manifest_path);
+    return false;
+  }
+  LineReader reader(manifest.data(), manifest.size());
+  const char *line;
+  size_t size;
+  for (size_t line_number = 1; reader.Next(&line, &size); ++line_number) {
+    if (!size)
+      continue;
+    JsonValue message;
+    if (!ParseJson(line, size, &message)) {
+      Fail(manifest_path, line_number, L"invalid JSON");
+      return false;
+    }
+    ExecutorJob job = ExecutorJob();
+    Case test_case;
+    if (!ParseCase(message, line_number, defaults, manifest_path,
+                   &job, &test_case))
+      return false;
+    out_jobs->push_back(move(job));
+    out_cases->push_back(move(test_case));
+  }
+  return true;
+}
+
+const char *Judge(const ExecutorResult &result, const Case &test_case) {
+  if (result.time_limit_exceeded)
+    return "time_limit_exceeded";
+  if (result.exit_code)
+    return "runtime_error";
+  if (!result.output)
+    return "accepted";
+  if (result.output->truncated())
+    return "output_limit_exceeded";
+  string expected;
+  if (!ReadWholeFile(test_case.expected_path.c_str(), &expected))
+    return nullptr;
+  return OutputMatches(result.output->data(), result.output->size(),
+                       expected.data(), expected.size())
+      ? "accepted" : "wrong_answer";
+}
+
+void PrintResult(const ExecutorResult &result, const Case &test_case,
+                 const char *verdict, ResultCode rc) {
+  JsonWriter writer;
+  writer.BeginObject();
+  writer.Key("id");
+  writer.Value(test_case.id);
+  writer.Key("verdict");
+  writer.String(verdict, strlen(verdict));
+  if (rc != WINC_OK) {
+    writer.Key("code");
+    writer.Uint64(rc);
+  } else {
+    writer.Key("exit_code");
+    writer.Uint64(result.exit_code);
+    writer.Key("time_limit_exceeded");
+    writer.Bool(result.time_limit_exceeded);
+    writer.Key("job_time");
+    writer.Uint64(result.job_time);
+    writer.Key("peak_memory");
+    writer.Uint64(result.peak_memory);
+  }
+  writer.EndObject();
+  // One write per line, so that a reader of a pipe sees whole lines
+  string line = writer.str() + '\n';
+  fwrite(line.data(), 1, line.size(), stdout);
+  fflush(stdout);
+}
+
+}
+
+int RunBatch(Container *container, const SpawnOptions &defaults,
+             const wchar_t *manifest_path, unsigned int worker_count,
+             bool fail_fast, bool verbose) {
+  vector<ExecutorJob> jobs;
+  vector<Case> cases;
+  if (!LoadManifest(manifest_path, defaults, &jobs, &cases))
+    return 1;
+  if (verbose)
+    fwprintf(stderr, L"Running %u cases\n",
+             static_cast<unsigned int>(jobs.size()));
+
+  // Jobs not started yet are cancelled as the executor is destroyed, the
+  // running ones finish within their limits
+  Executor executor;
+  ResultCode rc = executor.Init(container, move(jobs), worker_count);
+  if (rc != WINC_OK) {
+    fwprintf(stderr, L"Winc error: %d\n", rc);
+    return 1;
+  }
+  size_t accepted_count = 0;
+  size_t judged_count = 0;
+  for (;;) {
+    ExecutorResult result;
+    bool finished;
+    rc = executor.Next(&result, &finished);
+    if (rc != WINC_OK) {
+      fwprintf(stderr, L"Winc error: %d\n", rc);
+      return 1;
+    }
+    if (finished)
+      break;
+    const Case &test_case = cases[result.index];
+    const char *verdict = nullptr;
+    if (result.rc == WINC_OK) {
+      verdict = Judge(result, test_case);
+      if (!verdict)
+        result.rc = WINC_ERROR_UTIL;
+    }
+    if (result.rc != WINC_OK)
+      verdict = "system_error";
+    PrintResult(result, test_case, verdict, result.rc);
+    ++judged_count;
+    if (!strcmp(verdict, "accepted"))
+      ++accepted_count;
+    else if (fail_fast)
+      break;
+  }
+  if (verbose)
+    fwprintf(stderr, L"%u of %u cases judged, %u accepted\n",
+             static_cast<unsigned int>(judged_count),
+             static_cast<unsigned int>(cases.size()),
+             static_cast<unsigned int>(accepted_count));
+  return accepted_count == cases.size() ? 0 : 1;
+}
+
+bool OutputMatches(const char *output, size_t output_size,
+                   const char *expected, size_t expected_size) {
+  LineReader output_reader(output, output_size);
+  LineReader expected_reader(expected, expected_size);
+  for (;;) {
+    const char *output_line, *expected_line;
+    size_t output_line_size, expected_line_size;
+    if (!output_reader.Next(&output_line, &output_line_size))
+      return expected_reader.AtBlankEnd();
+    if (!expected_reader.Next(&expected_line, &expected_line_size))
+      return !output_line_size && output_reader.AtBlankEnd();
+    if (output_line_size != expected_line_size ||
+        memcmp(output_line, expected_line, output_line_size))
+      return false;
+  }
+}
+
+}
+
+}
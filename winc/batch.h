@@ -0,0 +1,56 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_WINC_BATCH_H_
+#define WINC_WINC_BATCH_H_
+
+#include <cstddef>
+
+namespace winc {
+
+class Container;
+struct SpawnOptions;
+
+namespace cli {
+
+// Runs the test cases of a manifest on a number of workers sharing the
+// container, zero meaning one worker per logical processor. Returns the
+// exit code of the CLI, zero if every case is accepted.
+//
+// Each line of the manifest is a JSON test case:
+//
+//   {"id": "t1", "exe": "a.exe", "args": ["a", "1"], "stdin": "1.in",
+//    "expected": "1.out", "time_limit": 1000, "memory_limit": 67108864,
+//    "active_process_limit": 1, "processor_affinity": 1,
+//    "output_limit": 1048576}
+//
+// Only exe is required. The id defaults to the line number, the limits
+// override the ones given to the CLI, --affinity auto applies unless the
+// case sets its own processor affinity, the time limit is in milliseconds
+// and the output limit in bytes. The standard output is compared with the
+// expected file line by line, ignoring trailing whitespace and trailing
+// empty lines. A result line is printed to the standard output as each
+// case finishes:
+//
+//   {"id": "t1", "verdict": "accepted", "exit_code": 0,
+//    "time_limit_exceeded": false, "job_time": 156250,
+//    "peak_memory": 1048576}
+//
+// The verdict is one of accepted, wrong_answer, time_limit_exceeded,
+// runtime_error, output_limit_exceeded and system_error, which carries the
+// result code instead of the statistics. With fail_fast, no case is started
+// after the first one which is not accepted.
+int RunBatch(Container *container, const SpawnOptions &defaults,
+             const wchar_t *manifest_path, unsigned int worker_count,
+             bool fail_fast, bool verbose);
+
+// Compares an output with the expected one as described above
+bool OutputMatches(const char *output, size_t output_size,
+                   const char *expected, size_t expected_size);
+
+}
+
+}
+
+#endif
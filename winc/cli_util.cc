@@ -0,0 +1,129 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winc/cli_util.h"
+
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <winc.h>
+
+#include "winc/json.h"
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+namespace winc {
+
+namespace cli {
+
+bool Utf8ToWide(const string &utf8, wstring *out_wide) {
+  out_wide->clear();
+  if (utf8.empty())
+    return true;
+  int size = ::MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS,
+                                   utf8.data(), static_cast<int>(utf8.size()),
+                                   NULL, 0);
+  if (!size)
+    return false;
+  out_wide->resize(size);
+  return ::MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS,
+                               utf8.data(), static_cast<int>(utf8.size()),
+                               &(*out_wide)[0], size) == size;
+}
+
+bool WideToUtf8(const wchar_t *wide, string *out_utf8) {
+  int size = ::WideCharToMultiByte(CP_UTF8, 0, wide, -1, NULL, 0, NULL, NULL);
+  if (!size)
+    return false;
+  out_utf8->resize(size);
+  if (::WideCharToMultiByte(CP_UTF8, 0, wide, -1, &(*out_utf8)[0], size,
+                            NULL, NULL) != size)
+    return false;
+  // Without the terminating null
+  out_utf8->resize(size - 1);
+  return true;
+}
+
+bool ReadWholeFile(const wchar_t *path, string *out_data) {
+  HANDLE file = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  unique_handle file_holder(file);
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size) || size.QuadPart > INT32_MAX)
+    return false;
+  out_data->resize(static_cast<size_t>(size.QuadPart));
+  size_t offset = 0;
+  while (offset < out_data->size()) {
+    DWORD read;
+    if (!::ReadFile(file, &(*out_data)[offset],
+                    static_cast<DWORD>(out_data->size() - offset),
+                    &read, NULL))
+      return false;
+    if (!read)
+      break;
+    offset += read;
+  }
+  // The file may be truncated while it is read
+  out_data->resize(offset);
+  return true;
+}
+
+bool FindApplication(const wchar_t *name, wchar_t (&out_path)[MAX_PATH]) {
+  return FindApplicationIn(NULL, name, out_path);
+}
+
+bool FindApplicationIn(const wchar_t *directory, const wchar_t *name,
+                       wchar_t (&out_path)[MAX_PATH]) {
+  return ::SearchPathW(directory, name, L".exe", MAX_PATH, out_path, NULL) &&
+         !(::GetFileAttributesW(out_path) & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool GetStringMember(const JsonValue &object, const char *key,
+                     wstring *out_value, bool *out_present) {
+  const JsonValue *value = object.Find(key);
+  *out_present = value != nullptr;
+  if (!value)
+    return true;
+  return value->type() == JsonValue::TYPE_STRING &&
+         Utf8ToWide(value->string(), out_value);
+}
+
+bool GetUint64Member(const JsonValue &object, const char *key,
+                     uint64_t *out_value) {
+  const JsonValue *value = object.Find(key);
+  return !value || value->GetUint64(out_value);
+}
+
+bool GetCommandLineMember(const JsonValue &object, const char *key,
+                          const wstring &default_arg,
+                          CommandLineBuilder *out_builder) {
+  vector<wstring> args;
+  const JsonValue *value = object.Find(key);
+  if (value) {
+    if (value->type() != JsonValue::TYPE_ARRAY)
+      return false;
+    for (const JsonValue &arg : value->array()) {
+      args.push_back(wstring());
+      if (arg.type() != JsonValue::TYPE_STRING ||
+          !Utf8ToWide(arg.string(), &args.back()))
+        return false;
+    }
+  } else {
+    args.push_back(default_arg);
+  }
+  vector<const wchar_t *> arg_pointers;
+  for (const wstring &arg : args)
+    arg_pointers.push_back(arg.c_str());
+  out_builder->Build(arg_pointers.data(), arg_pointers.size());
+  return true;
+}
+
+}
+
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_WINC_CLI_UTIL_H_
+#define WINC_WINC_CLI_UTIL_H_
+
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+
+namespace winc {
+
+class CommandLineBuilder;
+
+namespace cli {
+
+class JsonValue;
+
+bool Utf8ToWide(const std::string &utf8, std::wstring *out_wide);
+bool WideToUtf8(const wchar_t *wide, std::string *out_utf8);
+
+// Reads a whole file into memory
+bool ReadWholeFile(const wchar_t *path, std::string *out_data);
+
+// Finds the application as the command processor does, fails if not found
+// or if the path is a directory
+bool FindApplication(const wchar_t *name, wchar_t (&out_path)[MAX_PATH]);
+
+// Finds the application in the directory only, without the search path
+bool FindApplicationIn(const wchar_t *directory, const wchar_t *name,
+                       wchar_t (&out_path)[MAX_PATH]);
+
+// Reads an optional member of a request object. These fail if the member
+// is present but of the wrong type, the value is unchanged if absent.
+bool GetStringMember(const JsonValue &object, const char *key,
+                     std::wstring *out_value, bool *out_present);
+bool GetUint64Member(const JsonValue &object, const char *key,
+                     uint64_t *out_value);
+// Builds the command line from an array of arguments, the program name is
+// the first argument. Without the member the command line is the default
+// argument alone.
+bool GetCommandLineMember(const JsonValue &object, const char *key,
+                          const std::wstring &default_arg,
+                          CommandLineBuilder *out_builder);
+
+}
+
+}
+
+#endif
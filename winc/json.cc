@@ -0,0 +1,436 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winc/json.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::make_pair;
+using std::string;
+using std::vector;
+
+namespace winc {
+
+namespace cli {
+
+namespace {
+
+const int kMaxDepth = 64;
+
+void AppendUtf8(uint32_t code_point, string *out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  } else {
+    out->push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+  }
+}
+
+}
+
+// Recursive descent over the document, internal to this file
+class JsonParser {
+public:
+  JsonParser(const char *data, size_t size)
+    : p_(data)
+    , end_(data + size)
+    {}
+
+  bool ParseDocument(JsonValue *out_value) {
+    if (!ParseValue(out_value, 0))
+      return false;
+    SkipWhitespace();
+    return p_ == end_;
+  }
+
+private:
+  void SkipWhitespace() {
+    while (p_ != end_ &&
+           (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n'))
+      ++p_;
+  }
+
+  bool Consume(char c) {
+    SkipWhitespace();
+    if (p_ == end_ || *p_ != c)
+      return false;
+    ++p_;
+    return true;
+  }
+
+  bool ConsumeWord(const char *word) {
+    size_t length = strlen(word);
+    if (static_cast<size_t>(end_ - p_) < length || memcmp(p_, word, length))
+      return false;
+    p_ += length;
+    return true;
+  }
+
+  bool ParseValue(JsonValue *value, int depth) {
+    if (depth > kMaxDepth)
+      return false;
+    SkipWhitespace();
+    if (p_ == end_)
+      return false;
+    switch (*p_) {
+    case '{':
+      return ParseObject(value, depth);
+    case '[':
+      return ParseArray(value, depth);
+    case '"':
+      value->type_ = JsonValue::TYPE_STRING;
+      return ParseString(&value->string_);
+    case 't':
+      value->type_ = JsonValue::TYPE_BOOL;
+      value->bool_ = true;
+      return ConsumeWord("true");
+    case 'f':
+      value->type_ = JsonValue::TYPE_BOOL;
+      value->bool_ = false;
+      return ConsumeWord("false");
+    case 'n':
+      value->type_ = JsonValue::TYPE_NULL;
+      return ConsumeWord("null");
+    default:
+      return ParseNumber(value);
+    }
+  }
+
+  bool ParseObject(JsonValue *value, int depth) {
+    ++p_;
+    value->type_ = JsonValue::TYPE_OBJECT;
+    if (Consume('}'))
+      return true;
+    do {
+      SkipWhitespace();
+      string key;
+      if (p_ == end_ || *p_ != '"' || !ParseString(&key) || !Consume(':'))
+        return false;
+      value->members_.push_back(make_pair(key, JsonValue()));
+      if (!ParseValue(&value->members_.back().second, depth + 1))
+        return false;
+    } while (Consume(','));
+    return Consume('}');
+  }
+
+  bool ParseArray(JsonValue *value, int depth) {
+    ++p_;
+    value->type_ = JsonValue::TYPE_ARRAY;
+    if (Consume(']'))
+      return true;
+    do {
+      value->array_.push_back(JsonValue());
+      if (!ParseValue(&value->array_.back(), depth + 1))
+        return false;
+    } while (Consume(','));
+    return Consume(']');
+  }
+
+  bool ParseHex4(uint32_t *out_value) {
+    if (end_ - p_ < 4)
+      return false;
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      char c = *p_++;
+      value <<= 4;
+      if (c >= '0' && c <= '9')
+        value |= c - '0';
+      else if (c >= 'a' && c <= 'f')
+        value |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        value |= c - 'A' + 10;
+      else
+        return false;
+    }
+    *out_value = value;
+    return true;
+  }
+
+  bool ParseString(string *out) {
+    ++p_;
+    while (p_ != end_) {
+      char c = *p_++;
+      if (c == '"')
+        return true;
+      if (static_cast<unsigned char>(c) < 0x20)
+        return false;
+      if (c != '\\') {
+        out->push_back(c);
+        continue;
+      }
+      if (p_ == end_)
+        return false;
+      switch (*p_++) {
+      case '"':  out->push_back('"');  break;
+      case '\\': out->push_back('\\'); break;
+      case '/':  out->push_back('/');  break;
+      case 'b':  out->push_back('\b'); break;
+      case 'f':  out->push_back('\f'); break;
+      case 'n':  out->push_back('\n'); break;
+      case 'r':  out->push_back('\r'); break;
+      case 't':  out->push_back('\t'); break;
+      case 'u': {
+        uint32_t code_point;
+        if (!ParseHex4(&code_point))
+          return false;
+        if (code_point >= 0xd800 && code_point < 0xdc00) {
+          uint32_t low;
+          if (!ConsumeWord("\\u") || !ParseHex4(&low) ||
+              low < 0xdc00 || low >= 0xe000)
+            return false;
+          code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                       (low - 0xdc00);
+        } else if (code_point >= 0xdc00 && code_point < 0xe000) {
+          return false;
+        }
+        AppendUtf8(code_point, out);
+        break;
+      }
+      default:
+        return false;
+      }
+    }
+    return false;
+  }
+
+  bool ParseNumber(JsonValue *value) {
+    const char *begin = p_;
+    bool negative = p_ != end_ && *p_ == '-';
+    if (negative)
+      ++p_;
+    const char *digits = p_;
+    while (p_ != end_ && *p_ >= '0' && *p_ <= '9')
+      ++p_;
+    if (p_ == digits || (*digits == '0' && p_ - digits > 1))
+      return false;
+    bool integer = true;
+    if (p_ != end_ && *p_ == '.') {
+      integer = false;
+      const char *fraction = ++p_;
+      while (p_ != end_ && *p_ >= '0' && *p_ <= '9')
+        ++p_;
+      if (p_ == fraction)
+        return false;
+    }
+    if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+      integer = false;
+      ++p_;
+      if (p_ != end_ && (*p_ == '+' || *p_ == '-'))
+        ++p_;
+      const char *exponent = p_;
+      while (p_ != end_ && *p_ >= '0' && *p_ <= '9')
+        ++p_;
+      if (p_ == exponent)
+        return false;
+    }
+    // The number is copied, as the input is not null terminated
+    string text(begin, p_);
+    value->type_ = JsonValue::TYPE_NUMBER;
+    value->number_ = strtod(text.c_str(), nullptr);
+    if (integer && !negative && p_ - digits <= 20) {
+      uint64_t result = 0;
+      bool overflow = false;
+      for (const char *d = digits; d != p_; ++d) {
+        uint64_t next = result * 10 + (*d - '0');
+        if (next / 10 != result) {
+          overflow = true;
+          break;
+        }
+        result = next;
+      }
+      value->is_uint64_ = !overflow;
+      value->uint64_ = result;
+    }
+    return true;
+  }
+
+private:
+  const char *p_;
+  const char *end_;
+};
+
+const JsonValue *JsonValue::Find(const char *key) const {
+  for (const auto &member : members_) {
+    if (member.first == key)
+      return &member.second;
+  }
+  return nullptr;
+}
+
+bool JsonValue::GetUint64(uint64_t *out_value) const {
+  if (type_ != TYPE_NUMBER || !is_uint64_)
+    return false;
+  *out_value = uint64_;
+  return true;
+}
+
+bool ParseJson(const char *data, size_t size, JsonValue *out_value) {
+  *out_value = JsonValue();
+  return JsonParser(data, size).ParseDocument(out_value);
+}
+
+void JsonWriter::Separate() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (first_.empty())
+    return;
+  if (!first_.back())
+    out_.push_back(',');
+  first_.back() = false;
+}
+
+void JsonWriter::BeginObject() {
+  Separate();
+  out_.push_back('{');
+  first_.push_back(true);
+}
+
+void JsonWriter::EndObject() {
+  first_.pop_back();
+  out_.push_back('}');
+}
+
+void JsonWriter::BeginArray() {
+  Separate();
+  out_.push_back('[');
+  first_.push_back(true);
+}
+
+void JsonWriter::EndArray() {
+  first_.pop_back();
+  out_.push_back(']');
+}
+
+void JsonWriter::Key(const char *key) {
+  Separate();
+  WriteString(key, strlen(key));
+  out_.push_back(':');
+  after_key_ = true;
+}
+
+void JsonWriter::String(const char *value, size_t size) {
+  Separate();
+  WriteString(value, size);
+}
+
+void JsonWriter::WideString(const wchar_t *value) {
+  string utf8;
+  for (const wchar_t *p = value; *p; ++p) {
+    uint32_t code_point = static_cast<uint32_t>(*p);
+    // Combine the surrogate pairs of UTF-16, a lone surrogate is replaced
+    if (code_point >= 0xd800 && code_point < 0xdc00 &&
+        p[1] >= 0xdc00 && p[1] < 0xe000) {
+      code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                   (static_cast<uint32_t>(*++p) - 0xdc00);
+    } else if (code_point >= 0xd800 && code_point < 0xe000) {
+      code_point = 0xfffd;
+    }
+    AppendUtf8(code_point, &utf8);
+  }
+  String(utf8);
+}
+
+void JsonWriter::Uint64(uint64_t value) {
+  Separate();
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+  out_ += buffer;
+}
+
+void JsonWriter::Double(double value) {
+  Separate();
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.17g", value);
+  out_ += buffer;
+}
+
+void JsonWriter::Bool(bool value) {
+  Separate();
+  out_ += value ? "true" : "false";
+}
+
+void JsonWriter::Null() {
+  Separate();
+  out_ += "null";
+}
+
+void JsonWriter::Value(const JsonValue &value) {
+  uint64_t integer;
+  switch (value.type()) {
+  case JsonValue::TYPE_NULL:
+    Null();
+    break;
+  case JsonValue::TYPE_BOOL:
+    Bool(value.bool_value());
+    break;
+  case JsonValue::TYPE_NUMBER:
+    if (value.GetUint64(&integer))
+      Uint64(integer);
+    else
+      Double(value.number());
+    break;
+  case JsonValue::TYPE_STRING:
+    String(value.string());
+    break;
+  case JsonValue::TYPE_ARRAY:
+    BeginArray();
+    for (const JsonValue &item : value.array())
+      Value(item);
+    EndArray();
+    break;
+  case JsonValue::TYPE_OBJECT:
+    BeginObject();
+    for (const auto &member : value.members()) {
+      Key(member.first.c_str());
+      Value(member.second);
+    }
+    EndObject();
+    break;
+  }
+}
+
+void JsonWriter::WriteString(const char *value, size_t size) {
+  static const char kHex[] = "0123456789abcdef";
+  out_.push_back('"');
+  for (size_t i = 0; i < size; ++i) {
+    char c = value[i];
+    switch (c) {
+    case '"':  out_ += "\\\""; break;
+    case '\\': out_ += "\\\\"; break;
+    case '\n': out_ += "\\n";  break;
+    case '\r': out_ += "\\r";  break;
+    case '\t': out_ += "\\t";  break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out_ += "\\u00";
+        out_.push_back(kHex[c >> 4]);
+        out_.push_back(kHex[c & 0xf]);
+      } else {
+        out_.push_back(c);
+      }
+    }
+  }
+  out_.push_back('"');
+}
+
+}
+
+}
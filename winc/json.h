@@ -0,0 +1,132 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_WINC_JSON_H_
+#define WINC_WINC_JSON_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace winc {
+
+namespace cli {
+
+// A parsed JSON value, the strings are in UTF-8
+class JsonValue {
+public:
+  enum Type {
+    TYPE_NULL,
+    TYPE_BOOL,
+    TYPE_NUMBER,
+    TYPE_STRING,
+    TYPE_ARRAY,
+    TYPE_OBJECT,
+  };
+
+  JsonValue()
+    : type_(TYPE_NULL)
+    , bool_(false)
+    , number_(0)
+    , is_uint64_(false)
+    , uint64_(0)
+    {}
+
+  Type type() const {
+    return type_;
+  }
+
+  bool bool_value() const {
+    return bool_;
+  }
+
+  double number() const {
+    return number_;
+  }
+
+  const std::string &string() const {
+    return string_;
+  }
+
+  const std::vector<JsonValue> &array() const {
+    return array_;
+  }
+
+  const std::vector<std::pair<std::string, JsonValue>> &members() const {
+    return members_;
+  }
+
+  // Returns null if this is not an object or the member is absent
+  const JsonValue *Find(const char *key) const;
+
+  // Succeeds for non-negative integers written without a fraction or an
+  // exponent, which are parsed exactly
+  bool GetUint64(uint64_t *out_value) const;
+
+private:
+  friend class JsonParser;
+  Type type_;
+  bool bool_;
+  double number_;
+  bool is_uint64_;
+  uint64_t uint64_;
+  std::string string_;
+  std::vector<JsonValue> array_;
+  std::vector<std::pair<std::string, JsonValue>> members_;
+};
+
+// Parses a whole document, fails on a syntax error, on nesting deeper than
+// 64 levels and on trailing data other than whitespace
+bool ParseJson(const char *data, size_t size, JsonValue *out_value);
+
+// Writes a compact JSON document, the caller is responsible for balancing
+// the objects and arrays and for putting a key before each member
+class JsonWriter {
+public:
+  JsonWriter()
+    : after_key_(false)
+    {}
+
+  void BeginObject();
+  void EndObject();
+  void BeginArray();
+  void EndArray();
+  void Key(const char *key);
+
+  // The strings are in UTF-8, except for the wide ones
+  void String(const char *value, size_t size);
+  void String(const std::string &value) {
+    String(value.data(), value.size());
+  }
+  void WideString(const wchar_t *value);
+  void Uint64(uint64_t value);
+  void Double(double value);
+  void Bool(bool value);
+  void Null();
+  // Writes a parsed value back
+  void Value(const JsonValue &value);
+
+  const std::string &str() const {
+    return out_;
+  }
+
+private:
+  // Writes the separator before a key or a value
+  void Separate();
+  void WriteString(const char *value, size_t size);
+
+private:
+  std::string out_;
+  // One entry per open object or array, set until its first item
+  std::vector<bool> first_;
+  bool after_key_;
+};
+
+}
+
+}
+
+#endif
@@ -12,6 +12,11 @@
 #include <vector>
 #include <winc.h>
 
+#include "winc/batch.h"
+#include "winc/cli_util.h"
+#include "winc/serve.h"
+#include "winc/stats.h"
+
 using std::shared_ptr;
 using std::vector;
 using namespace winc;
@@ -41,6 +46,21 @@ uint32_t GetArg<uint32_t>(wchar_t *argv[], int &arg_index, int argc) {
   return param;
 }
 
+template <>
+uint64_t GetArg<uint64_t>(wchar_t *argv[], int &arg_index, int argc) {
+  if (arg_index + 1 >= argc) {
+    fwprintf(stderr, L"Missing parameter: %ws\n", argv[arg_index]);
+    exit(1);
+  }
+  uint64_t param;
+  if (swscanf_s(argv[++arg_index], L"%llu", &param) <= 0) {
+    int err = errno;
+    fwprintf(stderr, L"Integer parameter expected: %ws\n", argv[arg_index]);
+    exit(err);
+  }
+  return param;
+}
+
 class MyTarget : public Target {
 public:
   virtual void OnActiveProcessLimit() override {
@@ -75,6 +95,13 @@ int wmain(int argc, wchar_t *argv[]) {
   SpawnOptions o = {};
   bool verbose = false;
   bool listen = false;
+  const wchar_t *serve_path = nullptr;
+  const wchar_t *serve_dir = nullptr;
+  const wchar_t *batch_path = nullptr;
+  unsigned int worker_count = 0;
+  bool fail_fast = false;
+  bool json_stats = false;
+  uint32_t repeat = 1;
 
   int arg_index;
   for (arg_index = 1; arg_index < argc; ++arg_index) {
@@ -97,6 +124,51 @@ int wmain(int argc, wchar_t *argv[]) {
       }
       continue;
     }
+    if (!wcscmp(argv[arg_index], L"--serve")) {
+      if (arg_index + 1 >= argc) {
+        fwprintf(stderr, L"Missing parameter: %ws\n", argv[arg_index]);
+        exit(1);
+      }
+      serve_path = argv[++arg_index];
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"--serve-dir")) {
+      if (arg_index + 1 >= argc) {
+        fwprintf(stderr, L"Missing parameter: %ws\n", argv[arg_index]);
+        exit(1);
+      }
+      serve_dir = argv[++arg_index];
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"--batch")) {
+      if (arg_index + 1 >= argc) {
+        fwprintf(stderr, L"Missing parameter: %ws\n", argv[arg_index]);
+        exit(1);
+      }
+      batch_path = argv[++arg_index];
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"-j") ||
+        !wcscmp(argv[arg_index], L"--jobs")) {
+      worker_count = GetArg<uint32_t>(argv, arg_index, argc);
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"--fail-fast")) {
+      fail_fast = true;
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"--stats=json")) {
+      json_stats = true;
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"--repeat")) {
+      repeat = GetArg<uint32_t>(argv, arg_index, argc);
+      if (!repeat) {
+        fwprintf(stderr, L"Repeat count must be positive\n");
+        exit(1);
+      }
+      continue;
+    }
     if (!wcscmp(argv[arg_index], L"--use-desktop")) {
       if (!p->use_desktop()) {
         p->set_use_desktop(true);
@@ -112,11 +184,15 @@ int wmain(int argc, wchar_t *argv[]) {
         PrintErrorAndExit(rc);
       Sid *logon_sid;
       rc = logon->GetUserSid(&logon_sid);
-      auto &restricted_sids = p->restricted_sids();
-      if (find(restricted_sids.begin(), restricted_sids.end(), *logon_sid)
-          == restricted_sids.end()) {
+      if (!p->HasRestrictSid(*logon_sid))
         p->AddRestrictSid(*logon_sid);
-      }
+      continue;
+    }
+    if (!wcscmp(argv[arg_index], L"--mitigation")) {
+      p->set_mitigation_policy(GetArg<uint64_t>(argv, arg_index, argc));
+      if (verbose)
+        fwprintf(stderr, L"Setting mitigation policy to %" PRIu64 "\n",
+                 p->mitigation_policy());
       continue;
     }
     if (!wcscmp(argv[arg_index], L"--active-process")) {
@@ -135,6 +211,13 @@ int wmain(int argc, wchar_t *argv[]) {
       continue;
     }
     if (!wcscmp(argv[arg_index], L"--affinity")) {
+      if (arg_index + 1 < argc && !wcscmp(argv[arg_index + 1], L"auto")) {
+        ++arg_index;
+        o.auto_affinity = true;
+        if (verbose)
+          fwprintf(stderr, L"Leasing an exclusive core for affinity\n");
+        continue;
+      }
       o.processor_affinity = GetArg<uint32_t>(argv, arg_index, argc);
       if (verbose)
         fwprintf(stderr, L"Setting processor affinity to %" PRIuPTR "\n",
@@ -146,6 +229,27 @@ int wmain(int argc, wchar_t *argv[]) {
     exit(1);
   }
 
+  // In daemon and batch mode the requests carry the command lines, the
+  // options are the defaults of every request
+  if (serve_path || batch_path) {
+    if (arg_index < argc) {
+      fwprintf(stderr, L"Unexpected command line in serve or batch mode\n");
+      exit(1);
+    }
+    if (serve_path && batch_path) {
+      fwprintf(stderr, L"Serve and batch mode are exclusive\n");
+      exit(1);
+    }
+    if (serve_path && !serve_dir) {
+      fwprintf(stderr, L"Serve mode requires --serve-dir\n");
+      exit(1);
+    }
+    if (serve_path)
+      return cli::Serve(&c, o, serve_path, serve_dir, verbose);
+    return cli::RunBatch(&c, o, batch_path, worker_count, fail_fast,
+                         verbose);
+  }
+
   if (arg_index >= argc) {
     fwprintf(stderr, L"Missing command line\n");
     exit(1);
@@ -153,9 +257,7 @@ int wmain(int argc, wchar_t *argv[]) {
 
   // Find the application path
   wchar_t name_buffer[MAX_PATH];
-  if (!::SearchPathW(NULL, argv[arg_index], L".exe",
-                     MAX_PATH, name_buffer, NULL) ||
-      GetFileAttributesW(name_buffer) & FILE_ATTRIBUTE_DIRECTORY) {
+  if (!cli::FindApplication(argv[arg_index], name_buffer)) {
     fwprintf(stderr, L"Application path not found\n");
     exit(1);
   }
@@ -163,48 +265,49 @@ int wmain(int argc, wchar_t *argv[]) {
     fwprintf(stderr, L"Application path: %ws\n", name_buffer);
 
   // Build command line
-  vector<wchar_t> command_line;
-  for (; arg_index < argc; ++arg_index) {
-    bool quoted = false;
-    if (wcschr(argv[arg_index], L' ')) {
-      quoted = true;
-      command_line.push_back(L'\"');
-    }
-    for (wchar_t *p = argv[arg_index]; *p; ++p) {
-      if (*p == '\"')
-        command_line.push_back('\\');
-      command_line.push_back(*p);
-    }
-    if (quoted)
-      command_line.push_back(L'\"');
-    if (arg_index + 1 < argc) {
-      command_line.push_back(L' ');
-    } else {
-      command_line.push_back(L'\0');
-    }
-  }
-  o.command_line = command_line.data();
+  CommandLineBuilder command_line;
+  command_line.Build(argv + arg_index, argc - arg_index);
+  o.command_line = command_line.command_line();
   if (verbose)
-    fwprintf(stderr, L"Command line: %ws\n", command_line.data());
+    fwprintf(stderr, L"Command line: %ws\n", command_line.command_line());
 
-  MyTarget t;
-  rc = c.Spawn(name_buffer, &t, &o);
-  if (rc != WINC_OK)
-    PrintErrorAndExit(rc);
   ::SetConsoleCtrlHandler(NULL, TRUE);
-  rc = t.Start(listen);
-  if (rc != WINC_OK)
-    PrintErrorAndExit(rc);
-  // TODO(iceboy): In listen mode, events after process exit will be discarded
-  rc = t.WaitForProcess();
-  if (rc != WINC_OK)
-    PrintErrorAndExit(rc);
-  DWORD exit_code;
-  rc = t.GetProcessExitCode(&exit_code);
-  if (rc != WINC_OK)
-    PrintErrorAndExit(rc);
-  if (verbose) {
-    fwprintf(stderr, L"Process terminated with code %u\n", exit_code);
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  vector<cli::RunStats> runs;
+  for (uint32_t run = 0; run < repeat; ++run) {
+    MyTarget t;
+    rc = c.Spawn(name_buffer, &t, &o);
+    if (rc != WINC_OK)
+      PrintErrorAndExit(rc);
+    LARGE_INTEGER start, end;
+    ::QueryPerformanceCounter(&start);
+    rc = t.Start(listen);
+    if (rc != WINC_OK)
+      PrintErrorAndExit(rc);
+    // TODO(iceboy): In listen mode, events after process exit will be
+    // discarded
+    rc = t.WaitForProcess();
+    if (rc != WINC_OK)
+      PrintErrorAndExit(rc);
+    ::QueryPerformanceCounter(&end);
+    ULONG64 ticks = end.QuadPart - start.QuadPart;
+    ULONG64 wall_time = ticks / frequency.QuadPart * 10000000 +
+                        ticks % frequency.QuadPart * 10000000 /
+                        frequency.QuadPart;
+    cli::RunStats stats;
+    rc = cli::CollectStats(&t, wall_time, &stats);
+    if (rc != WINC_OK)
+      PrintErrorAndExit(rc);
+    if (verbose) {
+      fwprintf(stderr, L"Process terminated with code %u\n",
+               stats.exit_code);
+    }
+    runs.push_back(stats);
   }
-  return exit_code;
+  if (json_stats)
+    cli::PrintStatsJson(runs);
+  else if (repeat > 1)
+    cli::PrintStatsTable(runs);
+  return runs.back().exit_code;
 }
@@ -0,0 +1,644 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winc/serve.h"
+
+// Winsock 2 must come before Windows.h, which includes the old Winsock
+#include <WinSock2.h>
+#include <Windows.h>
+#include <Sddl.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <deque>
+#include <memory>
+#include <string>
+#include <winc.h>
+
+#include "winc/cli_util.h"
+#include "winc/json.h"
+
+using std::deque;
+using std::make_shared;
+using std::min;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::wstring;
+
+namespace winc {
+
+namespace cli {
+
+namespace {
+
+// The address of a Unix domain socket, as in afunix.h which is only in the
+// Windows 10 SDK 17063 and later
+const size_t kUnixPathMax = 108;
+
+struct UnixAddress {
+  ADDRESS_FAMILY sun_family;
+  char sun_path[kUnixPathMax];
+};
+
+// Reparse tag of a Unix domain socket file, IO_REPARSE_TAG_AF_UNIX
+const DWORD kReparseTagAfUnix = 0x80000023;
+
+const size_t kMaxRequestSize = 1024 * 1024;
+
+// Only the owner of the socket, which is the user of the daemon, and the
+// system may connect, as the requests run programs
+const wchar_t kSocketSecurity[] = L"D:P(A;;FA;;;OW)(A;;FA;;;SY)";
+
+// Time for the remaining events to arrive after the job is terminated
+const DWORD kExitAllTimeoutMs = 1000;
+
+// A client connection. Responses of concurrent requests are written a whole
+// line at a time, failures are ignored as the client may be gone.
+class Connection {
+public:
+  explicit Connection(SOCKET socket)
+    : socket_(socket) {
+    ::InitializeCriticalSection(&crit_sec_);
+  }
+
+  ~Connection() {
+    ::closesocket(socket_);
+    ::DeleteCriticalSection(&crit_sec_);
+  }
+
+  SOCKET socket() const {
+    return socket_;
+  }
+
+  void SendLine(const string &line) {
+    string data = line + '\n';
+    const char *p = data.data();
+    size_t remaining = data.size();
+    ::EnterCriticalSection(&crit_sec_);
+    while (remaining) {
+      int sent = ::send(socket_, p,
+                        static_cast<int>(min<size_t>(remaining, INT_MAX)), 0);
+      if (sent <= 0)
+        break;
+      p += sent;
+      remaining -= sent;
+    }
+    ::LeaveCriticalSection(&crit_sec_);
+  }
+
+private:
+  SOCKET socket_;
+  CRITICAL_SECTION crit_sec_;
+
+private:
+  Connection(const Connection &) = delete;
+  void operator=(const Connection &) = delete;
+};
+
+// Lines of a request waiting to be sent. The job events are pushed by the
+// event dispatcher, which must not block on the client, and sent by a thread
+// of the request along with its response.
+class SendQueue {
+public:
+  explicit SendQueue(const shared_ptr<Connection> &connection)
+    : connection_(connection)
+    , event_(::CreateEventW(NULL, FALSE, FALSE, NULL))
+    , closed_(false) {
+    ::InitializeCriticalSection(&crit_sec_);
+  }
+
+  ~SendQueue() {
+    if (event_)
+      ::CloseHandle(event_);
+    ::DeleteCriticalSection(&crit_sec_);
+  }
+
+  // Submits the sender of the queue to the thread pool, which runs until
+  // the queue is closed
+  static bool Start(const shared_ptr<SendQueue> &queue) {
+    if (!queue->event_)
+      return false;
+    unique_ptr<shared_ptr<SendQueue>> context(
+        new shared_ptr<SendQueue>(queue));
+    if (!::TrySubmitThreadpoolCallback(SendCallback, context.get(), NULL))
+      return false;
+    context.release();
+    return true;
+  }
+
+  void Push(const string &line) {
+    ::EnterCriticalSection(&crit_sec_);
+    if (!closed_)
+      lines_.push_back(line);
+    ::LeaveCriticalSection(&crit_sec_);
+    ::SetEvent(event_);
+  }
+
+  // Pushes the last line of the request, the lines pushed later are dropped
+  void Close(const string &line) {
+    ::EnterCriticalSection(&crit_sec_);
+    if (!closed_) {
+      lines_.push_back(line);
+      closed_ = true;
+    }
+    ::LeaveCriticalSection(&crit_sec_);
+    ::SetEvent(event_);
+  }
+
+private:
+  static void CALLBACK SendCallback(PTP_CALLBACK_INSTANCE instance,
+                                    PVOID context) {
+    // The sender blocks until the request is done
+    ::CallbackMayRunLong(instance);
+    unique_ptr<shared_ptr<SendQueue>> queue(
+        reinterpret_cast<shared_ptr<SendQueue> *>(context));
+    (*queue)->Send();
+  }
+
+  void Send() {
+    bool closed = false;
+    while (!closed) {
+      ::WaitForSingleObject(event_, INFINITE);
+      deque<string> lines;
+      ::EnterCriticalSection(&crit_sec_);
+      lines.swap(lines_);
+      closed = closed_;
+      ::LeaveCriticalSection(&crit_sec_);
+      for (const string &line : lines)
+        connection_->SendLine(line);
+    }
+  }
+
+private:
+  shared_ptr<Connection> connection_;
+  HANDLE event_;
+  CRITICAL_SECTION crit_sec_;
+  deque<string> lines_;
+  bool closed_;
+
+private:
+  SendQueue(const SendQueue &) = delete;
+  void operator=(const SendQueue &) = delete;
+};
+
+struct Server {
+  Container *container;
+  SpawnOptions defaults;
+  // Directory of the programs and the standard I/O files of the requests
+  wstring directory;
+  bool verbose;
+};
+
+struct ConnectionContext {
+  Server *server;
+  shared_ptr<Connection> connection;
+};
+
+struct Request {
+  Server *server;
+  shared_ptr<Connection> connection;
+  JsonValue message;
+};
+
+void WriteId(JsonWriter *writer, const JsonValue *id) {
+  if (id) {
+    writer->Key("id");
+    writer->Value(*id);
+  }
+}
+
+// Responds with an error, through the send queue of the request once it has
+// one so that the error follows the job events
+void SendError(const Request &request, SendQueue *queue, const char *error,
+               ResultCode rc) {
+  JsonWriter writer;
+  writer.BeginObject();
+  WriteId(&writer, request.message.Find("id"));
+  writer.Key("error");
+  writer.String(error, strlen(error));
+  if (rc != WINC_OK) {
+    writer.Key("code");
+    writer.Uint64(rc);
+  }
+  writer.EndObject();
+  if (queue)
+    queue->Close(writer.str());
+  else
+    request.connection->SendLine(writer.str());
+  if (request.server->verbose)
+    fwprintf(stderr, L"Request failed: %hs\n", writer.str().c_str());
+}
+
+// Streams the job events of a request, the ones printed by the CLI in
+// verbose mode. The events are delivered on the dispatcher thread, so they
+// are only pushed to the send queue.
+class ServeTarget : public Target {
+public:
+  ServeTarget(const shared_ptr<SendQueue> &queue, const JsonValue *id)
+    : queue_(queue)
+    , id_(id)
+    , exit_all_event_(::CreateEventW(NULL, TRUE, FALSE, NULL))
+    {}
+
+  virtual ~ServeTarget() override {
+    // The exit all event may still be on its way when the wait times out
+    StopListening();
+    if (exit_all_event_)
+      ::CloseHandle(exit_all_event_);
+  }
+
+  bool WaitForExitAll(DWORD timeout_ms) {
+    return exit_all_event_ &&
+           ::WaitForSingleObject(exit_all_event_, timeout_ms) ==
+               WAIT_OBJECT_0;
+  }
+
+protected:
+  virtual void OnActiveProcessLimit() override {
+    SendEvent("active_process_limit", nullptr);
+  }
+
+  virtual void OnExitAll() override {
+    SendEvent("exit_all", nullptr);
+    if (exit_all_event_)
+      ::SetEvent(exit_all_event_);
+  }
+
+  virtual void OnNewProcess(DWORD process_id) override {
+    SendEvent("new_process", &process_id);
+  }
+
+  virtual void OnExitProcess(DWORD process_id) override {
+    SendEvent("exit_process", &process_id);
+  }
+
+  virtual void OnMemoryLimit(DWORD process_id) override {
+    SendEvent("memory_limit", &process_id);
+  }
+
+private:
+  void SendEvent(const char *event, const DWORD *process_id) {
+    JsonWriter writer;
+    writer.BeginObject();
+    WriteId(&writer, id_);
+    writer.Key("event");
+    writer.String(event, strlen(event));
+    if (process_id) {
+      writer.Key("process_id");
+      writer.Uint64(*process_id);
+    }
+    writer.EndObject();
+    queue_->Push(writer.str());
+  }
+
+private:
+  shared_ptr<SendQueue> queue_;
+  const JsonValue *id_;
+  HANDLE exit_all_event_;
+};
+
+// Checks that a path from a client stays inside the directory: it must
+// be relative, without drive, stream or parent components. Components of
+// dots and spaces only are rejected too, as Windows trims them into "..".
+bool IsConfinedPath(const wstring &path) {
+  if (path.empty() || path[0] == L'\\' || path[0] == L'/' ||
+      path.find(L':') != wstring::npos)
+    return false;
+  size_t begin = 0;
+  while (begin <= path.size()) {
+    size_t end = path.find_first_of(L"\\/", begin);
+    if (end == wstring::npos)
+      end = path.size();
+    if (end == begin || path.find_first_not_of(L". ", begin) >= end)
+      return false;
+    begin = end + 1;
+  }
+  return true;
+}
+
+// Opens a redirected standard I/O file in the directory as an inheritable
+// handle. The daemon opens it with its own token, so the path
+// is confined rather than trusted.
+bool OpenStdFile(const Server &server, const JsonValue &message,
+                 const char *key, bool write, unique_handle *out_handle) {
+  wstring path;
+  bool present;
+  if (!GetStringMember(message, key, &path, &present))
+    return false;
+  if (!present)
+    return true;
+  if (!IsConfinedPath(path))
+    return false;
+  path = server.directory + L'\\' + path;
+  SECURITY_ATTRIBUTES sa = {sizeof(sa), NULL, TRUE};
+  HANDLE file = ::CreateFileW(path.c_str(),
+                              write ? GENERIC_WRITE : GENERIC_READ,
+                              FILE_SHARE_READ, &sa,
+                              write ? CREATE_ALWAYS : OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  out_handle->reset(file);
+  return true;
+}
+
+void RunRequest(Request *request) {
+  Server *server = request->server;
+  const JsonValue &message = request->message;
+
+  wstring exe;
+  bool present;
+  if (!GetStringMember(message, "exe", &exe, &present) || !present) {
+    SendError(*request, nullptr, "exe expected", WINC_OK);
+    return;
+  }
+  wchar_t exe_path[MAX_PATH];
+  if (!IsConfinedPath(exe) ||
+      !FindApplicationIn(server->directory.c_str(), exe.c_str(), exe_path)) {
+    SendError(*request, nullptr, "application path not found", WINC_OK);
+    return;
+  }
+
+  CommandLineBuilder command_line;
+  if (!GetCommandLineMember(message, "args", exe, &command_line)) {
+    SendError(*request, nullptr, "args must be an array of strings", WINC_OK);
+    return;
+  }
+
+  SpawnOptions options = server->defaults;
+  options.command_line = command_line.command_line();
+  uint64_t memory_limit = options.memory_limit;
+  uint64_t active_process_limit = options.active_process_limit;
+  uint64_t processor_affinity = options.processor_affinity;
+  uint64_t time_limit = 0;
+  if (!GetUint64Member(message, "memory_limit", &memory_limit) ||
+      !GetUint64Member(message, "active_process_limit",
+                       &active_process_limit) ||
+      !GetUint64Member(message, "processor_affinity",
+                       &processor_affinity) ||
+      !GetUint64Member(message, "time_limit", &time_limit) ||
+      active_process_limit > UINT32_MAX || time_limit >= INFINITE) {
+    SendError(*request, nullptr, "invalid limit", WINC_OK);
+    return;
+  }
+  options.memory_limit = static_cast<uintptr_t>(memory_limit);
+  options.active_process_limit = static_cast<uint32_t>(active_process_limit);
+  if (message.Find("processor_affinity")) {
+    options.processor_affinity = static_cast<uintptr_t>(processor_affinity);
+    options.auto_affinity = false;
+  }
+
+  unique_handle stdin_file, stdout_file, stderr_file;
+  if (!OpenStdFile(*server, message, "stdin", false, &stdin_file) ||
+      !OpenStdFile(*server, message, "stdout", true, &stdout_file) ||
+      !OpenStdFile(*server, message, "stderr", true, &stderr_file)) {
+    SendError(*request, nullptr, "cannot open the standard I/O files", WINC_OK);
+    return;
+  }
+  options.stdin_handle = stdin_file.get();
+  options.stdout_handle = stdout_file.get();
+  options.stderr_handle = stderr_file.get();
+
+  shared_ptr<SendQueue> queue = make_shared<SendQueue>(request->connection);
+  if (!SendQueue::Start(queue)) {
+    SendError(*request, nullptr, "cannot queue the request", WINC_OK);
+    return;
+  }
+  const JsonValue *id = message.Find("id");
+  ServeTarget target(queue, id);
+  ResultCode rc = server->container->Spawn(exe_path, &target, &options);
+  if (rc != WINC_OK) {
+    SendError(*request, queue.get(), "spawn failed", rc);
+    return;
+  }
+  stdin_file.reset();
+  stdout_file.reset();
+  stderr_file.reset();
+  rc = target.Start(true);
+  if (rc != WINC_OK) {
+    target.TerminateJob(1);
+    SendError(*request, queue.get(), "start failed", rc);
+    return;
+  }
+
+  bool timeouted;
+  rc = target.WaitForProcess(time_limit ? static_cast<DWORD>(time_limit)
+                                        : INFINITE,
+                             &timeouted);
+  if (rc == WINC_OK && timeouted) {
+    rc = target.TerminateJob(1);
+    if (rc == WINC_OK)
+      rc = target.WaitForProcess();
+  }
+  DWORD exit_code;
+  ULONG64 job_time, process_time;
+  SIZE_T peak_memory;
+  if (rc == WINC_OK)
+    rc = target.GetProcessExitCode(&exit_code);
+  if (rc == WINC_OK)
+    rc = target.GetJobTime(&job_time);
+  if (rc == WINC_OK)
+    rc = target.GetProcessTime(&process_time);
+  if (rc == WINC_OK)
+    rc = target.GetJobPeakMemory(&peak_memory);
+  // The processes left in the job would be killed as the target closes,
+  // terminating them first delivers the remaining events before the result
+  target.TerminateJob(1);
+  target.WaitForExitAll(kExitAllTimeoutMs);
+  if (rc != WINC_OK) {
+    SendError(*request, queue.get(), "wait failed", rc);
+    return;
+  }
+
+  JsonWriter writer;
+  writer.BeginObject();
+  WriteId(&writer, id);
+  writer.Key("exit_code");
+  writer.Uint64(exit_code);
+  writer.Key("time_limit_exceeded");
+  writer.Bool(timeouted);
+  writer.Key("job_time");
+  writer.Uint64(job_time);
+  writer.Key("process_time");
+  writer.Uint64(process_time);
+  writer.Key("peak_memory");
+  writer.Uint64(peak_memory);
+  writer.EndObject();
+  queue->Close(writer.str());
+  if (server->verbose)
+    fwprintf(stderr, L"Request done: %hs\n", writer.str().c_str());
+}
+
+// Removes the socket file of a previous daemon, which fails the bind.
+// Anything else at the path is kept and fails the removal.
+bool RemoveStaleSocket(const wchar_t *path) {
+  // Wildcards would match other files
+  if (wcspbrk(path, L"*?"))
+    return false;
+  WIN32_FIND_DATAW data;
+  HANDLE find = ::FindFirstFileW(path, &data);
+  if (find == INVALID_HANDLE_VALUE)
+    return ::GetLastError() == ERROR_FILE_NOT_FOUND;
+  ::FindClose(find);
+  if (!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ||
+      data.dwReserved0 != kReparseTagAfUnix)
+    return false;
+  return ::DeleteFileW(path) != FALSE;
+}
+
+void CALLBACK RunCallback(PTP_CALLBACK_INSTANCE instance, PVOID context) {
+  // Requests block until their targets exit
+  ::CallbackMayRunLong(instance);
+  unique_ptr<Request> request(reinterpret_cast<Request *>(context));
+  RunRequest(request.get());
+}
+
+void HandleLine(ConnectionContext *context, const char *line, size_t size) {
+  if (size && line[size - 1] == '\r')
+    --size;
+  if (!size)
+    return;
+  unique_ptr<Request> request(new Request);
+  request->server = context->server;
+  request->connection = context->connection;
+  if (!ParseJson(line, size, &request->message) ||
+      request->message.type() != JsonValue::TYPE_OBJECT) {
+    request->message = JsonValue();
+    SendError(*request, nullptr, "invalid request", WINC_OK);
+    return;
+  }
+  if (!::TrySubmitThreadpoolCallback(RunCallback, request.get(), NULL)) {
+    SendError(*request, nullptr, "cannot queue the request", WINC_OK);
+    return;
+  }
+  request.release();
+}
+
+DWORD WINAPI ConnectionThread(PVOID param) {
+  unique_ptr<ConnectionContext> context(
+      reinterpret_cast<ConnectionContext *>(param));
+  string buffer;
+  char chunk[4096];
+  while (true) {
+    int received = ::recv(context->connection->socket(), chunk,
+                          sizeof(chunk), 0);
+    if (received <= 0)
+      break;
+    buffer.append(chunk, received);
+    size_t begin = 0;
+    size_t end;
+    while ((end = buffer.find('\n', begin)) != string::npos) {
+      HandleLine(context.get(), buffer.data() + begin, end - begin);
+      begin = end + 1;
+    }
+    buffer.erase(0, begin);
+    if (buffer.size() > kMaxRequestSize) {
+      context->connection->SendLine("{\"error\":\"request too large\"}");
+      break;
+    }
+  }
+  // The running requests keep the connection until they respond
+  return 0;
+}
+
+}
+
+int Serve(Container *container, const SpawnOptions &defaults,
+          const wchar_t *socket_path, const wchar_t *directory,
+          bool verbose) {
+  UnixAddress address = {};
+  address.sun_family = AF_UNIX;
+  string path;
+  if (!WideToUtf8(socket_path, &path) || path.size() >= kUnixPathMax) {
+    fwprintf(stderr, L"Invalid socket path: %ws\n", socket_path);
+    return 1;
+  }
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  WSADATA wsa_data;
+  int error = ::WSAStartup(MAKEWORD(2, 2), &wsa_data);
+  if (error) {
+    fwprintf(stderr, L"Winsock error: %d\n", error);
+    return 1;
+  }
+  SOCKET listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener == INVALID_SOCKET) {
+    fwprintf(stderr, L"Unix domain socket not supported: %d\n",
+             ::WSAGetLastError());
+    return 1;
+  }
+  if (!RemoveStaleSocket(socket_path)) {
+    fwprintf(stderr, L"Not a stale socket, refusing to replace: %ws\n",
+             socket_path);
+    ::closesocket(listener);
+    return 1;
+  }
+  if (::bind(listener, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address))) {
+    fwprintf(stderr, L"Cannot listen on %ws: %d\n", socket_path,
+             ::WSAGetLastError());
+    ::closesocket(listener);
+    return 1;
+  }
+  // Restrict the socket file before the listen, so that nobody connects
+  // with the default access
+  PSECURITY_DESCRIPTOR security;
+  if (!::ConvertStringSecurityDescriptorToSecurityDescriptorW(
+          kSocketSecurity, SDDL_REVISION_1, &security, NULL)) {
+    fwprintf(stderr, L"Cannot restrict %ws: %u\n", socket_path,
+             ::GetLastError());
+    ::closesocket(listener);
+    return 1;
+  }
+  BOOL restricted = ::SetFileSecurityW(socket_path, DACL_SECURITY_INFORMATION,
+                                       security);
+  ::LocalFree(security);
+  if (!restricted) {
+    fwprintf(stderr, L"Cannot restrict %ws: %u\n", socket_path,
+             ::GetLastError());
+    ::closesocket(listener);
+    return 1;
+  }
+  if (::listen(listener, SOMAXCONN)) {
+    fwprintf(stderr, L"Cannot listen on %ws: %d\n", socket_path,
+             ::WSAGetLastError());
+    ::closesocket(listener);
+    return 1;
+  }
+
+  // The server lives until the process exits, as the requests on the
+  // thread pool refer to it
+  Server *server = new Server;
+  server->container = container;
+  server->defaults = defaults;
+  server->directory = directory;
+  server->verbose = verbose;
+  if (verbose)
+    fwprintf(stderr, L"Serving on %ws\n", socket_path);
+  while (true) {
+    SOCKET client = ::accept(listener, NULL, NULL);
+    if (client == INVALID_SOCKET) {
+      fwprintf(stderr, L"Accept failed: %d\n", ::WSAGetLastError());
+      ::closesocket(listener);
+      return 1;
+    }
+    ConnectionContext *context = new ConnectionContext;
+    context->server = server;
+    context->connection = make_shared<Connection>(client);
+    HANDLE thread = ::CreateThread(NULL, 0, ConnectionThread, context,
+                                   0, NULL);
+    if (!thread) {
+      delete context;
+      continue;
+    }
+    ::CloseHandle(thread);
+  }
+}
+
+}
+
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_WINC_SERVE_H_
+#define WINC_WINC_SERVE_H_
+
+namespace winc {
+
+class Container;
+struct SpawnOptions;
+
+namespace cli {
+
+// Runs the judge daemon on a Unix domain socket until the process is
+// killed, returns the exit code of the CLI if the socket cannot be served.
+// An existing file at socket_path is only replaced if it is a socket.
+//
+// Each line from a client is a JSON request, which is run concurrently with
+// the others on the thread pool:
+//
+//   {"id": 1, "exe": "a.exe", "args": ["a", "1"], "time_limit": 1000,
+//    "memory_limit": 67108864, "active_process_limit": 1,
+//    "processor_affinity": 1, "stdin": "in.txt", "stdout": "out.txt",
+//    "stderr": "err.txt"}
+//
+// Only exe is required, the limits override the ones given to the CLI and
+// the time limit is in milliseconds. The exe and the standard I/O paths are
+// relative to directory and may not leave it. The job events are streamed back as
+// {"id": 1, "event": "new_process", "process_id": 42} lines, and each
+// request ends with one line of either its statistics or an error:
+//
+//   {"id": 1, "exit_code": 0, "time_limit_exceeded": false,
+//    "job_time": 156250, "process_time": 156250, "peak_memory": 1048576}
+//   {"id": 1, "error": "spawn failed", "code": 3}
+//
+// The times are in 100 nanoseconds. The container is shared by all of the
+// requests, so anyone who can connect to the socket runs programs with its
+// policy. Only the user of the daemon and the system may connect.
+int Serve(Container *container, const SpawnOptions &defaults,
+          const wchar_t *socket_path, const wchar_t *directory,
+          bool verbose);
+
+}
+
+}
+
+#endif
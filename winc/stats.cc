@@ -0,0 +1,129 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winc/stats.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <winc.h>
+
+#include "winc/json.h"
+
+using std::sort;
+using std::string;
+using std::vector;
+
+namespace winc {
+
+namespace cli {
+
+namespace {
+
+struct Metric {
+  const char *name;
+  uint64_t (*get)(const RunStats &stats);
+};
+
+const Metric kMetrics[] = {
+  {"wall_time", [](const RunStats &s) -> uint64_t { return s.wall_time; }},
+  {"job_time", [](const RunStats &s) -> uint64_t { return s.job_time; }},
+  {"process_time",
+   [](const RunStats &s) -> uint64_t { return s.process_time; }},
+  {"process_cycle",
+   [](const RunStats &s) -> uint64_t { return s.process_cycle; }},
+  {"job_peak_memory",
+   [](const RunStats &s) -> uint64_t { return s.job_peak_memory; }},
+  {"process_peak_memory",
+   [](const RunStats &s) -> uint64_t { return s.process_peak_memory; }},
+  {"process_count",
+   [](const RunStats &s) -> uint64_t { return s.process_count; }},
+};
+
+// The values of a metric over the runs, sorted
+vector<uint64_t> SortedValues(const vector<RunStats> &runs,
+                              const Metric &metric) {
+  vector<uint64_t> values;
+  values.reserve(runs.size());
+  for (const RunStats &stats : runs)
+    values.push_back(metric.get(stats));
+  sort(values.begin(), values.end());
+  return values;
+}
+
+// The lower median for an even number of runs, so that it is a measured
+// value
+uint64_t Median(const vector<uint64_t> &sorted) {
+  return sorted[(sorted.size() - 1) / 2];
+}
+
+}
+
+ResultCode CollectStats(Target *target, ULONG64 wall_time,
+                        RunStats *out_stats) {
+  RunStats stats = RunStats();
+  stats.wall_time = wall_time;
+  ResultCode rc = target->GetProcessExitCode(&stats.exit_code);
+  if (rc == WINC_OK)
+    rc = target->GetJobTime(&stats.job_time);
+  if (rc == WINC_OK)
+    rc = target->GetProcessTime(&stats.process_time);
+  if (rc == WINC_OK)
+    rc = target->GetProcessCycle(&stats.process_cycle);
+  if (rc == WINC_OK)
+    rc = target->GetJobPeakMemory(&stats.job_peak_memory);
+  if (rc == WINC_OK)
+    rc = target->GetProcessPeakMemory(&stats.process_peak_memory);
+  if (rc == WINC_OK)
+    rc = target->GetJobProcessCount(&stats.process_count);
+  if (rc != WINC_OK)
+    return rc;
+  *out_stats = stats;
+  return WINC_OK;
+}
+
+void PrintStatsJson(const vector<RunStats> &runs) {
+  JsonWriter writer;
+  writer.BeginObject();
+  writer.Key("runs");
+  writer.Uint64(runs.size());
+  writer.Key("exit_code");
+  writer.Uint64(runs.back().exit_code);
+  for (const Metric &metric : kMetrics) {
+    writer.Key(metric.name);
+    if (runs.size() == 1) {
+      writer.Uint64(metric.get(runs.front()));
+      continue;
+    }
+    vector<uint64_t> values = SortedValues(runs, metric);
+    writer.BeginObject();
+    writer.Key("min");
+    writer.Uint64(values.front());
+    writer.Key("median");
+    writer.Uint64(Median(values));
+    writer.Key("max");
+    writer.Uint64(values.back());
+    writer.EndObject();
+  }
+  writer.EndObject();
+  string line = writer.str() + '\n';
+  fwrite(line.data(), 1, line.size(), stdout);
+  fflush(stdout);
+}
+
+void PrintStatsTable(const vector<RunStats> &runs) {
+  fwprintf(stderr, L"%-20hs %16hs %16hs %16hs\n", "", "min", "median", "max");
+  for (const Metric &metric : kMetrics) {
+    vector<uint64_t> values = SortedValues(runs, metric);
+    fwprintf(stderr, L"%-20hs %16" PRIu64 " %16" PRIu64 " %16" PRIu64 "\n",
+             metric.name, values.front(), Median(values), values.back());
+  }
+}
+
+}
+
+}
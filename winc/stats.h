@@ -0,0 +1,52 @@
+// Copyright (c) 2015 Vijos Dev Team. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINC_WINC_STATS_H_
+#define WINC_WINC_STATS_H_
+
+#include <Windows.h>
+#include <vector>
+
+#include <winc_types.h>
+
+namespace winc {
+
+class Target;
+
+namespace cli {
+
+// The accounting of one run of a target, the times are in 100 nanoseconds
+struct RunStats {
+  DWORD exit_code;
+  ULONG64 wall_time;
+  ULONG64 job_time;
+  ULONG64 process_time;
+  ULONG64 process_cycle;
+  SIZE_T job_peak_memory;
+  SIZE_T process_peak_memory;
+  DWORD process_count;
+};
+
+// Collects the accounting of a target whose process has exited, the wall
+// time is measured by the caller
+ResultCode CollectStats(Target *target, ULONG64 wall_time,
+                        RunStats *out_stats);
+
+// Prints the statistics as one JSON object to the standard output. A single
+// run prints its fields as numbers, repeated runs print the minimum, median
+// and maximum of each field besides the exit code of the last run:
+//
+//   {"runs": 3, "exit_code": 0,
+//    "wall_time": {"min": 1, "median": 2, "max": 3}, ...}
+void PrintStatsJson(const std::vector<RunStats> &runs);
+
+// Prints the minimum, median and maximum of the repeated runs as a table to
+// the standard error
+void PrintStatsTable(const std::vector<RunStats> &runs);
+
+}
+
+}
+
+#endif